@@ -0,0 +1,15 @@
+#!/usr/bin/env ruby
+
+require 'anlnext'
+require 'testHistogram'
+
+class MyApp < ANL::ANLApp
+  def setup()
+    chain TestHistogram::SaveData
+    chain TestHistogram::GenerateEvents
+    chain TestHistogram::FillHistogram
+  end
+end
+
+a = MyApp.new
+a.make_main(output: "main.cc")
@@ -31,13 +31,10 @@ public:
   anlnext::ANLStatus mod_analyze() override;
   anlnext::ANLStatus mod_end_run() override;
 
-  const std::vector<double>& Energies() const
-  { return energies_generated_; }
-
 private:
   double center_;
   double sigma_;
-  std::vector<double> energies_generated_;
+  anlnext::EventHandle<std::vector<double>> energies_;
   double efficiency_;
   int num_detectors_;
   int random_seed_;
@@ -1,6 +1,5 @@
 #include "FillHistogram.hh"
 #include "TH1.h"
-#include "GenerateEvents.hh"
 #include "CreateRootFile.hh"
 
 using namespace anlnext;
@@ -24,7 +23,7 @@ ANLStatus FillHistogram::mod_define()
 
 ANLStatus FillHistogram::mod_initialize()
 {
-  get_module("GenerateEvents", &event_);
+  energies_ = bind_event_data<std::vector<double>>("GenerateEvents:Energies");
 
   if (exist_module("CreateRootFile")) {
     comptonsoft::CreateRootFile* fileManager = nullptr;
@@ -39,7 +38,7 @@ ANLStatus FillHistogram::mod_initialize()
 
 ANLStatus FillHistogram::mod_analyze()
 {
-  const std::vector<double>& energies = event_->Energies();
+  const std::vector<double>& energies = event_data(energies_);
 
   for (const auto& energy: energies) {
     spectrum_->Fill(energy);
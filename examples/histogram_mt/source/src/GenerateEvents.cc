@@ -35,9 +35,10 @@ ANLStatus GenerateEvents::mod_define()
 ANLStatus GenerateEvents::mod_initialize()
 {
   random_.reset(new TRandom3(random_seed_+copy_id()));
-  energies_generated_.reserve(num_detectors_);
 
   define_evs("GenerateEvents:Hit");
+  energies_ = define_event_data<std::vector<double>>("GenerateEvents:Energies");
+  event_data(energies_).reserve(num_detectors_);
 
   return AS_OK;
 }
@@ -50,17 +51,18 @@ ANLStatus GenerateEvents::mod_begin_run()
 
 ANLStatus GenerateEvents::mod_analyze()
 {
-  energies_generated_.clear();
+  std::vector<double>& energies = event_data(energies_);
+  energies.clear();
 
   for (int i=0; i<num_detectors_; i++) {
     const double energy = random_->Gaus(center_, sigma_);
     if (random_->Uniform(1.0) < efficiency_) {
-      energies_generated_.push_back(energy);
+      energies.push_back(energy);
       ++sum_events_;
     }
   }
 
-  if (energies_generated_.size() > 0) {
+  if (energies.size() > 0) {
     set_evs("GenerateEvents:Hit");
   }
   
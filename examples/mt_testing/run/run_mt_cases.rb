@@ -0,0 +1,338 @@
+#!/usr/bin/env ruby
+
+# Test cases of the multi-thread modes. Each case runs a chain of
+# MyEventCounter modules and checks the number of events each module has
+# seen, the order of the events for the order-sensitive modules, and the
+# quit and redo paths. It exits with 1 if any case fails.
+# The C++ program run_mt_cases runs the same cases without Ruby.
+#
+# usage: ./run_mt_cases.rb [num_events]
+
+require 'anlnext' # ANL Next library
+require 'myPackageMT'# Ruby extension library using ANL Next
+
+NumEvents = (ARGV[0] || 20000).to_i
+IndexSum = NumEvents*(NumEvents-1)/2
+
+# redo once every event whose index modulo RedoPeriod is RedoIndex. The
+# retry sleeps so that the other chains can reach the following modules.
+RedoPeriod = 500
+RedoIndex = 77
+RedoParameters = { redo_index: RedoIndex, redo_period: RedoPeriod, redo_delay: 200 }
+NumRedone = (NumEvents+RedoPeriod-1-RedoIndex)/RedoPeriod
+
+# An application whose chain and settings are given by a block.
+class CaseApp < ANL::ANLApp
+  def initialize(&setup_block)
+    super()
+    @setup_block = setup_block
+  end
+
+  def setup()
+    add_namespace MyPackageMT
+    instance_eval(&@setup_block)
+  end
+
+  def result(module_id, name)
+    get_module(module_id).get_result_value(name)
+  end
+end
+
+$failures = []
+
+def run_case(name, app)
+  app.console = false
+  app.display_period = 0
+  app.run(NumEvents)
+  failed = yield(app)
+  if failed
+    $failures << name
+    puts "FAIL #{name}: #{failed}"
+  else
+    puts "PASS #{name}"
+  end
+end
+
+# @return nil if all the conditions hold, or a message
+def expect(conditions)
+  bad = conditions.reject {|_k, v| v[0] == v[1] }
+  return nil if bad.empty?
+  bad.map {|k, v| "#{k} = #{v[0]} (expected #{v[1]})" }.join(", ")
+end
+
+# the conditions of an order-sensitive module: every event in order,
+# one chain at a time.
+def in_order(app, module_id)
+  {
+    "#{module_id} disorders": [app.result(module_id, :num_disorders), 0],
+    "#{module_id} overlaps": [app.result(module_id, :num_overlaps), 0],
+  }
+end
+
+### Event dispatcher: schedules, chunk sizes (work stealing included),
+### and the quit and redo paths with an order-sensitive module.
+[:dynamic, :guided, :work_stealing].each do |schedule|
+  [0, 100].each do |chunk|
+    prefix = "#{schedule} chunk=#{chunk}"
+
+    app = CaseApp.new do
+      chain :MyEventCounter, :Counter
+      chain :MyEventCounter, :Ordered
+      with_parameters(order_sensitive: true)
+    end
+    app.set_num_parallels(4, event_schedule: schedule, chunk_size: chunk)
+    run_case("#{prefix} all events", app) do |a|
+      expect({ counter: [a.result(:Counter, :num_events), NumEvents],
+               index_sum: [a.result(:Counter, :index_sum), IndexSum],
+               ordered: [a.result(:Ordered, :num_events), NumEvents] }
+               .merge(in_order(a, :Ordered)))
+    end
+
+    # all the chains stop at the quitting event, which passes in order.
+    app = CaseApp.new do
+      chain :MyEventCounter, :Counter
+      chain :MyEventCounter, :Ordered
+      with_parameters(order_sensitive: true, quit_index: 5000, quit_all: true)
+    end
+    app.set_num_parallels(4, event_schedule: schedule, chunk_size: chunk)
+    run_case("#{prefix} quit all", app) do |a|
+      expect({ ordered: [a.result(:Ordered, :num_events), 5001] }
+               .merge(in_order(a, :Ordered)))
+    end
+
+    # only the chain that quits stops; the others process the rest.
+    app = CaseApp.new do
+      chain :MyEventCounter, :Ordered
+      with_parameters(order_sensitive: true, quit_index: 5000, quit_all: false)
+    end
+    app.set_num_parallels(4, event_schedule: schedule, chunk_size: chunk)
+    run_case("#{prefix} quit one chain", app) do |a|
+      expect({ ordered: [a.result(:Ordered, :num_events), NumEvents] }
+               .merge(in_order(a, :Ordered)))
+    end
+
+    # the redone events are retried in their turns.
+    app = CaseApp.new do
+      chain :MyEventCounter, :Counter
+      with_parameters(RedoParameters)
+      chain :MyEventCounter, :Ordered
+      with_parameters(order_sensitive: true)
+    end
+    app.set_num_parallels(4, event_schedule: schedule, chunk_size: chunk)
+    run_case("#{prefix} redo", app) do |a|
+      expect({ counter: [a.result(:Counter, :num_events), NumEvents+NumRedone],
+               redone: [a.result(:Counter, :num_redone), NumRedone],
+               ordered: [a.result(:Ordered, :num_events), NumEvents],
+               index_sum: [a.result(:Ordered, :index_sum), IndexSum] }
+               .merge(in_order(a, :Ordered)))
+    end
+
+    # an order-sensitive module sees a redone event twice in a row.
+    app = CaseApp.new do
+      chain :MyEventCounter, :Ordered
+      with_parameters(order_sensitive: true)
+      chain :MyEventCounter, :Redo
+      with_parameters(RedoParameters)
+      chain :MyEventCounter, :Tail
+      with_parameters(order_sensitive: true)
+    end
+    app.set_num_parallels(4, event_schedule: schedule, chunk_size: chunk)
+    run_case("#{prefix} redo after an ordered module", app) do |a|
+      expect({ ordered: [a.result(:Ordered, :num_events), NumEvents+NumRedone],
+               ordered_overlaps: [a.result(:Ordered, :num_overlaps), 0],
+               tail: [a.result(:Tail, :num_events), NumEvents] }
+               .merge(in_order(a, :Tail)))
+    end
+  end
+end
+
+### Pipeline and farm: ordered head and tail stages around a body stage.
+def test_stages(mode)
+  [nil, :quit, :redo].each do |path|
+    app = CaseApp.new do
+      chain :MyEventCounter, :Head
+      with_parameters(order_sensitive: true)
+      stage_boundary
+      chain :MyEventCounter, :Body
+      with_parameters(RedoParameters) if path == :redo
+      stage_boundary
+      chain :MyEventCounter, :Tail
+      with_parameters(order_sensitive: true, quit_index: (path == :quit ? 5000 : -1))
+    end
+    app.num_parallels = 4
+    app.execution_mode = mode
+    run_case("#{mode} #{path || 'all events'}", app) do |a|
+      c = in_order(a, :Head).merge(in_order(a, :Tail))
+      case path
+      when :quit
+        c[:tail] = [a.result(:Tail, :num_events), 5001]
+      when :redo
+        # a redo re-runs only the stage of the module giving it.
+        c[:head] = [a.result(:Head, :num_events), NumEvents]
+        c[:body] = [a.result(:Body, :num_events), NumEvents+NumRedone]
+        c[:tail] = [a.result(:Tail, :num_events), NumEvents]
+      else
+        c[:head] = [a.result(:Head, :num_events), NumEvents]
+        c[:body] = [a.result(:Body, :num_events), NumEvents]
+        c[:tail] = [a.result(:Tail, :num_events), NumEvents]
+      end
+      expect(c)
+    end
+  end
+end
+
+test_stages(:pipeline)
+test_stages(:farm)
+
+### Periodic snapshots do not change the results, also when the run quits.
+[nil, :quit].each do |path|
+  app = CaseApp.new do
+    chain :MyEventCounter, :Counter
+    chain :MyEventCounter, :Ordered
+    with_parameters(order_sensitive: true, quit_index: (path == :quit ? 5000 : -1))
+  end
+  app.num_parallels = 4
+  app.set_snapshot_period(events: 1000)
+  run_case("snapshots #{path || 'all events'}", app) do |a|
+    c = { snapshots_taken: [a.result(:Counter, :num_snapshots) > 0, true] }
+    if path == :quit
+      c[:ordered] = [a.result(:Ordered, :num_events), 5001]
+    else
+      c[:counter] = [a.result(:Counter, :num_events), NumEvents]
+      c[:index_sum] = [a.result(:Counter, :index_sum), IndexSum]
+      c[:ordered] = [a.result(:Ordered, :num_events), NumEvents]
+    end
+    expect(c.merge(in_order(a, :Ordered)))
+  end
+end
+
+### Commutable filters reordered after a warm-up pass the same events.
+passed = (0...NumEvents).select {|i| i.odd? && i%3 != 0 }
+[1, 4].each do |num_parallels|
+  app = CaseApp.new do
+    chain :MyEventCounter, :F3
+    with_parameters(commutable_filter: true, skip_period: 3)
+    chain :MyEventCounter, :F2
+    with_parameters(commutable_filter: true, skip_period: 2)
+    chain :MyEventCounter, :Last
+  end
+  app.num_parallels = num_parallels if num_parallels > 1
+  app.reordering_warmup = 500
+  run_case("reordering #{num_parallels > 1 ? 'mt' : 'st'}", app) do |a|
+    expect({ last: [a.result(:Last, :num_events), passed.size],
+             last_index_sum: [a.result(:Last, :index_sum), passed.sum] })
+  end
+end
+
+### Concurrent modules of an event processed on the threads of the manager;
+### ANLManagerMT processes them one after another.
+[1, 4].each do |num_parallels|
+  app = CaseApp.new do
+    [:C1, :C2, :C3].each do |id|
+      chain :MyEventCounter, id
+      with_parameters(concurrent: true)
+    end
+    chain :MyEventCounter, :Ordered
+    with_parameters(order_sensitive: true)
+  end
+  app.num_parallels = num_parallels if num_parallels > 1
+  app.intra_event_threads = 3
+  run_case("intra-event #{num_parallels > 1 ? 'mt' : 'st'}", app) do |a|
+    c = {}
+    [:C1, :C2, :C3, :Ordered].each do |id|
+      c[:"#{id} events"] = [a.result(id, :num_events), NumEvents]
+      c[:"#{id} index_sum"] = [a.result(id, :index_sum), IndexSum]
+    end
+    expect(c.merge(in_order(a, :Ordered)))
+  end
+end
+
+### Batches: the run of batch-capable modules is processed at once and the
+### modules around it event by event, with the skip, redo and quit of each
+### event kept.
+BatchSize = 64
+NumSkipped = (NumEvents+2)/3
+SkippedSum = 3*NumSkipped*(NumSkipped-1)/2
+
+[1, 4].each do |num_parallels|
+  prefix = "batch #{num_parallels > 1 ? 'mt' : 'st'}"
+  batch_app = lambda do |&setup|
+    app = CaseApp.new(&setup)
+    app.num_parallels = num_parallels if num_parallels > 1
+    app.batch_size = BatchSize
+    app
+  end
+
+  app = batch_app.call do
+    chain :MyEventCounter, :A
+    with_parameters(batch: true, skip_period: 3)
+    chain :MyEventCounter, :B
+    with_parameters(batch: true)
+  end
+  run_case("#{prefix} all events", app) do |a|
+    expect({ a: [a.result(:A, :num_events), NumEvents],
+             b: [a.result(:B, :num_events), NumEvents-NumSkipped],
+             b_index_sum: [a.result(:B, :index_sum), IndexSum-SkippedSum] })
+  end
+
+  # the modules around the segment see each event with its own index.
+  app = batch_app.call do
+    chain :MyEventCounter, :Head
+    chain :MyEventCounter, :A
+    with_parameters(batch: true, skip_period: 3)
+    chain :MyEventCounter, :B
+    with_parameters(batch: true)
+    chain :MyEventCounter, :Tail
+  end
+  run_case("#{prefix} segment", app) do |a|
+    expect({ head: [a.result(:Head, :num_events), NumEvents],
+             a: [a.result(:A, :num_events), NumEvents],
+             b: [a.result(:B, :num_events), NumEvents-NumSkipped],
+             tail: [a.result(:Tail, :num_events), NumEvents-NumSkipped],
+             tail_index_sum: [a.result(:Tail, :index_sum), IndexSum-SkippedSum] })
+  end
+
+  # an event redone in the segment is redone alone from the first module.
+  app = batch_app.call do
+    chain :MyEventCounter, :Head
+    chain :MyEventCounter, :A
+    with_parameters(batch: true)
+    chain :MyEventCounter, :B
+    with_parameters(RedoParameters.merge(batch: true))
+    chain :MyEventCounter, :Tail
+  end
+  run_case("#{prefix} redo in segment", app) do |a|
+    expect({ head: [a.result(:Head, :num_events), NumEvents+NumRedone],
+             a: [a.result(:A, :num_events), NumEvents+NumRedone],
+             b: [a.result(:B, :num_events), NumEvents+NumRedone],
+             tail: [a.result(:Tail, :num_events), NumEvents],
+             tail_index_sum: [a.result(:Tail, :index_sum), IndexSum] })
+  end
+
+  # a quit in the segment truncates only the work after it.
+  next if num_parallels > 1
+  batch_end = [NumEvents, (5000/BatchSize+1)*BatchSize].min
+  app = batch_app.call do
+    chain :MyEventCounter, :Head
+    chain :MyEventCounter, :A
+    with_parameters(batch: true)
+    chain :MyEventCounter, :B
+    with_parameters(batch: true, quit_index: 5000)
+    chain :MyEventCounter, :Tail
+  end
+  run_case("#{prefix} quit in segment", app) do |a|
+    expect({ head: [a.result(:Head, :num_events), batch_end],
+             a: [a.result(:A, :num_events), batch_end],
+             b: [a.result(:B, :num_events), 5001],
+             tail: [a.result(:Tail, :num_events), 5000] })
+  end
+end
+
+puts ""
+if $failures.empty?
+  puts "All cases passed."
+else
+  puts "#{$failures.size} case(s) failed:"
+  $failures.each {|name| puts "  #{name}" }
+  exit 1
+end
@@ -0,0 +1,86 @@
+/**
+ * MyEventCounter: a module that counts the events it is called for and
+ * checks their order, used to test the multi-thread modes.
+ * It can also skip, redo, or quit at given events, and declare itself
+ * order sensitive, batchable, concurrent, or a commutable filter.
+ *
+ * An order-sensitive counter shares a probe with its clones: an event whose
+ * index is not larger than that of the last event seen by any chain is a
+ * disorder, and an event entering while another chain is inside the module
+ * is an overlap. Both must be zero. The probe also counts the snapshots
+ * taken of the results.
+ *
+ * @author Hirokazu Odaka
+ * @date 2026-10-17
+ *
+ */
+
+#ifndef MyEventCounter_H
+#define MyEventCounter_H 1
+
+#include <atomic>
+#include <memory>
+#include <anlnext/BasicModule.hh>
+
+class MyEventCounter : public anlnext::BasicModule
+{
+  DEFINE_ANL_MODULE(MyEventCounter, 1.0);
+  ENABLE_PARALLEL_RUN();
+public:
+  MyEventCounter();
+
+protected:
+  MyEventCounter(const MyEventCounter& r) = default;
+
+public:
+  anlnext::ANLStatus mod_define() override;
+  anlnext::ANLStatus mod_pre_initialize() override;
+  anlnext::ANLStatus mod_begin_run() override;
+  anlnext::ANLStatus mod_analyze() override;
+  anlnext::ANLStatus mod_end_run() override;
+  anlnext::ANLStatus mod_merge(const anlnext::BasicModule* r) override;
+  anlnext::ANLStatus mod_snapshot(anlnext::BasicModule* snapshot) const override;
+
+  bool mod_merge_is_associative() const override { return true; }
+  bool mod_snapshot_is_supported() const override { return true; }
+  bool mod_analyze_batch_is_supported() const override { return batch_; }
+  bool mod_analyze_is_concurrent() const override { return concurrent_; }
+  bool mod_is_commutable_filter() const override { return commutable_filter_; }
+
+private:
+  anlnext::ANLStatus analyze_status(long int index);
+
+private:
+  struct OrderProbe
+  {
+    std::atomic<long int> last_index{-1};
+    std::atomic<int> num_inside{0};
+    std::atomic<long int> num_disorders{0};
+    std::atomic<long int> num_overlaps{0};
+    std::atomic<long int> num_snapshots{0};
+  };
+
+  bool order_sensitive_ = false;
+  bool batch_ = false;
+  bool concurrent_ = false;
+  bool commutable_filter_ = false;
+  long int skip_period_ = 0;
+  long int redo_index_ = -1;
+  long int redo_period_ = 0;
+  long int quit_index_ = -1;
+  bool quit_all_ = true;
+  int redo_delay_ = 0;
+
+  long int num_events_ = 0;
+  long int num_disorders_ = 0;
+  long int num_overlaps_ = 0;
+  long int num_snapshots_ = 0;
+  long int num_redone_ = 0;
+  double index_sum_ = 0.0;
+  long int last_redone_index_ = -1;
+
+  /* shared by the clones */
+  std::shared_ptr<OrderProbe> probe_;
+};
+
+#endif /* MyEventCounter_H */
@@ -4,6 +4,7 @@
 
 // include headers of my modules
 #include "MyMTModule.hh"
+#include "MyEventCounter.hh"
   
 %}
 
@@ -13,3 +14,4 @@
 // interface to my modules
 
 class MyMTModule : public anlnext::BasicModule {};
+class MyEventCounter : public anlnext::BasicModule {};
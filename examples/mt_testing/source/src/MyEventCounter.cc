@@ -0,0 +1,144 @@
+#include "MyEventCounter.hh"
+#include <chrono>
+#include <thread>
+
+using namespace anlnext;
+
+MyEventCounter::MyEventCounter()
+  : probe_(std::make_shared<OrderProbe>())
+{
+}
+
+ANLStatus MyEventCounter::mod_define()
+{
+  define_parameter("order_sensitive", &mod_class::order_sensitive_);
+  set_parameter_description("If true, events are processed in order of the loop index.");
+  define_parameter("batch", &mod_class::batch_);
+  set_parameter_description("If true, events may be processed in batches.");
+  define_parameter("concurrent", &mod_class::concurrent_);
+  set_parameter_description("If true, this module may run concurrently with the other concurrent modules of an event.");
+  define_parameter("commutable_filter", &mod_class::commutable_filter_);
+  set_parameter_description("If true, this module may be reordered among its commutable neighbors.");
+  define_parameter("skip_period", &mod_class::skip_period_);
+  set_parameter_description("Skip the events whose loop index is a multiple of it. 0 for none.");
+  define_parameter("redo_index", &mod_class::redo_index_);
+  set_parameter_description("Redo the event of this loop index once. -1 for none.");
+  define_parameter("redo_period", &mod_class::redo_period_);
+  set_parameter_description("If positive, redo once every event whose loop index modulo it is redo_index.");
+  define_parameter("quit_index", &mod_class::quit_index_);
+  set_parameter_description("Quit at the event of this loop index. -1 for none.");
+  define_parameter("quit_all", &mod_class::quit_all_);
+  set_parameter_description("If true, quit all the parallel chains; otherwise only the chain of this module.");
+  define_parameter("redo_delay", &mod_class::redo_delay_);
+  set_parameter_description("Microseconds to sleep when a redone event is processed again.");
+
+  define_result("num_events", &mod_class::num_events_);
+  define_result("num_disorders", &mod_class::num_disorders_);
+  define_result("num_overlaps", &mod_class::num_overlaps_);
+  define_result("num_snapshots", &mod_class::num_snapshots_);
+  define_result("num_redone", &mod_class::num_redone_);
+  define_result("index_sum", &mod_class::index_sum_);
+  return AS_OK;
+}
+
+ANLStatus MyEventCounter::mod_pre_initialize()
+{
+  set_order_sensitive(order_sensitive_);
+  return AS_OK;
+}
+
+ANLStatus MyEventCounter::mod_begin_run()
+{
+  num_events_ = 0;
+  num_disorders_ = 0;
+  num_overlaps_ = 0;
+  num_snapshots_ = 0;
+  num_redone_ = 0;
+  index_sum_ = 0.0;
+  last_redone_index_ = -1;
+  if (is_master()) {
+    probe_->last_index = -1;
+    probe_->num_inside = 0;
+    probe_->num_disorders = 0;
+    probe_->num_overlaps = 0;
+    probe_->num_snapshots = 0;
+  }
+  return AS_OK;
+}
+
+ANLStatus MyEventCounter::mod_analyze()
+{
+  const long int index = get_loop_index();
+  num_events_++;
+  index_sum_ += index;
+  if (index == last_redone_index_ && redo_delay_ > 0) {
+    std::this_thread::sleep_for(std::chrono::microseconds(redo_delay_));
+  }
+
+  if (order_sensitive_) {
+    if (probe_->num_inside.fetch_add(1) != 0) {
+      probe_->num_overlaps++;
+    }
+    if (probe_->last_index.exchange(index) >= index) {
+      probe_->num_disorders++;
+    }
+  }
+  const ANLStatus status = analyze_status(index);
+  if (order_sensitive_) {
+    probe_->num_inside--;
+  }
+  return status;
+}
+
+ANLStatus MyEventCounter::analyze_status(long int index)
+{
+  const bool redo = (redo_period_ > 0) ? (index%redo_period_ == redo_index_) : (index == redo_index_);
+  if (redo && index != last_redone_index_) {
+    last_redone_index_ = index;
+    num_redone_++;
+    return AS_REDO;
+  }
+  if (index == quit_index_) {
+    return quit_all_ ? AS_QUIT_ALL : AS_QUIT;
+  }
+  if (skip_period_ > 0 && index % skip_period_ == 0) {
+    return AS_SKIP;
+  }
+  return AS_OK;
+}
+
+ANLStatus MyEventCounter::mod_end_run()
+{
+  num_disorders_ = probe_->num_disorders;
+  num_overlaps_ = probe_->num_overlaps;
+  num_snapshots_ = probe_->num_snapshots;
+  return AS_OK;
+}
+
+ANLStatus MyEventCounter::mod_merge(const BasicModule* r)
+{
+  const MyEventCounter* m = dynamic_cast<const MyEventCounter*>(r);
+  if (m == nullptr) {
+    return AS_ERROR;
+  }
+  // the disorders and overlaps are counted by the shared probe.
+  num_events_ += m->num_events_;
+  num_redone_ += m->num_redone_;
+  index_sum_ += m->index_sum_;
+  return AS_OK;
+}
+
+ANLStatus MyEventCounter::mod_snapshot(BasicModule* snapshot) const
+{
+  MyEventCounter* s = dynamic_cast<MyEventCounter*>(snapshot);
+  if (s == nullptr) {
+    return AS_ERROR;
+  }
+  s->num_events_ = num_events_;
+  s->num_disorders_ = probe_->num_disorders;
+  s->num_overlaps_ = probe_->num_overlaps;
+  s->num_snapshots_ = ++probe_->num_snapshots;
+  s->num_redone_ = num_redone_;
+  s->index_sum_ = index_sum_;
+  return AS_OK;
+}
@@ -0,0 +1,562 @@
+/**
+ * Test cases of the multi-thread modes, the same as run/run_mt_cases.rb
+ * but without Ruby. Each case runs a chain of MyEventCounter modules and
+ * checks the number of events each module has seen, the order of the events
+ * for the order-sensitive modules, and the quit and redo paths.
+ * It exits with 1 if any case fails.
+ *
+ * usage: run_mt_cases [num_events]
+ *
+ * @author Hirokazu Odaka
+ * @date 2026-10-17
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <anlnext/ANLManager.hh>
+#include <anlnext/ANLManagerMT.hh>
+#include <anlnext/ANLException.hh>
+#include "MyEventCounter.hh"
+
+using namespace anlnext;
+
+namespace
+{
+
+long int NumEvents = 20000;
+std::vector<std::string> Failures;
+
+/**
+ * an analysis chain of MyEventCounter modules run by the given manager.
+ * The parameters of a module are set by a function after Define().
+ */
+class CaseChain
+{
+public:
+  explicit CaseChain(ANLManager* anl) : anl_(anl) {}
+
+  void chain(const std::string& module_id,
+             std::function<void(BasicModule*)> set_parameters=nullptr)
+  {
+    modules_.emplace_back(new MyEventCounter);
+    modules_.back()->set_module_id(module_id);
+    modules_.back()->set_stage_head(stage_boundary_);
+    stage_boundary_ = false;
+    parameter_setters_.push_back(set_parameters);
+  }
+
+  /**
+   * start a new stage from the next module.
+   */
+  void stage_boundary() { stage_boundary_ = true; }
+
+  ANLManager& manager() { return *anl_; }
+
+  void run()
+  {
+    std::vector<BasicModule*> modules;
+    for (auto& mod: modules_) {
+      modules.push_back(mod.get());
+    }
+    anl_->set_modules(modules);
+    anl_->set_display_period(0);
+    anl_->Define();
+    for (std::size_t i=0; i<modules_.size(); i++) {
+      if (parameter_setters_[i]) {
+        parameter_setters_[i](modules_[i].get());
+      }
+    }
+    anl_->PreInitialize();
+    anl_->Initialize();
+    anl_->Analyze(NumEvents, false);
+    anl_->Finalize();
+  }
+
+  double result(const std::string& module_id, const std::string& name) const
+  {
+    for (const auto& mod: modules_) {
+      if (mod->module_id() == module_id) {
+        const VModuleParameter* parameter = mod->get_parameter(name);
+        if (parameter->type_name() == "double") {
+          return parameter->get_value(0.0);
+        }
+        return parameter->get_value_integer();
+      }
+    }
+    return -1.0;
+  }
+
+private:
+  std::vector<std::unique_ptr<BasicModule>> modules_;
+  std::vector<std::function<void(BasicModule*)>> parameter_setters_;
+  bool stage_boundary_ = false;
+  /* destroyed before the modules */
+  std::unique_ptr<ANLManager> anl_;
+};
+
+struct Expectation
+{
+  std::string label;
+  double value;
+  double expected;
+};
+
+/**
+ * run a case with the output of the manager discarded, and check the
+ * expectations given by the results of the chain.
+ */
+void run_case(const std::string& name,
+              CaseChain& chain,
+              std::function<std::vector<Expectation>(const CaseChain&)> expect)
+{
+  std::ofstream null_stream("/dev/null");
+  std::streambuf* cout_buffer = std::cout.rdbuf(null_stream.rdbuf());
+  bool thrown = false;
+  try {
+    chain.run();
+  }
+  catch (ANLException& ex) {
+    thrown = true;
+  }
+  std::cout.rdbuf(cout_buffer);
+
+  std::ostringstream message;
+  if (thrown) {
+    message << "exception thrown";
+  }
+  for (const Expectation& e: expect(chain)) {
+    if (e.value != e.expected) {
+      if (!message.str().empty()) { message << ", "; }
+      message << e.label << " = " << e.value << " (expected " << e.expected << ")";
+    }
+  }
+
+  if (message.str().empty()) {
+    std::cout << "PASS " << name << std::endl;
+  }
+  else {
+    Failures.push_back(name);
+    std::cout << "FAIL " << name << ": " << message.str() << std::endl;
+  }
+}
+
+/**
+ * the expectations of an order-sensitive module: every event in order,
+ * one chain at a time.
+ */
+std::vector<Expectation> in_order(const CaseChain& c, const std::string& module_id)
+{
+  return {
+    { module_id+" disorders", c.result(module_id, "num_disorders"), 0 },
+    { module_id+" overlaps", c.result(module_id, "num_overlaps"), 0 },
+  };
+}
+
+std::vector<Expectation> operator+(std::vector<Expectation> a, const std::vector<Expectation>& b)
+{
+  a.insert(a.end(), b.begin(), b.end());
+  return a;
+}
+
+void set_ordered(BasicModule* mod) { mod->set_parameter("order_sensitive", true); }
+
+/**
+ * redo once every event whose index modulo RedoPeriod is RedoIndex. The
+ * retry sleeps so that the other chains can reach the following modules.
+ */
+const long int RedoPeriod = 500;
+const long int RedoIndex = 77;
+
+void set_redo(BasicModule* mod)
+{
+  mod->set_parameter_integer("redo_index", RedoIndex);
+  mod->set_parameter_integer("redo_period", RedoPeriod);
+  mod->set_parameter("redo_delay", 200);
+}
+
+void test_schedules()
+{
+  const double index_sum = NumEvents*(NumEvents-1)/2.0;
+  const long int num_redone = (NumEvents+RedoPeriod-1-RedoIndex)/RedoPeriod;
+  const std::vector<std::pair<EventSchedule, std::string>> schedules = {
+    { EventSchedule::dynamic, "dynamic" },
+    { EventSchedule::guided, "guided" },
+    { EventSchedule::work_stealing, "work_stealing" },
+  };
+
+  for (const auto& schedule: schedules) {
+    for (long int chunk: {0l, 100l}) {
+      const std::string prefix = schedule.second + " chunk=" + std::to_string(chunk);
+      auto make_chain = [&]() {
+        ANLManagerMT* anl = new ANLManagerMT(4);
+        anl->set_event_schedule(schedule.first);
+        anl->set_chunk_size(chunk);
+        return CaseChain(anl);
+      };
+
+      {
+        CaseChain c = make_chain();
+        c.chain("Counter");
+        c.chain("Ordered", set_ordered);
+        run_case(prefix+" all events", c, [&](const CaseChain& c) {
+            return std::vector<Expectation>{
+              { "Counter events", c.result("Counter", "num_events"), double(NumEvents) },
+              { "Counter index_sum", c.result("Counter", "index_sum"), index_sum },
+              { "Ordered events", c.result("Ordered", "num_events"), double(NumEvents) },
+            } + in_order(c, "Ordered");
+          });
+      }
+
+      // all the chains stop at the quitting event, which passes in order.
+      {
+        CaseChain c = make_chain();
+        c.chain("Counter");
+        c.chain("Ordered", [](BasicModule* mod) {
+            set_ordered(mod);
+            mod->set_parameter("quit_index", 5000);
+            mod->set_parameter("quit_all", true);
+          });
+        run_case(prefix+" quit all", c, [&](const CaseChain& c) {
+            return std::vector<Expectation>{
+              { "Ordered events", c.result("Ordered", "num_events"), 5001 },
+            } + in_order(c, "Ordered");
+          });
+      }
+
+      // only the chain that quits stops; the others process the rest.
+      {
+        CaseChain c = make_chain();
+        c.chain("Ordered", [](BasicModule* mod) {
+            set_ordered(mod);
+            mod->set_parameter("quit_index", 5000);
+            mod->set_parameter("quit_all", false);
+          });
+        run_case(prefix+" quit one chain", c, [&](const CaseChain& c) {
+            return std::vector<Expectation>{
+              { "Ordered events", c.result("Ordered", "num_events"), double(NumEvents) },
+            } + in_order(c, "Ordered");
+          });
+      }
+
+      // the redone events are retried in their turns.
+      {
+        CaseChain c = make_chain();
+        c.chain("Counter", set_redo);
+        c.chain("Ordered", set_ordered);
+        run_case(prefix+" redo", c, [&](const CaseChain& c) {
+            return std::vector<Expectation>{
+              { "Counter events", c.result("Counter", "num_events"), double(NumEvents+num_redone) },
+              { "Counter redone", c.result("Counter", "num_redone"), double(num_redone) },
+              { "Ordered events", c.result("Ordered", "num_events"), double(NumEvents) },
+              { "Ordered index_sum", c.result("Ordered", "index_sum"), index_sum },
+            } + in_order(c, "Ordered");
+          });
+      }
+
+      // an order-sensitive module sees a redone event twice in a row.
+      {
+        CaseChain c = make_chain();
+        c.chain("Ordered", set_ordered);
+        c.chain("Redo", set_redo);
+        c.chain("Tail", set_ordered);
+        run_case(prefix+" redo after an ordered module", c, [&](const CaseChain& c) {
+            return std::vector<Expectation>{
+              { "Ordered events", c.result("Ordered", "num_events"), double(NumEvents+num_redone) },
+              { "Ordered overlaps", c.result("Ordered", "num_overlaps"), 0 },
+              { "Tail events", c.result("Tail", "num_events"), double(NumEvents) },
+            } + in_order(c, "Tail");
+          });
+      }
+    }
+  }
+}
+
+/**
+ * ordered head and tail stages around a body stage.
+ */
+void test_stages(ExecutionMode mode, const std::string& mode_name)
+{
+  const long int num_redone = (NumEvents+RedoPeriod-1-RedoIndex)/RedoPeriod;
+  auto make_chain = [&](std::function<void(BasicModule*)> set_body,
+                        std::function<void(BasicModule*)> set_tail) {
+    ANLManagerMT* anl = new ANLManagerMT(4);
+    anl->set_execution_mode(mode);
+    CaseChain c(anl);
+    c.chain("Head", set_ordered);
+    c.stage_boundary();
+    c.chain("Body", set_body);
+    c.stage_boundary();
+    c.chain("Tail", set_tail);
+    return c;
+  };
+
+  {
+    CaseChain c = make_chain(nullptr, set_ordered);
+    run_case(mode_name+" all events", c, [&](const CaseChain& c) {
+        return std::vector<Expectation>{
+          { "Head events", c.result("Head", "num_events"), double(NumEvents) },
+          { "Body events", c.result("Body", "num_events"), double(NumEvents) },
+          { "Tail events", c.result("Tail", "num_events"), double(NumEvents) },
+        } + in_order(c, "Head") + in_order(c, "Tail");
+      });
+  }
+
+  {
+    CaseChain c = make_chain(nullptr, [](BasicModule* mod) {
+        set_ordered(mod);
+        mod->set_parameter("quit_index", 5000);
+      });
+    run_case(mode_name+" quit", c, [&](const CaseChain& c) {
+        return std::vector<Expectation>{
+          { "Tail events", c.result("Tail", "num_events"), 5001 },
+        } + in_order(c, "Head") + in_order(c, "Tail");
+      });
+  }
+
+  // a redo re-runs only the stage of the module giving it.
+  {
+    CaseChain c = make_chain(set_redo, set_ordered);
+    run_case(mode_name+" redo", c, [&](const CaseChain& c) {
+        return std::vector<Expectation>{
+          { "Head events", c.result("Head", "num_events"), double(NumEvents) },
+          { "Body events", c.result("Body", "num_events"), double(NumEvents+num_redone) },
+          { "Tail events", c.result("Tail", "num_events"), double(NumEvents) },
+        } + in_order(c, "Head") + in_order(c, "Tail");
+      });
+  }
+}
+
+/**
+ * periodic snapshots do not change the results, also when the run quits.
+ */
+void test_snapshots()
+{
+  const double index_sum = NumEvents*(NumEvents-1)/2.0;
+  auto make_chain = [&]() {
+    ANLManagerMT* anl = new ANLManagerMT(4);
+    anl->set_snapshot_period(1000);
+    return CaseChain(anl);
+  };
+
+  {
+    CaseChain c = make_chain();
+    c.chain("Counter");
+    c.chain("Ordered", set_ordered);
+    run_case("snapshots all events", c, [&](const CaseChain& c) {
+        return std::vector<Expectation>{
+          { "snapshots taken", double(c.result("Counter", "num_snapshots") > 0), 1 },
+          { "Counter events", c.result("Counter", "num_events"), double(NumEvents) },
+          { "Counter index_sum", c.result("Counter", "index_sum"), index_sum },
+          { "Ordered events", c.result("Ordered", "num_events"), double(NumEvents) },
+        } + in_order(c, "Ordered");
+      });
+  }
+
+  {
+    CaseChain c = make_chain();
+    c.chain("Counter");
+    c.chain("Ordered", [](BasicModule* mod) {
+        set_ordered(mod);
+        mod->set_parameter("quit_index", 5000);
+      });
+    run_case("snapshots quit all", c, [&](const CaseChain& c) {
+        return std::vector<Expectation>{
+          { "snapshots taken", double(c.result("Counter", "num_snapshots") > 0), 1 },
+          { "Ordered events", c.result("Ordered", "num_events"), 5001 },
+        } + in_order(c, "Ordered");
+      });
+  }
+}
+
+/**
+ * commutable filters reordered after a warm-up pass the same events.
+ */
+void test_reordering(bool mt)
+{
+  long int num_passed = 0;
+  double passed_sum = 0.0;
+  for (long int i=0; i<NumEvents; i++) {
+    if (i%2 != 0 && i%3 != 0) {
+      num_passed++;
+      passed_sum += i;
+    }
+  }
+
+  ANLManager* anl = mt ? new ANLManagerMT(4) : new ANLManager;
+  anl->set_reordering_warmup(500);
+  CaseChain c(anl);
+  c.chain("F3", [](BasicModule* mod) {
+      mod->set_parameter("commutable_filter", true);
+      mod->set_parameter("skip_period", 3);
+    });
+  c.chain("F2", [](BasicModule* mod) {
+      mod->set_parameter("commutable_filter", true);
+      mod->set_parameter("skip_period", 2);
+    });
+  c.chain("Last");
+  run_case(std::string("reordering ")+(mt ? "mt" : "st"), c, [&](const CaseChain& c) {
+      return std::vector<Expectation>{
+        { "Last events", c.result("Last", "num_events"), double(num_passed) },
+        { "Last index_sum", c.result("Last", "index_sum"), passed_sum },
+      };
+    });
+}
+
+/**
+ * concurrent modules of an event processed on the threads of the manager;
+ * ANLManagerMT processes them one after another.
+ */
+void test_intra_event(bool mt)
+{
+  const double index_sum = NumEvents*(NumEvents-1)/2.0;
+  ANLManager* anl = mt ? new ANLManagerMT(4) : new ANLManager;
+  anl->set_intra_event_threads(3);
+  CaseChain c(anl);
+  auto set_concurrent = [](BasicModule* mod) { mod->set_parameter("concurrent", true); };
+  c.chain("C1", set_concurrent);
+  c.chain("C2", set_concurrent);
+  c.chain("C3", set_concurrent);
+  c.chain("Ordered", set_ordered);
+  run_case(std::string("intra-event ")+(mt ? "mt" : "st"), c, [&](const CaseChain& c) {
+      std::vector<Expectation> e;
+      for (const std::string id: {"C1", "C2", "C3", "Ordered"}) {
+        e.push_back({ id+" events", c.result(id, "num_events"), double(NumEvents) });
+        e.push_back({ id+" index_sum", c.result(id, "index_sum"), index_sum });
+      }
+      return e + in_order(c, "Ordered");
+    });
+}
+
+/**
+ * batches of events: the run of batch-capable modules is processed at once
+ * and the modules around it event by event, with the skip, redo and quit
+ * of each event kept.
+ */
+void test_batches(bool mt)
+{
+  const long int batch_size = 64;
+  const double index_sum = NumEvents*(NumEvents-1)/2.0;
+  const long int num_skipped = (NumEvents+2)/3;
+  const double skipped_sum = 3.0*num_skipped*(num_skipped-1)/2.0;
+  const long int num_redone = (NumEvents+RedoPeriod-1-RedoIndex)/RedoPeriod;
+  const std::string prefix = mt ? "batch mt" : "batch st";
+  auto make_chain = [&]() {
+    ANLManager* anl = mt ? new ANLManagerMT(4) : new ANLManager;
+    anl->set_batch_size(batch_size);
+    return CaseChain(anl);
+  };
+  auto set_batch = [](BasicModule* mod) { mod->set_parameter("batch", true); };
+  auto set_batch_skip = [](BasicModule* mod) {
+    mod->set_parameter("batch", true);
+    mod->set_parameter("skip_period", 3);
+  };
+
+  {
+    CaseChain c = make_chain();
+    c.chain("A", set_batch_skip);
+    c.chain("B", set_batch);
+    run_case(prefix+" all events", c, [&](const CaseChain& c) {
+        return std::vector<Expectation>{
+          { "A events", c.result("A", "num_events"), double(NumEvents) },
+          { "B events", c.result("B", "num_events"), double(NumEvents-num_skipped) },
+          { "B index_sum", c.result("B", "index_sum"), index_sum-skipped_sum },
+        };
+      });
+  }
+
+  // the modules around the segment see each event with its own index.
+  {
+    CaseChain c = make_chain();
+    c.chain("Head");
+    c.chain("A", set_batch_skip);
+    c.chain("B", set_batch);
+    c.chain("Tail");
+    run_case(prefix+" segment", c, [&](const CaseChain& c) {
+        return std::vector<Expectation>{
+          { "Head events", c.result("Head", "num_events"), double(NumEvents) },
+          { "A events", c.result("A", "num_events"), double(NumEvents) },
+          { "B events", c.result("B", "num_events"), double(NumEvents-num_skipped) },
+          { "Tail events", c.result("Tail", "num_events"), double(NumEvents-num_skipped) },
+          { "Tail index_sum", c.result("Tail", "index_sum"), index_sum-skipped_sum },
+        };
+      });
+  }
+
+  // an event redone in the segment is redone alone from the first module.
+  {
+    CaseChain c = make_chain();
+    c.chain("Head");
+    c.chain("A", set_batch);
+    c.chain("B", [&](BasicModule* mod) { set_batch(mod); set_redo(mod); });
+    c.chain("Tail");
+    run_case(prefix+" redo in segment", c, [&](const CaseChain& c) {
+        return std::vector<Expectation>{
+          { "Head events", c.result("Head", "num_events"), double(NumEvents+num_redone) },
+          { "A events", c.result("A", "num_events"), double(NumEvents+num_redone) },
+          { "B events", c.result("B", "num_events"), double(NumEvents+num_redone) },
+          { "Tail events", c.result("Tail", "num_events"), double(NumEvents) },
+          { "Tail index_sum", c.result("Tail", "index_sum"), index_sum },
+        };
+      });
+  }
+
+  // a quit in the segment truncates only the work after it.
+  if (!mt) {
+    const long int batch_end = std::min(NumEvents, (5000/batch_size+1)*batch_size);
+    CaseChain c = make_chain();
+    c.chain("Head");
+    c.chain("A", set_batch);
+    c.chain("B", [&](BasicModule* mod) {
+        set_batch(mod);
+        mod->set_parameter("quit_index", 5000);
+      });
+    c.chain("Tail");
+    run_case(prefix+" quit in segment", c, [&](const CaseChain& c) {
+        return std::vector<Expectation>{
+          { "Head events", c.result("Head", "num_events"), double(batch_end) },
+          { "A events", c.result("A", "num_events"), double(batch_end) },
+          { "B events", c.result("B", "num_events"), 5001 },
+          { "Tail events", c.result("Tail", "num_events"), 5000 },
+        };
+      });
+  }
+}
+
+} /* anonymous namespace */
+
+int main(int argc, char** argv)
+{
+  if (argc >= 2) {
+    NumEvents = std::atol(argv[1]);
+  }
+
+  test_schedules();
+  test_stages(ExecutionMode::pipeline, "pipeline");
+  test_stages(ExecutionMode::farm, "farm");
+  test_snapshots();
+  test_reordering(false);
+  test_reordering(true);
+  test_intra_event(false);
+  test_intra_event(true);
+  test_batches(false);
+  test_batches(true);
+
+  std::cout << std::endl;
+  if (Failures.empty()) {
+    std::cout << "All cases passed." << std::endl;
+    return 0;
+  }
+  std::cout << Failures.size() << " case(s) failed:" << std::endl;
+  for (const std::string& name: Failures) {
+    std::cout << "  " << name << std::endl;
+  }
+  return 1;
+}
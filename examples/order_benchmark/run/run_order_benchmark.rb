@@ -0,0 +1,36 @@
+#!/usr/bin/env ruby
+
+require 'benchmark'
+require 'anlnext'
+require 'orderBenchmark'
+
+# A chain of "expensive calculation -> cheap ordered output".
+class MyApp < ANL::ANLApp
+  def setup()
+    add_namespace OrderBenchmark
+
+    chain :OrderedWork, :Calculation
+    with_parameters(work: 2000,
+                    order_sensitive: false)
+
+    chain :OrderedWork, :Output
+    with_parameters(work: 200,
+                    order_sensitive: true)
+  end
+end
+
+num_events = (ARGV[0] || 200000).to_i
+
+results = [2, 4, 8, 16, 32, 64].map do |n|
+  a = MyApp.new
+  a.num_parallels = n
+  a.display_period = 0
+  a.console = false
+  t = Benchmark.realtime { a.run(num_events) }
+  [n, t]
+end
+
+puts "N    real [s]    events/s"
+results.each do |n, t|
+  puts format("%-4d %10.3f %11.0f", n, t, num_events/t)
+end
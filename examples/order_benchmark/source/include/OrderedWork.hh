@@ -0,0 +1,36 @@
+/**
+ * OrderedWork: a module that consumes CPU time for each event.
+ * If order_sensitive is true, events are processed in order of the loop index.
+ *
+ * @author Hirokazu Odaka
+ * @date 2026-10-17
+ *
+ */
+
+#ifndef OrderedWork_H
+#define OrderedWork_H 1
+
+#include <anlnext/BasicModule.hh>
+
+class OrderedWork : public anlnext::BasicModule
+{
+  DEFINE_ANL_MODULE(OrderedWork, 1.0);
+  ENABLE_PARALLEL_RUN();
+public:
+  OrderedWork();
+
+protected:
+  OrderedWork(const OrderedWork& r) = default;
+
+public:
+  anlnext::ANLStatus mod_define() override;
+  anlnext::ANLStatus mod_pre_initialize() override;
+  anlnext::ANLStatus mod_analyze() override;
+
+private:
+  int work_ = 1000;
+  bool order_sensitive_ = false;
+  double sum_ = 0.0;
+};
+
+#endif /* OrderedWork_H */
@@ -0,0 +1,15 @@
+%module orderBenchmark
+%{
+#include <anlnext/BasicModule.hh>
+
+// include headers of my modules
+#include "OrderedWork.hh"
+  
+%}
+
+%import(module="anlnext/ANL") "anlnext/ruby/ANL.i"
+
+
+// interface to my modules
+
+class OrderedWork : public anlnext::BasicModule {};
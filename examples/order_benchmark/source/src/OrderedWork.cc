@@ -0,0 +1,33 @@
+#include "OrderedWork.hh"
+
+using namespace anlnext;
+
+OrderedWork::OrderedWork()
+{
+}
+
+ANLStatus OrderedWork::mod_define()
+{
+  define_parameter("work", &mod_class::work_);
+  set_parameter_description("Number of iterations of a dummy calculation per event.");
+  define_parameter("order_sensitive", &mod_class::order_sensitive_);
+  set_parameter_description("If true, events are processed in order of the loop index.");
+  return AS_OK;
+}
+
+ANLStatus OrderedWork::mod_pre_initialize()
+{
+  set_order_sensitive(order_sensitive_);
+  return AS_OK;
+}
+
+ANLStatus OrderedWork::mod_analyze()
+{
+  double x = static_cast<double>(get_loop_index());
+  for (int i=0; i<work_; i++) {
+    x = x*0.999 + 1.0/(i+1.0);
+  }
+  sum_ += x;
+
+  return AS_OK;
+}
@@ -0,0 +1,84 @@
+/**
+ * Micro benchmark of the order keepers used for order-sensitive modules.
+ * Each thread takes an event index, does some work outside the ordered
+ * section, and then passes a KeeperBlock like ANLManagerMT does.
+ *
+ * usage: sequencer_benchmark [num_events] [work] [max_threads]
+ *
+ * @author Hirokazu Odaka
+ * @date 2026-10-17
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <vector>
+
+#include <anlnext/OrderKeeper.hh>
+#include <anlnext/Sequencer.hh>
+
+namespace
+{
+
+double dummy_work(long int index, int work)
+{
+  double x = static_cast<double>(index);
+  for (int i=0; i<work; i++) {
+    x = x*0.999 + 1.0/(i+1.0);
+  }
+  return x;
+}
+
+template <typename KeeperType>
+double measure(int num_threads, long int num_events, int work)
+{
+  KeeperType keeper;
+  std::atomic<long int> counter(0);
+  std::vector<double> sums(num_threads, 0.0);
+
+  const auto t0 = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int t=0; t<num_threads; t++) {
+    threads.emplace_back([&, t](){
+        while (true) {
+          const long int index = counter.fetch_add(1);
+          if (index >= num_events) { break; }
+          sums[t] += dummy_work(index, work);
+          const anlnext::KeeperBlock<KeeperType, long int> block(&keeper, index);
+          sums[t] += dummy_work(index, work/10);
+        }
+      });
+  }
+  for (std::thread& th: threads) {
+    th.join();
+  }
+  const auto t1 = std::chrono::steady_clock::now();
+
+  const double seconds = std::chrono::duration<double>(t1-t0).count();
+  return num_events/seconds;
+}
+
+} /* anonymous namespace */
+
+int main(int argc, char** argv)
+{
+  const long int num_events = (argc>1) ? std::atol(argv[1]) : 200000;
+  const int work = (argc>2) ? std::atoi(argv[2]) : 1000;
+  const int max_threads = (argc>3) ? std::atoi(argv[3]) : 64;
+
+  std::cout << "events: " << num_events << ", work: " << work
+            << ", hardware threads: " << std::thread::hardware_concurrency() << '\n'
+            << "threads    OrderKeeper [ev/s]    Sequencer [ev/s]\n";
+  for (int n=2; n<=max_threads; n*=2) {
+    const double rate_keeper = measure<anlnext::OrderKeeper>(n, num_events, work);
+    const double rate_sequencer = measure<anlnext::Sequencer>(n, num_events, work);
+    std::cout << std::setw(7) << n
+              << std::setw(22) << std::fixed << std::setprecision(0) << rate_keeper
+              << std::setw(20) << rate_sequencer << std::endl;
+  }
+
+  return 0;
+}
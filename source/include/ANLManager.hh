@@ -37,14 +37,22 @@
 #include "ANLStatus.hh"
 #include "ANLException.hh"
 #include "LoopCounter.hh"
+#include "EvsIndex.hh"
+#include "ExecutionPlan.hh"
+#include "DependencyGraph.hh"
+#include "ModuleTiming.hh"
+#include "PerfCounters.hh"
+#include "EventStatistics.hh"
 
 namespace anlnext
 {
 
 class EvsManager;
+class EventStore;
 class ModuleAccess;
 class BasicModule;
-class OrderKeeper;
+class Sequencer;
+class WorkerThreadPool;
 
 /**
  * The ANL Next manager class.
@@ -57,6 +65,17 @@ class OrderKeeper;
  * @date 2017-07-07 | rename methods
  * @date 2017-07-19 | introduce user request, modify print messages.
  * @date 2019-12-25 | add module results feature
+ * @date 2026-10-17 | EVS index output and event selection
+ * @date 2026-10-17 | execution plan
+ * @date 2026-10-17 | batches
+ * @date 2026-10-17 | event data store
+ * @date 2026-10-17 | dependency graph
+ * @date 2026-10-17 | filter reordering
+ * @date 2026-10-17 | intra-event concurrency
+ * @date 2026-10-17 | module timing
+ * @date 2026-10-17 | latency histograms and throughput
+ * @date 2026-10-17 | trace export
+ * @date 2026-10-17 | hardware performance counters
  */
 class ANLManager
 {
@@ -81,6 +100,123 @@ public:
 
   long int number_of_loops() const { return num_events_; }
 
+  /**
+   * write the final EVS flags of the events processed by each Analyze() into
+   * an index file (see EvsIndex). An empty name disables it.
+   */
+  void set_evs_index_output(const std::string& filename) { evs_index_output_ = filename; }
+  std::string evs_index_output() const { return evs_index_output_; }
+
+  /**
+   * process only the events in an EVS index file that satisfy an expression
+   * of EVS keys (see EvsIndex) in the following Analyze() calls. The number
+   * of events given to Analyze() then counts the selected events (negative
+   * for all of them). The modules are given the original loop indices, so a
+   * module reading input must read the event of its loop index.
+   */
+  void set_event_selection(const std::string& index_file, const std::string& expression);
+  void clear_event_selection();
+
+  /**
+   * @return the loop index of the i-th event to be processed.
+   */
+  long int event_index(long int i_position) const
+  { return event_selection_ ? event_selection_->at(i_position) : i_position; }
+
+  /**
+   * set the maximum number of events given to BasicModule::mod_analyze_batch()
+   * at once. Batches are used for the longest run of modules supporting
+   * them in a chain (see ExecutionPlan), and not while the EVS index is
+   * recorded, since the EVS flags are not kept per event in batches; 0 or 1
+   * disables them.
+   */
+  void set_batch_size(long int v) { batch_size_ = v; }
+  long int batch_size() const { return batch_size_; }
+
+  /**
+   * set the number of events in which the commutable filters are measured
+   * before they are reordered (see ExecutionPlan); 0 disables reordering.
+   * It takes effect when the execution plans are built by Initialize().
+   * In ANLManagerMT, all the parallel chains take the order of the chain
+   * that finishes its warm-up first.
+   */
+  void set_reordering_warmup(long int v) { reordering_warmup_ = v; }
+  long int reordering_warmup() const { return reordering_warmup_; }
+
+  /**
+   * set the number of threads on which the independent concurrent modules
+   * of an event are processed (see BasicModule::mod_analyze_is_concurrent()
+   * and ExecutionPlan); 0 or 1 disables it. It takes effect when the
+   * execution plans are built by Initialize(), and only for the events that
+   * are not processed as batches. ANLManagerMT does not support it, since
+   * its chains already process events in parallel; it prints a warning and
+   * processes the modules of an event one after another.
+   * Every group of two or more modules is handed to the thread pool and
+   * waited for, which costs some ten microseconds per group, so it pays only
+   * if each module of a group takes much longer than that.
+   */
+  void set_intra_event_threads(int v) { intra_event_threads_ = v; }
+  int intra_event_threads() const { return intra_event_threads_; }
+
+  /**
+   * enable or disable the timing of the mod_*() calls (see ModuleTiming).
+   * It can be switched at any time, also during the event loop; the time
+   * measured is shown by print_summary() and parameters_to_property_tree().
+   */
+  void set_module_timing(bool v) { ModuleTiming::set_enabled(v); }
+  bool module_timing() const { return ModuleTiming::is_enabled(); }
+
+  /**
+   * trace the execution into a Chrome trace JSON file (see Tracer), which
+   * is written by Finalize(). The module calls of the events from
+   * first_event to last_event (no upper limit if negative) are traced every
+   * period events; the lifecycle phases and the reduction are always traced.
+   * Call it before Define() to trace all the phases, and never while
+   * Analyze() is running.
+   */
+  void set_trace(const std::string& filename,
+                 long int first_event=0, long int last_event=-1, long int period=1);
+  const std::string& trace_output() const { return trace_output_; }
+
+  /**
+   * count the hardware events (cycles, instructions, cache misses and branch
+   * misses) of mod_analyze() of each module (see PerfCounters). If the
+   * counters are not available, the reason is printed and they stay off.
+   * @return true if the counters are switched as requested
+   */
+  bool set_perf_counters(bool v) { return PerfCounters::set_enabled(v); }
+  bool perf_counters() const { return PerfCounters::is_enabled(); }
+
+  /**
+   * @return the timing of module i summed over the parallel chains.
+   */
+  virtual ModuleTiming total_module_timing(std::size_t i) const;
+
+  /**
+   * @return the hardware event counts of module i summed over the parallel chains.
+   */
+  virtual ModuleCounters total_perf_counters(std::size_t i) const;
+
+  /**
+   * count the events put into the chain and the events that have passed all
+   * the modules, summed over the parallel chains. They are counted by the
+   * execution plans, since the module processed first or last may change
+   * when the filters are reordered.
+   */
+  virtual void count_put_and_get(long int& put, long int& get) const;
+
+  /**
+   * @return the latency of the events and the throughput summed over the
+   * parallel chains, recorded while the module timing is on.
+   */
+  virtual EventStatistics total_event_statistics() const;
+
+  /**
+   * the dependencies between the modules of the chain, built by Initialize()
+   * from the module handles and the event data bindings.
+   */
+  const DependencyGraph& dependency_graph() const { return dependency_graph_; }
+
   void set_display_period(long int v) { display_period_ = v; }
   long int display_period() const;
 
@@ -119,11 +255,38 @@ protected:
   virtual void print_parameters();
   virtual void print_results();
   virtual void reset_counters();
+  virtual void stop_dependency_recording();
   virtual ANLStatus process_analysis();
+
+  /**
+   * the event loop of a single chain, which handles the user requests, the
+   * redo status and the exceptions. process_events(i_position, i_event, status)
+   * processes the event(s) from i_position and returns the number of events
+   * processed, setting the status of the last one.
+   */
+  template <typename EventFunc>
+  ANLStatus event_loop(EventFunc process_events);
+
   void print_summary();
+  void print_concurrent_groups();
+  void print_module_timing();
+  void print_perf_counters();
+
+  /**
+   * print the latency histograms of the events and of mod_analyze() of the
+   * modules, and the throughput of the last minute.
+   */
+  void print_latency();
+  void write_evs_index();
 
   int module_index(const std::string& module_id, bool strict=true) const;
 
+  /**
+   * @return the number of events from i_position that can be processed as a
+   * batch by plan; 1 if batches are not used.
+   */
+  long int batch_length(long int i_position, ExecutionPlan& plan) const;
+
 #if ANLNEXT_ENABLE_INTERACTIVE_MODE
   void interactive_comunication_help();
   ANLStatus interactive_modify_param(int n);
@@ -134,8 +297,10 @@ protected:
 
 private:
   virtual void duplicate_chains() {}
+  virtual void build_execution_plans();
   virtual ANLStatus reduce_modules() { return AS_OK; }
   virtual void reduce_statistics() {}
+  virtual void print_load_balance() {}
 
   // thread mode
 private:
@@ -147,13 +312,26 @@ protected:
   long int num_events_ = 0;
   std::vector<BasicModule*> modules_;
   std::vector<LoopCounter> counters_;
+  ExecutionPlan execution_plan_;
+  EventStatistics event_statistics_;
+  ModuleTiming::Clock::time_point statistics_origin_;
+  DependencyGraph dependency_graph_;
   std::unique_ptr<EvsManager> evs_manager_;
+  std::unique_ptr<EventStore> event_store_;
   std::mutex mutex_;
   std::atomic<ANLRequest> requested_{ANLRequest::none};
   bool exception_propagation_ = true;
 
 private:
   long int display_period_ = -1;
+  long int batch_size_ = 256;
+  long int reordering_warmup_ = 1000;
+  int intra_event_threads_ = 0;
+  std::unique_ptr<WorkerThreadPool> intra_event_pool_;
+  std::string evs_index_output_;
+  std::string trace_output_;
+  std::unique_ptr<EventSet> event_selection_;
+  std::string event_selection_expression_;
   std::unique_ptr<ModuleAccess> module_access_;
   std::atomic<bool> analysis_thread_finished_{false};
 };
@@ -167,18 +345,62 @@ ANLStatus routine_modfn(T func,
                         const std::string& func_id,
                         const std::vector<BasicModule*>& modules);
 
+/**
+ * call mod_analyze() of the module of a step unless its EVS gate is closed.
+ */
+ANLStatus process_step(long int i_event, const ExecutionPlan::Step& step);
+
+/**
+ * process the steps of a group of a concurrent plan on its thread pool.
+ * Every step of the group is processed; the status is that of the first
+ * step in the group which does not return AS_OK.
+ */
+ANLStatus process_group(long int i_event, const ExecutionPlan::Group& group, ExecutionPlan& plan);
+
 ANLStatus process_one_event(long int i_event,
-                            const std::vector<BasicModule*>& modules,
-                            std::vector<LoopCounter>& counters,
-                            EvsManager& evsManager);
+                            ExecutionPlan& plan,
+                            EvsManager& evs_manager,
+                            EventStore& event_store);
 
+/**
+ * process one event passing the order keepers of the plan in the order of i_order.
+ * The keepers entered are held until the event is finished. An event redone
+ * by AS_REDO is retried here, in its turn, so AS_REDO is never returned.
+ * An event given AS_QUIT_ALL lowers quit_order to i_order; an event after it
+ * is stopped at the first keeper, not counted, and given AS_QUIT_ALL.
+ */
 ANLStatus process_one_event(long int i_event,
-                            const std::vector<BasicModule*>& modules,
-                            std::vector<LoopCounter>& counters,
+                            ExecutionPlan& plan,
                             EvsManager& evs_manager,
-                            std::vector<std::unique_ptr<OrderKeeper>>& order_keepers);
+                            EventStore& event_store,
+                            long int i_order,
+                            std::atomic<long int>& quit_order);
+
+/**
+ * process the events [first_event, first_event+n) of a batchable plan. The
+ * steps before the batch segment are processed event by event for all the
+ * events, then the segment by mod_analyze_batch(), and then the steps after
+ * it event by event. An event given AS_REDO is redone from the first step
+ * alone. The batch is cut after the first event that quits or has a critical
+ * error: if it is cut before the segment, the following events are left to
+ * the following loop; otherwise they have been processed by some steps and
+ * are dropped, neither passed on nor counted as events.
+ * The EVS flags are not counted; the events are counted as unflagged.
+ * @param status the status of the last event processed
+ * @return the number of events consumed, including those dropped
+ */
+long int process_event_batch(long int first_event, long int n,
+                             ExecutionPlan& plan,
+                             EvsManager& evs_manager,
+                             EventStore& event_store,
+                             ANLStatus& status);
+
+void count_evs(long int i_event, ANLStatus status, EvsManager& evs_manager);
 
-void count_evs(ANLStatus status, EvsManager& evs_manager);
+/**
+ * compile the EVS gates of the modules against the EVS of their chain.
+ */
+void compile_evs_gates(const std::vector<BasicModule*>& modules);
 
 inline void print_event_index(long int index, std::ostream& os=std::cout)
 {
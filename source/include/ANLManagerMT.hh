@@ -22,12 +22,30 @@
 
 #include "ANLManager.hh"
 #include <future>
+#include <chrono>
 
 #include "ClonedChainSet.hh"
+#include "EventDispatcher.hh"
+#include "WorkerThreadPool.hh"
+#include "ThreadAffinity.hh"
+#include "BoundedQueue.hh"
 
 namespace anlnext
 {
 
+/**
+ * How ANLManagerMT runs the module chain in parallel.
+ * event_parallel: each thread runs a cloned chain on different events.
+ * pipeline: module groups (stages) run on dedicated threads, and events flow through them.
+ * farm: the head stage runs on one thread, the middle stages run on cloned
+ *   chains, and the tail stage receives the events back in order.
+ */
+enum class ExecutionMode {
+  event_parallel,
+  pipeline,
+  farm,
+};
+
 class EvsManager;
 class ModuleAccess;
 class BasicModule;
@@ -37,6 +55,18 @@ class BasicModule;
  *
  * @author Hirokazu Odaka
  * @date 2017-07-05
+ * @date 2026-10-17 | chunked event dispatch
+ * @date 2026-10-17 | persistent worker threads
+ * @date 2026-10-17 | pipeline mode
+ * @date 2026-10-17 | farm mode
+ * @date 2026-10-17 | parallel routines of cloned chains
+ * @date 2026-10-17 | tree reduction
+ * @date 2026-10-17 | periodic snapshots of the results
+ * @date 2026-10-17 | thread affinity
+ * @date 2026-10-17 | module timing
+ * @date 2026-10-17 | event statistics
+ * @date 2026-10-17 | load balance and contention report
+ * @date 2026-10-17 | hardware performance counters
  */
 class ANLManagerMT : public ANLManager
 {
@@ -44,12 +74,107 @@ public:
   explicit ANLManagerMT(int num_parallels=1);
   virtual ~ANLManagerMT();
 
-  int number_of_parallels() const override { return num_parallels_; }
+  int number_of_parallels() const override
+  { return (execution_mode_ == ExecutionMode::pipeline) ? 1 : num_parallels_; }
   BasicModule* access_to_module(int chain_ID,
                                 const std::string& module_ID) override;
 
+  void set_event_schedule(EventSchedule v) { dispatcher_.set_schedule(v); }
+  EventSchedule event_schedule() const { return dispatcher_.schedule(); }
+
+  /**
+   * set the number of events that a thread takes at once. It is ignored
+   * (1) when any module is order sensitive.
+   * @param v chunk size; 0 for automatic
+   */
+  void set_chunk_size(long int v) { dispatcher_.set_chunk_size(v); }
+  long int chunk_size() const { return dispatcher_.chunk_size(); }
+
+  /**
+   * set the execution mode. This must be called before PreInitialize().
+   *
+   * In the pipeline mode, the chain is not duplicated. A module marked by
+   * BasicModule::set_stage_head() starts a new stage, and each stage runs on
+   * its own thread. Every stage calls mod_analyze() in strict event order,
+   * so modules in the pipeline mode need not be clonable nor order-aware.
+   * Data passed from a module to a module in a later stage must be kept per
+   * event (e.g. in a buffer indexed by the loop index) since the earlier stage
+   * may already be working on the next events.
+   *
+   * In the farm mode, the modules before the first stage head form the head
+   * stage, which runs on a single thread; the modules from the last stage head
+   * (when there are three stages or more) form the tail stage, which receives
+   * events in order through a reorder buffer. The modules in between run on
+   * number_of_parallels() cloned chains that never wait for each other; only
+   * these modules need to be clonable. The same rule on per-event data as in
+   * the pipeline mode applies.
+   *
+   * In both modes, AS_REDO re-runs only the stage of the module that gives it,
+   * from the first module of that stage; the earlier stages have already
+   * passed the event on and are not re-run. Unlike in the single-thread and
+   * event-parallel modes, a module redrawing an event on a redo (e.g. an
+   * event generator) must be in the same stage as the module giving AS_REDO.
+   */
+  void set_execution_mode(ExecutionMode v) { execution_mode_ = v; }
+  ExecutionMode execution_mode() const { return execution_mode_; }
+
+  /**
+   * set the maximum number of events being processed at once in the pipeline
+   * mode or the farm mode. In the farm mode, this is the size of the reorder window.
+   */
+  void set_pipeline_depth(int v) { pipeline_depth_ = v; }
+  int pipeline_depth() const { return pipeline_depth_; }
+
+  /**
+   * run the routines (initialize, begin_run, end_run, finalize) of the cloned
+   * chains concurrently. The master chain always runs its routines first,
+   * alone. Enable this only if these routines of the modules are thread safe.
+   * The modules are cloned one by one, except that the modules whose
+   * BasicModule::mod_clone_is_thread_safe() returns true are cloned
+   * concurrently with each other.
+   */
+  void set_parallel_routines(bool v=true) { parallel_routines_ = v; }
+  bool parallel_routines() const { return parallel_routines_; }
+
+  /**
+   * take a snapshot of the module results every num_events events or every
+   * seconds seconds during the analysis loop; 0 disables each trigger.
+   * Only the modules that support snapshots (see BasicModule::mod_snapshot())
+   * are included. Each thread adds its chain to the snapshot between events,
+   * so the threads are not stopped. A completed snapshot is printed, and
+   * print_results() shows the latest one while the loop is running.
+   * A snapshot can also be requested by '.r' from the console.
+   * Snapshots are taken only in the event-parallel mode.
+   */
+  void set_snapshot_period(long int num_events, double seconds=0.0)
+  {
+    snapshot_period_events_ = num_events;
+    snapshot_period_seconds_ = seconds;
+  }
+  long int snapshot_period_events() const { return snapshot_period_events_; }
+  double snapshot_period_seconds() const { return snapshot_period_seconds_; }
+
+  /**
+   * bind each analysis thread to a CPU. This must be called before Initialize().
+   * When a policy is set, the routines (initialize, begin_run, end_run,
+   * finalize) of each chain run on the thread that runs the chain in the
+   * analysis loop, so that memory allocated there is local to the thread.
+   * The chains still run these routines one by one unless
+   * set_parallel_routines() is enabled.
+   */
+  void set_affinity_policy(AffinityPolicy v) { affinity_.set_policy(v); }
+  AffinityPolicy affinity_policy() const { return affinity_.policy(); }
+
+  /**
+   * bind thread i to the i-th CPU of the list (the cpu_list policy).
+   */
+  void set_cpu_list(const std::vector<int>& v) { affinity_.set_cpu_list(v); }
+  std::vector<int> cpu_list() const { return affinity_.cpu_list(); }
+
 protected:
   void clone_modules(int chain_ID);
+  void clone_modules_in_parallel();
+  void add_cloned_chain(int chain_ID, std::vector<std::unique_ptr<BasicModule>>&& clones);
 
   ANLStatus routine_initialize() override;
   ANLStatus routine_begin_run() override;
@@ -62,25 +187,150 @@ protected:
   
   ANLStatus process_analysis() override;
   virtual void process_analysis_in_each_thread(int i_thread, std::promise<ANLStatus> status_promise);
-  virtual long int event_index_to_process();
-  void decrement_event_index();
+  virtual long int event_index_to_process(int i_thread);
+  void decrement_event_index(int i_thread);
 
   boost::property_tree::ptree parameters_to_property_tree() const override;
+  ModuleTiming total_module_timing(std::size_t i) const override;
+  ModuleCounters total_perf_counters(std::size_t i) const override;
+  void count_put_and_get(long int& put, long int& get) const override;
+  EventStatistics total_event_statistics() const override;
 
 private:
+  int number_of_threads() const;
+  int thread_for_chain(int chain_ID) const;
+  void start_thread_pool();
+  void bind_threads();
+  ANLStatus run_on_thread(int i_thread, const std::function<ANLStatus()>& func);
+  ANLStatus routine_master_chain(const std::function<ANLStatus()>& func);
+  template <typename T>
+  ANLStatus routine_cloned_chains(T func, const std::string& func_id);
+
   void duplicate_chains() override;
+  void build_execution_plans() override;
+  void stop_dependency_recording() override;
   void automatic_switch_for_singletons();
-  ANLStatus process_analysis_impl(const std::vector<BasicModule*>& modules,
+  ANLStatus process_analysis_impl(int i_thread,
+                                  const std::vector<BasicModule*>& modules,
                                   std::vector<LoopCounter>& counters,
-                                  EvsManager& evs_manager);
+                                  EvsManager& evs_manager,
+                                  EventStore& event_store,
+                                  ExecutionPlan& plan);
   ANLStatus reduce_modules() override;
+  ANLStatus merge_in_tree(const std::vector<BasicModule*>& modules);
   void reduce_statistics() override;
 
+  /**
+   * print the events, busy time and idle time at the end of the run of each
+   * chain, the wait time at the order keepers and the dispatcher lock wait
+   * of the last event-parallel run, with a verdict on each. The busy time of
+   * a chain excludes its waits at the keepers and the dispatcher locks.
+   */
+  void print_load_balance() override;
+
+  void setup_snapshot();
+  void reset_snapshot();
+  bool snapshot_is_due(long int i_event) const;
+  void request_snapshot(long int i_event);
+  void contribute_to_snapshot(int i_thread,
+                              const std::vector<BasicModule*>& modules,
+                              const std::vector<LoopCounter>& counters,
+                              bool finished);
+  void add_to_snapshot(const std::vector<BasicModule*>& modules,
+                       const std::vector<LoopCounter>& counters);
+  void print_snapshot() const;
+
+  struct PipelineToken
+  {
+    long int position = 0;
+    long int index = 0;
+    ANLStatus status = AS_OK;
+    bool end = false;
+    bool discarded = false;
+    ModuleTiming::Clock::time_point start;
+    std::vector<char> evs_flags;
+    std::unique_ptr<EventStore> event_store;
+  };
+
+  struct ChainLoad
+  {
+    long int events = 0;
+    ModuleTiming::Clock::time_point start;
+    ModuleTiming::Clock::time_point finish;
+    std::chrono::nanoseconds keeper_wait{0};
+    char padding[64];
+  };
+
+  struct PipelineStage
+  {
+    std::vector<BasicModule*> modules;
+    std::size_t first_module = 0;
+    std::unique_ptr<EvsManager> evs_manager;
+    ExecutionPlan plan;
+    std::unique_ptr<BoundedQueue<PipelineToken*>> input;
+    std::exception_ptr exception;
+  };
+
+  void setup_pipeline();
+  void setup_farm();
+  void prepare_pipeline_run(std::size_t queue_capacity);
+  void finish_pipeline_run();
+  ANLStatus process_analysis_pipeline();
+  ANLStatus process_pipeline_stage(std::size_t i_stage);
+  ANLStatus process_analysis_farm();
+  ANLStatus process_farm_head();
+  void process_farm_worker(int i_worker);
+  ANLStatus process_farm_tail();
+  PipelineToken* generate_token(bool stop, long int& next_index);
+  void handle_request(long int i_event);
+  void record_token(const PipelineToken* token);
+  void process_token(PipelineToken* token,
+                     ExecutionPlan& plan,
+                     EvsManager& evs_manager,
+                     bool reset_evs,
+                     std::exception_ptr& exception);
+  bool check_token_to_stop(const PipelineToken* token, ANLStatus& stage_status);
+
 private:
   const int num_parallels_ = 1;
-  long int loop_index_ = -1;
+  ExecutionMode execution_mode_ = ExecutionMode::event_parallel;
+  int pipeline_depth_ = 64;
+  bool parallel_routines_ = false;
+  EventDispatcher dispatcher_;
   std::vector<ClonedChainSet> cloned_chains_;
-  std::vector<std::unique_ptr<OrderKeeper>> order_keepers_;
+  std::size_t cloned_begin_ = 0;
+  std::size_t cloned_end_ = 0;
+  std::vector<std::unique_ptr<Sequencer>> order_keepers_;
+  /* the order of the first event which has quit all the chains */
+  std::atomic<long int> quit_order_{0};
+  std::vector<ChainLoad> chain_loads_;
+  ModuleTiming::Clock::time_point run_start_;
+  std::vector<PipelineStage> stages_;
+  std::vector<PipelineToken> tokens_;
+  std::unique_ptr<BoundedQueue<PipelineToken*>> free_tokens_;
+  std::unique_ptr<std::atomic<PipelineToken*>[]> reorder_buffer_;
+  std::vector<std::exception_ptr> worker_exceptions_;
+  std::atomic<bool> pipeline_stopped_{false};
+  long int snapshot_period_events_ = 0;
+  double snapshot_period_seconds_ = 0.0;
+  bool snapshot_enabled_ = false;
+  std::vector<std::unique_ptr<BasicModule>> snapshot_building_;
+  std::vector<std::unique_ptr<BasicModule>> snapshot_published_;
+  long int snapshot_building_events_ = 0;
+  long int snapshot_published_events_ = -1;
+  bool snapshot_building_ok_ = true;
+  int snapshot_contributors_ = 0;
+  std::atomic<long int> snapshot_requested_{0};
+  std::atomic<long int> snapshot_completed_{0};
+  std::vector<long int> snapshot_contributed_;
+  std::vector<std::pair<const std::vector<BasicModule*>*, const std::vector<LoopCounter>*>> snapshot_finished_chains_;
+  std::atomic<long int> next_snapshot_event_{0};
+  std::atomic<std::chrono::steady_clock::rep> next_snapshot_time_{0};
+  std::atomic<bool> analysis_running_{false};
+  mutable std::mutex snapshot_mutex_;
+  ThreadAffinity affinity_;
+  bool threads_bound_ = false;
+  WorkerThreadPool thread_pool_;
 };
 
 } /* namespace anlnext */
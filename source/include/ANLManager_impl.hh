@@ -23,6 +23,7 @@
 #include "ANLManager.hh"
 #include "BasicModule.hh"
 #include "ANLException.hh"
+#include "Tracer.hh"
 
 namespace anlnext
 {
@@ -83,17 +84,135 @@ ANLStatus routine_modfn(T func,
   return AS_OK;
 }
 
+template <typename EventFunc>
+ANLStatus ANLManager::event_loop(EventFunc process_events)
+{
+  ANLStatus status = AS_OK;
+
+  const long int period_disp = display_period();
+  const long int num_events = number_of_loops();
+
+  try {
+    for (long int i_position=0; i_position!=num_events; i_position++) {
+      long int i_event = event_index(i_position);
+      if (period_disp != 0 && i_position%period_disp == 0) {
+        print_event_index(i_event);
+      }
+
+      const bool timing = ModuleTiming::is_enabled();
+      const ModuleTiming::Clock::time_point t0 = timing ? ModuleTiming::Clock::now() : ModuleTiming::Clock::time_point();
+      const long int done = process_events(i_position, i_event, status);
+      if (timing && status != AS_REDO) {
+        const ModuleTiming::Clock::time_point t1 = ModuleTiming::Clock::now();
+        event_statistics_.record(t1-t0, done, t1-statistics_origin_);
+      }
+      if (done > 1) {
+        for (long int k=1; k<done; k++) {
+          if (period_disp != 0 && (i_position+k)%period_disp == 0) {
+            print_event_index(event_index(i_position+k));
+          }
+        }
+        i_position += done-1;
+        i_event = event_index(i_position);
+      }
+
+      if (is_critical_error(status)) {
+        return status;
+      }
+
+      if (status==AS_QUIT || status==AS_QUIT_ALL) {
+        break;
+      }
+
+      if (requested_ != ANLRequest::none) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (requested_ == ANLRequest::quit) {
+          break;
+        }
+        else if (requested_ == ANLRequest::show_event_index) {
+          print_event_index(i_event);
+        }
+        else if (requested_ == ANLRequest::show_evs_summary) {
+          print_event_index(i_event);
+          evs_manager_->print_summary();
+        }
+        else if (requested_ == ANLRequest::show_results) {
+          print_event_index(i_event);
+          print_results();
+        }
+        else if (requested_ == ANLRequest::show_latency) {
+          print_event_index(i_event);
+          print_latency();
+        }
+        requested_ = ANLRequest::none;
+      }
+
+      if (status==ANLStatus::skip) {
+        ;
+      }
+      else if (status==ANLStatus::redo) {
+        i_position--;
+      }
+    }
+  }
+  catch (ANLException& ex) {
+    if (const ANLException::Treatment* t = boost::get_error_info<ExceptionTreatment>(ex)) {
+      if (*t == ANLException::Treatment::rethrow) {
+        throw;
+      }
+      else if (*t == ANLException::Treatment::finalize) {
+        print_exception(ex);
+        return ANLStatus::critical_error_to_finalize_from_exception;
+      }
+      else if (*t == ANLException::Treatment::terminate) {
+        print_exception(ex);
+        return ANLStatus::critical_error_to_terminate_from_exception;
+      }
+      else if (*t == ANLException::Treatment::hard_terminate) {
+        print_exception(ex);
+        std::terminate();
+      }
+    }
+    throw;
+  }
+
+  return AS_OK;
+}
+
+inline ModulePhase routine_phase(ANLStatus (BasicModule::*func)())
+{
+  if (func == &BasicModule::mod_define) { return ModulePhase::define; }
+  if (func == &BasicModule::mod_pre_initialize) { return ModulePhase::pre_initialize; }
+  if (func == &BasicModule::mod_initialize) { return ModulePhase::initialize; }
+  if (func == &BasicModule::mod_begin_run) { return ModulePhase::begin_run; }
+  if (func == &BasicModule::mod_end_run) { return ModulePhase::end_run; }
+  return ModulePhase::finalize;
+}
+
 template<typename T>
 ANLStatus routine_modfn_impl(T func,
                              const std::string& func_id,
                              const std::vector<BasicModule*>& modules)
 {
+  const bool timing = ModuleTiming::is_enabled();
+  const bool traced = Tracer::is_enabled();
+  const ModulePhase phase = routine_phase(func);
+
   ANLStatus status = AS_OK;
   for (auto& mod: modules) {
     if (mod->is_off()) { continue; }
     
     try {
-      status = ((*mod).*func)();
+      if (timing || traced) {
+        const ModuleTiming::Clock::time_point t0 = ModuleTiming::Clock::now();
+        status = ((*mod).*func)();
+        const ModuleTiming::Clock::time_point t1 = ModuleTiming::Clock::now();
+        if (timing) { mod->timing().add(phase, t1-t0); }
+        if (traced) { Tracer::record(module_phase_name(phase), "lifecycle", mod, -1, t0, t1); }
+      }
+      else {
+        status = ((*mod).*func)();
+      }
     }
     catch (ANLException& ex) {
       ex << ErrorInfoOnMethod( mod->module_name() + "::mod_" + func_id );
@@ -20,6 +20,7 @@
 #ifndef ANLNEXT_ANLStatus_H
 #define ANLNEXT_ANLStatus_H 1
 
+#include <cstddef>
 #include <ostream>
 
 namespace anlnext
@@ -70,11 +71,33 @@ constexpr ANLStatus AS_QUIT_ALL_ERROR = ANLStatus::quit_all_error;
 constexpr ANLStatus AS_CRITICAL_ERROR_TO_FINALIZE = ANLStatus::critical_error_to_finalize;
 constexpr ANLStatus AS_CRITICAL_ERROR_TO_TERMINATE = ANLStatus::critical_error_to_terminate;
 
+/**
+ * A view of the statuses of consecutive events, given to BasicModule::mod_analyze_batch().
+ * @author Hirokazu Odaka
+ * @date 2026-10-17
+ */
+class ANLStatusSpan
+{
+public:
+  ANLStatusSpan(ANLStatus* data, std::size_t size) : data_(data), size_(size) {}
+
+  std::size_t size() const { return size_; }
+  ANLStatus& operator[](std::size_t i) const { return data_[i]; }
+  ANLStatus* begin() const { return data_; }
+  ANLStatus* end() const { return data_+size_; }
+
+private:
+  ANLStatus* data_;
+  std::size_t size_;
+};
+
 enum class ANLRequest {
   none,
   quit,
   show_event_index,
-  show_evs_summary
+  show_evs_summary,
+  show_results,
+  show_latency
 };
 
 } /* namespace anlnext */
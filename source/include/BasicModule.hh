@@ -20,6 +20,7 @@
 #ifndef ANLNEXT_BasicModule_H
 #define ANLNEXT_BasicModule_H 1
 
+#include <atomic>
 #include <iostream>
 #include <string>
 #include <utility>
@@ -38,6 +39,11 @@
 #include "ModuleParameter.hh"
 #include "ANLException.hh"
 #include "ModuleAccess.hh"
+#include "ModuleHandle.hh"
+#include "EvsManager.hh"
+#include "EventStore.hh"
+#include "ModuleTiming.hh"
+#include "PerfCounters.hh"
 #include "ANLMacro.hh"
 
 #ifdef ANLNEXT_USE_TVECTOR
@@ -53,8 +59,6 @@
 namespace anlnext
 {
 
-class EvsManager;
-
 /**
  * A basic class for an ANL Next module.
  *
@@ -68,6 +72,20 @@ class EvsManager;
  * @date 2017-07-07 | new model (mod-methods are renamed)
  * @date 2019-12-25 | get-result
  * @date 2023-05-10 | singleton module
+ * @date 2026-10-17 | pipeline stage head
+ * @date 2026-10-17 | mod_merge_is_associative()
+ * @date 2026-10-17 | mod_snapshot()
+ * @date 2026-10-17 | EVS handles
+ * @date 2026-10-17 | EVS gate
+ * @date 2026-10-17 | switch_generation() for ExecutionPlan
+ * @date 2026-10-17 | mod_analyze_batch()
+ * @date 2026-10-17 | event data store
+ * @date 2026-10-17 | module handles
+ * @date 2026-10-17 | mod_is_commutable_filter()
+ * @date 2026-10-17 | mod_analyze_is_concurrent()
+ * @date 2026-10-17 | module timing
+ * @date 2026-10-17 | hardware performance counters
+ * @date 2026-10-17 | mod_clone_is_thread_safe()
  */
 class BasicModule
 {
@@ -103,9 +121,22 @@ public:
   int copy_id() const { return copy_ID_; }
   bool is_master() const { return (copy_ID_ == 0); }
 
+  /**
+   * let the chains of ANLManagerMT call mod_analyze() of this module in the
+   * order of the events, one event at a time. An event holds the turn of
+   * this module until the event is finished, so that an event redone by
+   * AS_REDO is retried in its turn; the modules after this one are then
+   * not processed concurrently either.
+   */
   void set_order_sensitive(bool v) { order_sensitive_ = v; }
   bool is_order_sensitive() const { return order_sensitive_; }
 
+  /**
+   * mark this module as the first module of a new stage in the pipeline mode.
+   */
+  void set_stage_head(bool v=true) { stage_head_ = v; }
+  bool is_stage_head() const { return stage_head_; }
+
   void set_singleton(int copyID)
   {
     singleton_ = true;
@@ -130,9 +161,99 @@ public:
   virtual ANLStatus mod_end_run()        { return AS_OK; }
   virtual ANLStatus mod_finalize()       { return AS_OK; }
 
+  /**
+   * process the events [begin, end) at once. status[i] is the status of
+   * event begin+i; the events whose status is not AS_OK on entry must be left
+   * untouched, and the status of each of the other events must be set as
+   * mod_analyze() would return it. The module must stop at the first event
+   * given AS_QUIT, AS_QUIT_ALL or a critical error, because the following
+   * events are dropped. An event given AS_REDO is skipped by the following
+   * modules of the batch and redone alone from the first module.
+   *
+   * The managers call this instead of mod_analyze() for the longest run of
+   * consecutive enabled modules supporting it in a chain, and process the
+   * modules before and after the run event by event
+   * (see ANLManager::set_batch_size()). Since the modules before the run
+   * have processed all the events of the batch, a quit in the run truncates
+   * only the work of the modules after the module giving it.
+   * The EVS flags are not kept per event in this mode, so they should not be
+   * used; the events of a batch are not counted by the EVS flags, and batches
+   * are not used while the EVS index is recorded. Neither are the event data
+   * slots kept, and the event arena is reset only at the beginning of a batch;
+   * a module after the run sees the members of the modules in the run as
+   * they are after the whole batch.
+   * The default implementation calls mod_analyze() for each event.
+   *
+   * @return AS_OK, or a critical error status which stops the analysis
+   */
+  virtual ANLStatus mod_analyze_batch(long int begin, long int end, ANLStatusSpan status);
+  virtual bool mod_analyze_batch_is_supported() const { return false; }
+
+  /**
+   * declare that this module is a pure filter: mod_analyze() only reads the
+   * event and returns AS_OK or AS_SKIP, it changes no state that the other
+   * modules see (EVS flags, event data, module members), and it depends on
+   * no module placed between it and a neighboring filter. The managers may
+   * then reorder it among its commutable neighbors to reject events earlier
+   * (see ANLManager::set_reordering_warmup()).
+   */
+  virtual bool mod_is_commutable_filter() const { return false; }
+
+  /**
+   * If this returns true, ANLManager may call mod_analyze() of this module
+   * concurrently with that of the other such modules of the same event, if
+   * neither of them depends on the other (see DependencyGraph and
+   * ANLManager::set_intra_event_threads()). mod_analyze() must then touch
+   * only this module, the modules it has accessed by get_module() or module
+   * handles, the modules declared by depend_on_module(), and the event data
+   * it defines or binds. It must not use the EVS flags or the event arena.
+   *
+   * Such a module must always return AS_OK (or a critical error), because
+   * the other modules of its group have been called for the event already;
+   * a skip, redo or quit would leave them processed and counted for an event
+   * that should not have reached them. The managers throw an ANLException
+   * if it returns one of them while processed concurrently.
+   */
+  virtual bool mod_analyze_is_concurrent() const { return false; }
+
   virtual ANLStatus mod_reduce(const std::list<BasicModule*>& parallel_modules);
   virtual ANLStatus mod_merge(const BasicModule*) { return AS_OK; }
 
+  /**
+   * If this returns true, ANLManagerMT does not call mod_reduce() but merges
+   * the parallel modules pairwise in a tree on the worker threads: a clone is
+   * merged into another clone, and finally into the master. mod_merge() must
+   * then be associative and must work when it is called on a clone.
+   * The contents of the clones after the reduction are undefined.
+   */
+  virtual bool mod_merge_is_associative() const { return false; }
+
+  /**
+   * If this returns true, ANLManagerMT with parallel routines may clone this
+   * module concurrently with the other such modules. The copy constructors
+   * of the class and its bases must then not touch any state shared with
+   * other modules, e.g. static or global variables.
+   */
+  virtual bool mod_clone_is_thread_safe() const { return false; }
+
+  /**
+   * copy the results accumulated so far into snapshot, which is a clone of
+   * this module owned by ANLManagerMT for periodic snapshots. This is called
+   * between events by the thread running this module, so it must not modify
+   * this module. The results of the other parallel modules are then added by
+   * snapshot->mod_merge(), which must not modify its argument either.
+   * Snapshots are taken only if mod_snapshot_is_supported() returns true.
+   *
+   * The snapshot is cloned from this module in PreInitialize() and never
+   * gets mod_define(), mod_initialize() or any other routine, nor the module
+   * access, the EVS manager or the event store. So mod_snapshot() must build
+   * everything that the snapshot needs for print_results() and mod_merge(),
+   * e.g. allocate its histograms on the first call, using the members set by
+   * the copy constructor only.
+   */
+  virtual ANLStatus mod_snapshot(BasicModule* /* snapshot */) const { return AS_OK; }
+  virtual bool mod_snapshot_is_supported() const { return false; }
+
   virtual ANLStatus mod_communicate() { ask_parameters(); return AS_OK; }
 
   std::vector<std::pair<std::string, ModuleAccess::ConflictOption>> get_aliases() const { return aliases_; }
@@ -146,21 +267,56 @@ public:
   std::string module_description() const { return module_description_; }
   void set_module_description(const std::string& v) { module_description_ = v; }
 
+  /**
+   * the time spent in the mod_*() methods of this module, measured by the
+   * managers while ModuleTiming is enabled.
+   */
+  ModuleTiming& timing() { return timing_; }
+  const ModuleTiming& timing() const { return timing_; }
+
+  /**
+   * the hardware event counts of mod_analyze() of this module, read by the
+   * managers while PerfCounters is enabled.
+   */
+  ModuleCounters& perf_counters() { return perf_counters_; }
+  const ModuleCounters& perf_counters() const { return perf_counters_; }
+
   void set_evs_manager(EvsManager* man) { evs_manager_ = man; }
+  void set_event_store(EventStore* store) { event_store_ = store; }
   void set_module_access(const ModuleAccess* aa) { module_access_ = aa; }
 
   ModuleAccess::Permission access_permission() const
   { return access_permission_; }
 
+  /**
+   * the modules accessed by get_module(), request_module() or the module
+   * handles, and the event data slots defined and bound by this module
+   * (see DependencyGraph). The modules are recorded only until the managers
+   * stop the recording at the end of Initialize(), so a module first
+   * accessed in the event loop is not included.
+   */
+  const std::vector<ModuleDependency>& module_dependencies() const
+  { return module_dependencies_; }
+  const std::vector<std::string>& defined_event_data() const
+  { return defined_event_data_; }
+  const std::vector<std::string>& bound_event_data() const
+  { return bound_event_data_; }
+
+  /**
+   * switch the recording of module_dependencies(), which is on by default;
+   * the managers switch it off at the end of Initialize().
+   */
+  void set_dependency_recording(bool v) { dependency_recording_ = v; }
+
   /**
    * enable this module.
    */
-  void on() { module_on_ = true; }
+  void on() { switch_module(true); }
   
   /**
    * disable this module.
    */
-  void off() { module_on_ = false; }
+  void off() { switch_module(false); }
 
   /**
    * @return true if this module is on.
@@ -172,6 +328,32 @@ public:
    */
   bool is_off() const { return !module_on_; }
 
+  /**
+   * @return a number that is incremented whenever any module is switched on or off.
+   */
+  static unsigned long switch_generation()
+  { return switch_generation_.load(std::memory_order_acquire); }
+
+  /**
+   * set an EVS predicate such as "HitFound && !Saturated" as the gate of this module.
+   * In an event in which the gate is closed, mod_analyze() is not called
+   * and the event is counted as gated. An empty expression removes the gate.
+   */
+  void set_evs_gate(const std::string& expression) { evs_gate_ = expression; }
+  std::string evs_gate() const { return evs_gate_; }
+
+  /**
+   * compile the gate against the EVS of this module's chain.
+   * It is called by the manager at the beginning of a run.
+   */
+  void compile_evs_gate();
+
+  /**
+   * @return true if the gate is closed in the current event.
+   */
+  bool is_gated() const
+  { return !evs_predicate_.is_empty() && !evs_manager_->test(evs_predicate_); }
+
   void set_loop_index(long int index) { loop_index_ = index; }
   long int get_loop_index() const { return loop_index_; }
   
@@ -334,23 +516,34 @@ protected:
 
   template <typename T>
   void get_module(const std::string& name, const T** ptr)
-  { *ptr = static_cast<const T*>(module_access_->get_module(name)); }
+  { *ptr = static_cast<const T*>(use_module(module_access_->get_module(name), name)); }
 
   template <typename T>
   void get_module_NC(const std::string& name, T** ptr)
-  { *ptr = static_cast<T*>(module_access_->get_module_NC(name)); }
+  { *ptr = static_cast<T*>(use_module_NC(module_access_->get_module_NC(name), name)); }
 
   template <typename T>
   const T* get_module(const std::string& name)
-  { return static_cast<const T*>(module_access_->get_module(name)); }
+  { return static_cast<const T*>(use_module(module_access_->get_module(name), name)); }
 
   template <typename T>
   T* get_module_NC(const std::string& name)
-  { return static_cast<T*>(module_access_->get_module_NC(name)); }
+  { return static_cast<T*>(use_module_NC(module_access_->get_module_NC(name), name)); }
 
   template <typename T>
   void get_module_IF(const std::string& name, const T** ptr);
 
+  /**
+   * resolve a typed handle to a module. The module is looked up and
+   * type-checked here; call this in mod_initialize() and keep the handle
+   * instead of calling get_module() in every event.
+   */
+  template <typename T>
+  ModuleHandle<const T> get_module_handle(const std::string& name);
+
+  template <typename T>
+  ModuleHandle<T> get_module_handle_NC(const std::string& name);
+
   template <typename T>
   void get_module_IFNC(const std::string& name, T** ptr);
 
@@ -359,19 +552,19 @@ protected:
 
   template <typename T>
   void request_module(const std::string& name, const T** ptr)
-  { *ptr = static_cast<const T*>(module_access_->request_module(name)); }
+  { *ptr = static_cast<const T*>(use_module(module_access_->request_module(name), name)); }
 
   template <typename T>
   void request_module_NC(const std::string& name, T** ptr)
-  { *ptr = static_cast<T*>(module_access_->request_module_NC(name)); }
+  { *ptr = static_cast<T*>(use_module_NC(module_access_->request_module_NC(name), name)); }
 
   template <typename T>
   const T* request_module(const std::string& name)
-  { return static_cast<const T*>(module_access_->request_module(name)); }
+  { return static_cast<const T*>(use_module(module_access_->request_module(name), name)); }
 
   template <typename T>
   T* request_module_NC(const std::string& name)
-  { return static_cast<T*>(module_access_->request_module_NC(name)); }
+  { return static_cast<T*>(use_module_NC(module_access_->request_module_NC(name), name)); }
 
   template <typename T>
   void request_module_IF(const std::string& name, const T** ptr);
@@ -379,6 +572,14 @@ protected:
   template <typename T>
   void request_module_IFNC(const std::string& name, T** ptr);
 
+  /**
+   * declare that this module depends on a module which it does not access
+   * by get_module() or a module handle, e.g. through shared data. Call this
+   * in mod_initialize(), like get_module().
+   */
+  void depend_on_module(const std::string& name)
+  { use_module(module_access_->get_module(name), name); }
+
   /*
    * access to singleton
    */
@@ -396,7 +597,52 @@ protected:
   void set_evs(const std::string& key);
   void reset_evs(const std::string& key);
 
+  /**
+   * resolve an EVS key into a handle, which skips the key lookup in the
+   * methods below. Resolve it in mod_initialize() or later, after the key
+   * has been defined; the handle is valid for the EVS of this module's chain.
+   */
+  EvsHandle evs_handle(const std::string& key) const
+  { return evs_manager_->handle(key); }
+  bool evs(EvsHandle h) const { return evs_manager_->get(h); }
+  void set_evs(EvsHandle h) { evs_manager_->set(h); }
+  void reset_evs(EvsHandle h) { evs_manager_->reset(h); }
+
 protected:
+  /**
+   * define a named slot of the per-event data store of this module's chain.
+   * Define it in mod_define() or mod_initialize(), and write the value in
+   * mod_analyze() of every event.
+   */
+  template <typename T>
+  EventHandle<T> define_event_data(const std::string& name)
+  {
+    add_unique(defined_event_data_, name);
+    return event_store_->define<T>(name);
+  }
+
+  /**
+   * bind a handle to a slot defined by another module. Bind it in
+   * mod_initialize(), after the producer has defined it.
+   */
+  template <typename T>
+  EventHandle<T> bind_event_data(const std::string& name)
+  {
+    EventHandle<T> h = event_store_->bind<T>(name);
+    add_unique(bound_event_data_, name);
+    return h;
+  }
+
+  template <typename T>
+  T& event_data(EventHandle<T> h) const
+  { return event_store_->get(h); }
+
+  /**
+   * an arena for variable-length event data, which is reset at the
+   * beginning of every event.
+   */
+  EventArena& event_arena() { return event_store_->arena(); }
+
   template <typename ModuleType>
   std::unique_ptr<BasicModule> make_clone(ModuleType*&& copied);
 
@@ -405,15 +651,46 @@ private:
   std::string get_module_id() const { return module_ID_; }
   void copy_parameters(const BasicModule& r);
 
+  void add_module_dependency(const BasicModule* mod, const std::string& name, bool writable);
+  const BasicModule* use_module(const BasicModule* mod, const std::string& name)
+  {
+    if (mod && dependency_recording_) { add_module_dependency(mod, name, false); }
+    return mod;
+  }
+  BasicModule* use_module_NC(BasicModule* mod, const std::string& name)
+  {
+    if (mod && dependency_recording_) { add_module_dependency(mod, name, true); }
+    return mod;
+  }
+  static void add_unique(std::vector<std::string>& list, const std::string& name);
+
+  void switch_module(bool v)
+  {
+    if (module_on_ != v) {
+      module_on_ = v;
+      switch_generation_.fetch_add(1, std::memory_order_acq_rel);
+    }
+  }
+
 private:
   bool order_sensitive_ = false;
+  bool stage_head_ = false;
   std::string module_ID_;
   std::vector<std::pair<std::string, ModuleAccess::ConflictOption>> aliases_;
   ModuleAccess::Permission access_permission_ = ModuleAccess::Permission::full_access;
   std::string module_description_;
   bool module_on_ = true;
+  std::string evs_gate_;
+  EvsPredicate evs_predicate_;
   EvsManager* evs_manager_ = nullptr;
+  EventStore* event_store_ = nullptr;
   const ModuleAccess* module_access_ = nullptr;
+  std::vector<ModuleDependency> module_dependencies_;
+  bool dependency_recording_ = true;
+  std::vector<std::string> defined_event_data_;
+  std::vector<std::string> bound_event_data_;
+  ModuleTiming timing_;
+  ModuleCounters perf_counters_;
   ModuleParamList module_parameters_;
   ModuleParam_sptr current_parameter_;
   ModuleParam_sptr current_value_element_;
@@ -427,6 +704,8 @@ private:
   std::shared_ptr<BasicModule*> singleton_ptr_;
 
   std::string (BasicModule::*module_ID_method_)() const;
+
+  static std::atomic<unsigned long> switch_generation_;
 };
 
 using AMIter = std::vector<BasicModule*>::iterator;
@@ -616,7 +895,7 @@ template <typename T>
 inline
 void BasicModule::get_module_IF(const std::string& name, const T** ptr)
 {
-  *ptr = dynamic_cast<const T*>(module_access_->get_module(name));
+  *ptr = dynamic_cast<const T*>(use_module(module_access_->get_module(name), name));
   if (*ptr==0) {
     BOOST_THROW_EXCEPTION( ModuleAccessError("Dynamic cast failed -- Module", name) );
   }
@@ -626,17 +905,41 @@ template <typename T>
 inline
 void BasicModule::get_module_IFNC(const std::string& name, T** ptr)
 {
-  *ptr = dynamic_cast<T*>(module_access_->get_module_NC(name));
+  *ptr = dynamic_cast<T*>(use_module_NC(module_access_->get_module_NC(name), name));
   if (*ptr==0) {
     BOOST_THROW_EXCEPTION( ModuleAccessError("Dynamic cast failed -- Module", name) );
   }
 }
 
+template <typename T>
+ModuleHandle<const T> BasicModule::get_module_handle(const std::string& name)
+{
+  const BasicModule* m = module_access_->get_module(name);
+  const T* ptr = dynamic_cast<const T*>(m);
+  if (ptr==nullptr) {
+    BOOST_THROW_EXCEPTION( ModuleAccessError("Dynamic cast failed -- Module", name) );
+  }
+  use_module(m, name);
+  return ModuleHandle<const T>(ptr);
+}
+
+template <typename T>
+ModuleHandle<T> BasicModule::get_module_handle_NC(const std::string& name)
+{
+  BasicModule* m = module_access_->get_module_NC(name);
+  T* ptr = dynamic_cast<T*>(m);
+  if (ptr==nullptr) {
+    BOOST_THROW_EXCEPTION( ModuleAccessError("Dynamic cast failed -- Module", name) );
+  }
+  use_module_NC(m, name);
+  return ModuleHandle<T>(ptr);
+}
+
 template <typename T>
 inline
 void BasicModule::request_module_IF(const std::string& name, const T** ptr)
 {
-  const BasicModule* m = module_access_->request_module(name);
+  const BasicModule* m = use_module(module_access_->request_module(name), name);
   if (m) {
     *ptr = dynamic_cast<const T*>(m);
   }
@@ -649,7 +952,7 @@ template <typename T>
 inline
 void BasicModule::request_module_IFNC(const std::string& name, T** ptr)
 {
-  BasicModule* m = module_access_->request_module_NC(name);
+  BasicModule* m = use_module_NC(module_access_->request_module_NC(name), name);
   if (m) {
     *ptr = dynamic_cast<T*>(m);
   }
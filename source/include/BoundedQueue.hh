@@ -0,0 +1,154 @@
+/*************************************************************************
+ *                                                                       *
+ * Copyright (c) 2011 Hirokazu Odaka                                     *
+ *                                                                       *
+ * This program is free software: you can redistribute it and/or modify  *
+ * it under the terms of the GNU General Public License as published by  *
+ * the Free Software Foundation, either version 3 of the License, or     *
+ * (at your option) any later version.                                   *
+ *                                                                       *
+ * This program is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ * GNU General Public License for more details.                          *
+ *                                                                       *
+ * You should have received a copy of the GNU General Public License     *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                       *
+ *************************************************************************/
+
+#ifndef ANLNEXT_BoundedQueue_H
+#define ANLNEXT_BoundedQueue_H 1
+
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <chrono>
+
+namespace anlnext
+{
+
+/**
+ * A bounded lock-free queue for passing events between threads.
+ * Any number of producers and consumers can use it (D. Vyukov's algorithm);
+ * each cell has a sequence number that tells whether it is ready to be written or read.
+ * The capacity is rounded up to a power of two.
+ *
+ * @author Hirokazu Odaka
+ * @date 2026-10-17
+ */
+template <typename T>
+class BoundedQueue
+{
+public:
+  explicit BoundedQueue(std::size_t capacity)
+  {
+    std::size_t size = 2;
+    while (size < capacity) { size *= 2; }
+    mask_ = size - 1;
+    cells_.reset(new Cell[size]);
+    for (std::size_t i=0; i<size; i++) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  ~BoundedQueue() = default;
+  BoundedQueue(const BoundedQueue&) = delete;
+  BoundedQueue(BoundedQueue&&) = delete;
+  BoundedQueue& operator=(const BoundedQueue&) = delete;
+  BoundedQueue& operator=(BoundedQueue&&) = delete;
+
+  std::size_t capacity() const { return mask_ + 1; }
+
+  /**
+   * @return false if the queue is full.
+   */
+  bool try_push(const T& value)
+  {
+    std::size_t pos = tail_.load(std::memory_order_relaxed);
+    while (true) {
+      Cell& cell = cells_[pos & mask_];
+      const std::size_t seq = cell.sequence.load(std::memory_order_acquire);
+      const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+      if (diff == 0) {
+        if (tail_.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed)) {
+          cell.value = value;
+          cell.sequence.store(pos+1, std::memory_order_release);
+          return true;
+        }
+      }
+      else if (diff < 0) {
+        return false;
+      }
+      else {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /**
+   * @return false if the queue is empty.
+   */
+  bool try_pop(T& value)
+  {
+    std::size_t pos = head_.load(std::memory_order_relaxed);
+    while (true) {
+      Cell& cell = cells_[pos & mask_];
+      const std::size_t seq = cell.sequence.load(std::memory_order_acquire);
+      const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos+1);
+      if (diff == 0) {
+        if (head_.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed)) {
+          value = cell.value;
+          cell.sequence.store(pos+mask_+1, std::memory_order_release);
+          return true;
+        }
+      }
+      else if (diff < 0) {
+        return false;
+      }
+      else {
+        pos = head_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  void push(const T& value)
+  {
+    for (int n=0; !try_push(value); n++) { back_off(n); }
+  }
+
+  void pop(T& value)
+  {
+    for (int n=0; !try_pop(value); n++) { back_off(n); }
+  }
+
+  /**
+   * spin for a while, then yield, and finally sleep so that an idle thread does not burn a core.
+   */
+  static void back_off(int n)
+  {
+    if (n < 64) { return; }
+    if (n < 256) { std::this_thread::yield(); return; }
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+  }
+
+private:
+  struct Cell
+  {
+    std::atomic<std::size_t> sequence;
+    T value;
+  };
+
+  std::unique_ptr<Cell[]> cells_;
+  std::size_t mask_ = 0;
+  char padding0_[64];
+  std::atomic<std::size_t> tail_{0};
+  char padding1_[64];
+  std::atomic<std::size_t> head_{0};
+  char padding2_[64];
+};
+
+} /* namespace anlnext */
+
+#endif /* ANLNEXT_BoundedQueue_H */
@@ -26,6 +26,7 @@ namespace anlnext
 {
 
 class EvsManager;
+class EventStore;
 class ModuleAccess;
 class BasicModule;
 
@@ -34,11 +35,18 @@ class BasicModule;
  *
  * @author Hirokazu Odaka
  * @date 2017-07-05
+ * @date 2026-10-17 | share_module()
+ * @date 2026-10-17 | execution plan
+ * @date 2026-10-17 | event data store
+ * @date 2026-10-17 | event statistics
  */
 class ClonedChainSet
 {
 public:
-  ClonedChainSet(int chain_id, const EvsManager& evs);
+  /**
+   * @param store the event store of the original chain, whose layout is shared
+   */
+  ClonedChainSet(int chain_id, const EvsManager& evs, const EventStore& store);
   ~ClonedChainSet();
   ClonedChainSet(ClonedChainSet&&) = default;
   ClonedChainSet& operator=(ClonedChainSet&&) = default;
@@ -50,11 +58,29 @@ public:
   
   void push(std::unique_ptr<BasicModule>&& mod);
   void setup_module_access();
+
+  /**
+   * make a module that is not cloned (e.g. a module of the head stage in the
+   * farm mode) accessible from the modules of this chain.
+   */
+  void share_module(BasicModule* mod);
   void reset_counters();
 
+  /**
+   * compile the execution plan of this chain (see ExecutionPlan).
+   * @param reordering_warmup see ExecutionPlan::set_reordering_warmup()
+   * @param order_plan if given, a plan with which the order of the filters
+   * is shared (see ExecutionPlan::share_order())
+   */
+  void build_execution_plan(const std::vector<std::unique_ptr<Sequencer>>* keepers=nullptr,
+                            long int reordering_warmup=0,
+                            ExecutionPlan* order_plan=nullptr);
+
   const std::vector<BasicModule*>& modules_reference() const
   { return modules_ref_; }
 
+  const ExecutionPlan& execution_plan() const { return plan_; }
+
   template <typename T>
   ANLStatus process(T func);
 
@@ -64,17 +90,32 @@ public:
   const EvsManager& get_evs() const
   { return *evs_manager_; }
 
+  EvsManager& get_evs()
+  { return *evs_manager_; }
+
+  EventStore& get_event_store()
+  { return *event_store_; }
+
+  EventStatistics& event_statistics() { return event_statistics_; }
+  const EventStatistics& event_statistics() const { return event_statistics_; }
+
   BasicModule* access_to_module(const std::string& module_ID);
 
   void automatic_switch_for_singletons();
   
+private:
+  void register_module(BasicModule* mod);
+
 private:
   int id_;
   std::unique_ptr<EvsManager> evs_manager_;
+  std::unique_ptr<EventStore> event_store_;
   std::unique_ptr<ModuleAccess> module_access_;
   std::vector<std::unique_ptr<BasicModule>> modules_;
   std::vector<BasicModule*> modules_ref_;
   std::vector<LoopCounter> counters_;
+  ExecutionPlan plan_;
+  EventStatistics event_statistics_;
 };
 
 } /* namespace anlnext */
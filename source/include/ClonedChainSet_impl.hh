@@ -22,6 +22,7 @@
 
 #include "ClonedChainSet.hh"
 #include "EvsManager.hh"
+#include "EventStore.hh"
 
 namespace anlnext
 {
@@ -29,7 +30,7 @@ namespace anlnext
 template <typename T>
 ANLStatus ClonedChainSet::process(T func)
 {
-  return func(modules_ref_, counters_, *evs_manager_);
+  return func(modules_ref_, counters_, *evs_manager_, *event_store_, plan_);
 }
 
 } /* namespace anlnext */
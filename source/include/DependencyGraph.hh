@@ -0,0 +1,85 @@
+/*************************************************************************
+ *                                                                       *
+ * Copyright (c) 2011 Hirokazu Odaka                                     *
+ *                                                                       *
+ * This program is free software: you can redistribute it and/or modify  *
+ * it under the terms of the GNU General Public License as published by  *
+ * the Free Software Foundation, either version 3 of the License, or     *
+ * (at your option) any later version.                                   *
+ *                                                                       *
+ * This program is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ * GNU General Public License for more details.                          *
+ *                                                                       *
+ * You should have received a copy of the GNU General Public License     *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                       *
+ *************************************************************************/
+
+#ifndef ANLNEXT_DependencyGraph_H
+#define ANLNEXT_DependencyGraph_H 1
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace anlnext
+{
+
+class BasicModule;
+
+/**
+ * The dependencies between the modules of a chain, collected from the
+ * modules accessed by get_module() or module handles and the event data
+ * slots that the modules have resolved.
+ * An edge from module i to module j means that i uses j: it accesses j
+ * directly or through a handle, or reads event data that j defines.
+ *
+ * @author Hirokazu Odaka
+ * @date 2026-10-17
+ * @date 2026-10-17 | get_module() and depend_on_module()
+ */
+class DependencyGraph
+{
+public:
+  enum class Kind { read, write, event_data };
+
+  struct Edge
+  {
+    std::size_t from;
+    std::size_t to;
+    Kind kind;
+    std::string label;
+  };
+
+  void build(const std::vector<BasicModule*>& modules);
+  void clear() { edges_.clear(); module_names_.clear(); }
+
+  bool empty() const { return edges_.empty(); }
+  const std::vector<Edge>& edges() const { return edges_; }
+
+  /**
+   * @return indices of the modules that module i uses.
+   */
+  std::vector<std::size_t> dependencies(std::size_t i) const;
+
+  /**
+   * @return true if module i uses module j or module j uses module i.
+   */
+  bool are_dependent(std::size_t i, std::size_t j) const;
+
+  void print(std::ostream& os=std::cout) const;
+
+private:
+  void add_edge(std::size_t from, std::size_t to, Kind kind, const std::string& label);
+
+private:
+  std::vector<Edge> edges_;
+  std::vector<std::string> module_names_;
+};
+
+} /* namespace anlnext */
+
+#endif /* ANLNEXT_DependencyGraph_H */
@@ -0,0 +1,125 @@
+/*************************************************************************
+ *                                                                       *
+ * Copyright (c) 2011 Hirokazu Odaka                                     *
+ *                                                                       *
+ * This program is free software: you can redistribute it and/or modify  *
+ * it under the terms of the GNU General Public License as published by  *
+ * the Free Software Foundation, either version 3 of the License, or     *
+ * (at your option) any later version.                                   *
+ *                                                                       *
+ * This program is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ * GNU General Public License for more details.                          *
+ *                                                                       *
+ * You should have received a copy of the GNU General Public License     *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                       *
+ *************************************************************************/
+
+#ifndef ANLNEXT_EventArena_H
+#define ANLNEXT_EventArena_H 1
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace anlnext
+{
+
+/**
+ * An array allocated in an EventArena. It is valid until the arena is reset.
+ */
+template <typename T>
+class ArenaArray
+{
+public:
+  ArenaArray() = default;
+  ArenaArray(T* data, std::size_t size) : data_(data), size_(size) {}
+
+  std::size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  T* data() const { return data_; }
+  T& operator[](std::size_t i) const { return data_[i]; }
+  T* begin() const { return data_; }
+  T* end() const { return data_+size_; }
+
+private:
+  T* data_ = nullptr;
+  std::size_t size_ = 0;
+};
+
+/**
+ * A bump allocator for per-event data. Memory is taken from large blocks
+ * and is released all at once by reset(), which keeps the blocks for the
+ * next event. No destructor is called, so only trivially destructible
+ * types can be allocated.
+ *
+ * @author Hirokazu Odaka
+ * @date 2026-10-17
+ */
+class EventArena
+{
+public:
+  explicit EventArena(std::size_t block_size=65536) : block_size_(block_size) {}
+  ~EventArena() = default;
+  EventArena(const EventArena&) = delete;
+  EventArena(EventArena&&) = default;
+  EventArena& operator=(const EventArena&) = delete;
+  EventArena& operator=(EventArena&&) = default;
+
+  void* allocate(std::size_t size, std::size_t alignment)
+  {
+    if (i_block_ < blocks_.size()) {
+      const std::size_t begin = (offset_+alignment-1) & ~(alignment-1);
+      if (begin+size <= block_sizes_[i_block_]) {
+        offset_ = begin+size;
+        return blocks_[i_block_].get()+begin;
+      }
+    }
+    return allocate_in_new_block(size);
+  }
+
+  /**
+   * allocate an uninitialized array of n elements of T.
+   */
+  template <typename T>
+  ArenaArray<T> allocate_array(std::size_t n)
+  {
+    static_assert(std::is_trivially_destructible<T>::value,
+                  "EventArena: T must be trivially destructible");
+    static_assert(alignof(T) <= alignof(std::max_align_t),
+                  "EventArena: T is over-aligned");
+    return ArenaArray<T>(static_cast<T*>(allocate(sizeof(T)*n, alignof(T))), n);
+  }
+
+  /**
+   * release all the memory allocated since the last reset.
+   */
+  void reset()
+  {
+    i_block_ = 0;
+    offset_ = 0;
+  }
+
+  /**
+   * @return the total size of the blocks owned by the arena.
+   */
+  std::size_t capacity() const;
+
+private:
+  void* allocate_in_new_block(std::size_t size);
+
+private:
+  std::size_t block_size_;
+  std::vector<std::unique_ptr<char[]>> blocks_;
+  std::vector<std::size_t> block_sizes_;
+  std::size_t i_block_ = 0;
+  std::size_t offset_ = 0;
+};
+
+} /* namespace anlnext */
+
+#endif /* ANLNEXT_EventArena_H */
@@ -0,0 +1,192 @@
+/*************************************************************************
+ *                                                                       *
+ * Copyright (c) 2011 Hirokazu Odaka                                     *
+ *                                                                       *
+ * This program is free software: you can redistribute it and/or modify  *
+ * it under the terms of the GNU General Public License as published by  *
+ * the Free Software Foundation, either version 3 of the License, or     *
+ * (at your option) any later version.                                   *
+ *                                                                       *
+ * This program is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ * GNU General Public License for more details.                          *
+ *                                                                       *
+ * You should have received a copy of the GNU General Public License     *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                       *
+ *************************************************************************/
+
+#ifndef ANLNEXT_EventDispatcher_H
+#define ANLNEXT_EventDispatcher_H 1
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace anlnext
+{
+
+/**
+ * scoped enum to select how event indices are handed to the analysis threads.
+ *
+ * dynamic: fixed-size chunks taken from a shared counter.
+ * guided: chunks proportional to the remaining events, shrinking towards the end of the run.
+ * work_stealing: each thread owns a deque of event ranges; an idle thread steals from the others.
+ */
+enum class EventSchedule {
+  dynamic,
+  guided,
+  work_stealing,
+};
+
+/**
+ * Event index dispatcher for multi-thread mode.
+ * Each thread takes a contiguous block of event indices from a shared atomic counter,
+ * and then processes the block without further synchronization.
+ *
+ * In the work-stealing schedule, the events are initially divided into one range per thread.
+ * A thread takes blocks from the front of its own deque, and a thread whose deque is empty
+ * steals the back half of the last range of another thread.
+ * This keeps all threads busy until the end of the run even when per-event cost varies a lot.
+ * With order-sensitive modules or infinite loops, it behaves like the dynamic schedule.
+ * With order-sensitive modules, every schedule hands out one index at a time
+ * regardless of the chunk size, so that each index taken passes the order keepers.
+ *
+ * @author Hirokazu Odaka
+ * @date 2026-10-17
+ * @date 2026-10-17 | work stealing
+ * @date 2026-10-17 | take_following(), give_back() for batches
+ * @date 2026-10-17 | lock wait time
+ * @date 2026-10-17 | cache-line aligned slots
+ */
+class EventDispatcher
+{
+public:
+  EventDispatcher() = default;
+  ~EventDispatcher() = default;
+  EventDispatcher(const EventDispatcher&) = delete;
+  EventDispatcher(EventDispatcher&&) = delete;
+  EventDispatcher& operator=(const EventDispatcher&) = delete;
+  EventDispatcher& operator=(EventDispatcher&&) = delete;
+
+  void set_schedule(EventSchedule v) { schedule_ = v; }
+  EventSchedule schedule() const { return schedule_; }
+
+  /**
+   * set the chunk size. For the guided schedule, this is the minimum chunk size.
+   * It is ignored (1) when any module is order sensitive.
+   * @param v chunk size; 0 for automatic
+   */
+  void set_chunk_size(long int v) { chunk_size_ = v; }
+  long int chunk_size() const { return chunk_size_; }
+
+  /**
+   * prepare for a new run.
+   * @param num_events number of events; negative for infinite loops
+   * @param num_threads number of threads that take events
+   * @param ordered true if any module is order sensitive
+   */
+  void reset(long int num_events, int num_threads, bool ordered);
+
+  /**
+   * get the next event index for the thread.
+   * @return false if no event remains
+   */
+  bool next(int i_thread, long int& index)
+  {
+    Slot& slot = slots_[i_thread];
+    if (slot.next == slot.end && !take_chunk(i_thread)) {
+      return false;
+    }
+    index = slot.next++;
+    return true;
+  }
+
+  /**
+   * give back the last index so that the thread gets the same index again.
+   */
+  void redo(int i_thread) { --(slots_[i_thread].next); }
+
+  /**
+   * take up to n more indices that follow the last one in the current block
+   * of the thread.
+   * @return the number of indices taken
+   */
+  long int take_following(int i_thread, long int n)
+  {
+    Slot& slot = slots_[i_thread];
+    const long int m = std::min(n, slot.end-slot.next);
+    slot.next += m;
+    return m;
+  }
+
+  /**
+   * give back the last n indices so that the thread gets them again.
+   */
+  void give_back(int i_thread, long int n) { slots_[i_thread].next -= n; }
+
+  long int effective_chunk_size() const { return chunk_; }
+
+  /**
+   * @return true if the threads take the events under locks, i.e. in the
+   * work-stealing schedule; the other schedules use an atomic counter only.
+   */
+  bool uses_locks() const { return stealing_; }
+
+  /**
+   * @return the time that the thread has waited for the locks of the event
+   * ranges since reset(); uncontended locks add nothing.
+   */
+  std::chrono::steady_clock::duration lock_wait_time(int i_thread) const
+  { return slots_[i_thread].lock_wait; }
+
+private:
+  using EventRange = std::pair<long int, long int>;
+
+  static constexpr std::size_t CacheLineSize = 64;
+
+  /**
+   * The block being processed, used by the owner thread only, and the ranges,
+   * locked and written by the thieves as well, are on separate cache lines.
+   */
+  struct alignas(CacheLineSize) Slot
+  {
+    long int next = 0;
+    long int end = 0;
+    std::chrono::steady_clock::duration lock_wait{0};
+
+    alignas(CacheLineSize) std::mutex mutex;
+    std::deque<EventRange> ranges;
+
+    // C++14 new does not respect the alignment of the type.
+    static void* operator new[](std::size_t size);
+    static void operator delete[](void* p);
+  };
+
+  static std::unique_lock<std::mutex> lock_slot(Slot& slot, Slot& owner);
+  bool take_chunk(int i_thread);
+  bool take_own_range(Slot& slot);
+  bool steal_range(int i_thread);
+
+private:
+  EventSchedule schedule_ = EventSchedule::dynamic;
+  long int chunk_size_ = 0;
+  long int chunk_ = 1;
+  long int num_events_ = 0;
+  int num_threads_ = 1;
+  bool guided_ = false;
+  bool stealing_ = false;
+  std::unique_ptr<Slot[]> slots_;
+  char padding_[64];
+  std::atomic<long int> counter_{0};
+};
+
+} /* namespace anlnext */
+
+#endif /* ANLNEXT_EventDispatcher_H */
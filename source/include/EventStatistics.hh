@@ -0,0 +1,137 @@
+/*************************************************************************
+ *                                                                       *
+ * Copyright (c) 2011 Hirokazu Odaka                                     *
+ *                                                                       *
+ * This program is free software: you can redistribute it and/or modify  *
+ * it under the terms of the GNU General Public License as published by  *
+ * the Free Software Foundation, either version 3 of the License, or     *
+ * (at your option) any later version.                                   *
+ *                                                                       *
+ * This program is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ * GNU General Public License for more details.                          *
+ *                                                                       *
+ * You should have received a copy of the GNU General Public License     *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                       *
+ *************************************************************************/
+
+#ifndef ANLNEXT_EventStatistics_H
+#define ANLNEXT_EventStatistics_H 1
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <boost/property_tree/ptree.hpp>
+
+#include "LatencyHistogram.hh"
+#include "ModuleTiming.hh"
+
+namespace anlnext
+{
+
+/**
+ * The number of events completed in each second since a common origin,
+ * kept for the last NumSlots seconds. It is recorded by a single thread.
+ *
+ * @author Hirokazu Odaka
+ * @date 2026-10-17
+ */
+class ThroughputSeries
+{
+public:
+  static constexpr std::size_t NumSlots = 600;
+
+  void record(std::int64_t second, std::uint64_t n=1)
+  {
+    Slot& slot = slots_[static_cast<std::size_t>(second) % NumSlots];
+    if (slot.second.get() != second) {
+      slot.events.set(0);
+      slot.second.set(second);
+    }
+    slot.events.add(n);
+    if (second > last_second_.get()) {
+      last_second_.set(second);
+    }
+  }
+
+  /**
+   * @return the events completed in the second, or 0 if it is not kept.
+   */
+  std::uint64_t events(std::int64_t second) const;
+
+  /**
+   * @return the last second in which an event was completed; -1 if none.
+   */
+  std::int64_t last_second() const { return last_second_.get(); }
+
+  void reset();
+  ThroughputSeries& operator+=(const ThroughputSeries& r);
+
+  /**
+   * print the events per second in the last num_seconds seconds. The last
+   * second is still being filled.
+   */
+  void print(std::ostream& os, std::size_t num_seconds) const;
+
+  /**
+   * @return a list of {second, events} of the seconds kept.
+   */
+  boost::property_tree::ptree to_property_tree() const;
+
+private:
+  struct Slot
+  {
+    SingleWriterValue<std::int64_t> second{-1};
+    SingleWriterValue<std::uint64_t> events;
+  };
+
+  std::array<Slot, NumSlots> slots_;
+  SingleWriterValue<std::int64_t> last_second_{-1};
+};
+
+/**
+ * The latency of the whole events and the throughput of a chain, recorded
+ * by the thread running the chain while ModuleTiming is enabled.
+ *
+ * @author Hirokazu Odaka
+ * @date 2026-10-17
+ */
+struct EventStatistics
+{
+  LatencyHistogram latency;
+  ThroughputSeries throughput;
+
+  /**
+   * record n events processed in time t, which are completed at elapsed
+   * time since the origin; each of them is given the mean latency.
+   */
+  void record(ModuleTiming::Clock::duration t, long int n, ModuleTiming::Clock::duration elapsed)
+  {
+    const std::int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t).count();
+    latency.record(ns/n, static_cast<std::uint64_t>(n));
+    throughput.record(std::chrono::duration_cast<std::chrono::seconds>(elapsed).count(),
+                      static_cast<std::uint64_t>(n));
+  }
+
+  bool empty() const { return latency.empty(); }
+
+  void reset()
+  {
+    latency.reset();
+    throughput.reset();
+  }
+
+  EventStatistics& operator+=(const EventStatistics& r)
+  {
+    latency += r.latency;
+    throughput += r.throughput;
+    return *this;
+  }
+};
+
+} /* namespace anlnext */
+
+#endif /* ANLNEXT_EventStatistics_H */
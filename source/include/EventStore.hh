@@ -0,0 +1,175 @@
+/*************************************************************************
+ *                                                                       *
+ * Copyright (c) 2011 Hirokazu Odaka                                     *
+ *                                                                       *
+ * This program is free software: you can redistribute it and/or modify  *
+ * it under the terms of the GNU General Public License as published by  *
+ * the Free Software Foundation, either version 3 of the License, or     *
+ * (at your option) any later version.                                   *
+ *                                                                       *
+ * This program is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ * GNU General Public License for more details.                          *
+ *                                                                       *
+ * You should have received a copy of the GNU General Public License     *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                       *
+ *************************************************************************/
+
+#ifndef ANLNEXT_EventStore_H
+#define ANLNEXT_EventStore_H 1
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <typeindex>
+#include <typeinfo>
+#include <vector>
+
+#include "EventArena.hh"
+
+namespace anlnext
+{
+
+/**
+ * A typed handle to a slot of EventStore, given by EventStore::define() or bind().
+ * It is valid for all the stores that share the layout of the store that issued it.
+ */
+template <typename T>
+class EventHandle
+{
+public:
+  EventHandle() = default;
+  bool is_valid() const { return index_ != static_cast<std::size_t>(-1); }
+
+private:
+  explicit EventHandle(std::size_t index) : index_(index) {}
+  std::size_t index_ = static_cast<std::size_t>(-1);
+
+  friend class EventStore;
+};
+
+/**
+ * The names and types of the slots of event stores. It is shared by the
+ * stores of all the chains of a manager, so that a handle has the same
+ * index in all of them.
+ *
+ * @author Hirokazu Odaka
+ * @date 2026-10-17
+ */
+class EventStoreLayout
+{
+public:
+  using Factory = std::shared_ptr<void> (*)();
+
+  EventStoreLayout() = default;
+  EventStoreLayout(const EventStoreLayout&) = delete;
+  EventStoreLayout& operator=(const EventStoreLayout&) = delete;
+
+  /**
+   * define a slot, or find it if it has been defined with the same type.
+   * @return index of the slot
+   */
+  std::size_t define(const std::string& name, std::type_index type, Factory make);
+
+  /**
+   * find a slot; an ANLException is thrown if it is not defined or has another type.
+   * @return index of the slot
+   */
+  std::size_t find(const std::string& name, std::type_index type) const;
+
+  std::size_t size() const;
+  Factory factory(std::size_t index) const;
+
+private:
+  struct Slot
+  {
+    std::string name;
+    std::type_index type;
+    Factory make;
+  };
+
+  mutable std::mutex mutex_;
+  std::vector<Slot> slots_;
+  std::map<std::string, std::size_t> index_;
+};
+
+/**
+ * A typed per-event data store of a chain.
+ * A producer module defines a named slot and writes it in every event, and
+ * consumer modules bind a handle to the slot in mod_initialize(), so that
+ * the modules do not have to access each other. The value of a slot is
+ * default-constructed once and reused in the following events.
+ * Variable-length data can be allocated in the arena of the store, which is
+ * reset at the beginning of every event instead of freeing memory.
+ *
+ * @author Hirokazu Odaka
+ * @date 2026-10-17
+ */
+class EventStore
+{
+public:
+  EventStore();
+  explicit EventStore(std::shared_ptr<EventStoreLayout> layout);
+  ~EventStore();
+  EventStore(const EventStore&) = delete;
+  EventStore& operator=(const EventStore&) = delete;
+
+  const std::shared_ptr<EventStoreLayout>& layout() const { return layout_; }
+
+  /**
+   * define a slot of type T. Defining the same name with the same type
+   * again gives the same slot.
+   */
+  template <typename T>
+  EventHandle<T> define(const std::string& name)
+  {
+    const std::size_t index = layout_->define(name, typeid(T), &make_value<T>);
+    sync();
+    return EventHandle<T>(index);
+  }
+
+  /**
+   * bind a handle to a slot of type T defined by another module.
+   */
+  template <typename T>
+  EventHandle<T> bind(const std::string& name)
+  {
+    const std::size_t index = layout_->find(name, typeid(T));
+    sync();
+    return EventHandle<T>(index);
+  }
+
+  template <typename T>
+  T& get(EventHandle<T> h) const
+  { return *static_cast<T*>(pointers_[h.index_]); }
+
+  EventArena& arena() { return arena_; }
+
+  /**
+   * start a new event; the memory of the arena is released.
+   */
+  void reset_event() { arena_.reset(); }
+
+  /**
+   * create the values of the slots that have been added to the layout.
+   */
+  void sync();
+
+private:
+  template <typename T>
+  static std::shared_ptr<void> make_value() { return std::make_shared<T>(); }
+
+private:
+  std::shared_ptr<EventStoreLayout> layout_;
+  std::vector<std::shared_ptr<void>> values_;
+  std::vector<void*> pointers_;
+  EventArena arena_;
+};
+
+} /* namespace anlnext */
+
+#endif /* ANLNEXT_EventStore_H */
@@ -0,0 +1,160 @@
+/*************************************************************************
+ *                                                                       *
+ * Copyright (c) 2011 Hirokazu Odaka                                     *
+ *                                                                       *
+ * This program is free software: you can redistribute it and/or modify  *
+ * it under the terms of the GNU General Public License as published by  *
+ * the Free Software Foundation, either version 3 of the License, or     *
+ * (at your option) any later version.                                   *
+ *                                                                       *
+ * This program is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ * GNU General Public License for more details.                          *
+ *                                                                       *
+ * You should have received a copy of the GNU General Public License     *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                       *
+ *************************************************************************/
+
+#ifndef ANLNEXT_EvsExpression_H
+#define ANLNEXT_EvsExpression_H 1
+
+#include <cctype>
+#include <string>
+#include <boost/format.hpp>
+#include "ANLException.hh"
+
+namespace anlnext
+{
+
+/**
+ * Recursive-descent parser of an Evs expression such as "A && !(B || C)".
+ *
+ * expression := term ('||' term)*
+ * term       := factor ('&&' factor)*
+ * factor     := '!' factor | '(' expression ')' | key
+ *
+ * A key that contains spaces or operator characters can be quoted by '"'.
+ * The values are built by Builder, which provides value_type and
+ * has_key(), key(), logical_and(), logical_or() and logical_not().
+ *
+ * @author Hirokazu Odaka
+ * @date 2026-10-17 | taken out of EvsIndex
+ */
+template <typename Builder>
+class EvsExpressionParser
+{
+public:
+  using value_type = typename Builder::value_type;
+
+  EvsExpressionParser(const std::string& expression, Builder& builder)
+    : expr_(expression), builder_(builder)
+  {}
+
+  value_type parse()
+  {
+    value_type v = parse_expression();
+    skip_spaces();
+    if (pos_ != expr_.size()) {
+      error("unexpected character");
+    }
+    return v;
+  }
+
+  [[noreturn]] void error(const std::string& message) const
+  {
+    BOOST_THROW_EXCEPTION( ANLException((boost::format("Evs expression: %s at position %d in \"%s\"") % message % pos_ % expr_).str()) );
+  }
+
+private:
+  void skip_spaces()
+  {
+    while (pos_<expr_.size() && std::isspace(static_cast<unsigned char>(expr_[pos_]))) {
+      pos_++;
+    }
+  }
+
+  bool accept(const std::string& op)
+  {
+    skip_spaces();
+    if (expr_.compare(pos_, op.size(), op) == 0) {
+      pos_ += op.size();
+      return true;
+    }
+    return false;
+  }
+
+  value_type parse_expression()
+  {
+    value_type v = parse_term();
+    while (accept("||")) {
+      v = builder_.logical_or(v, parse_term());
+    }
+    return v;
+  }
+
+  value_type parse_term()
+  {
+    value_type v = parse_factor();
+    while (accept("&&")) {
+      v = builder_.logical_and(v, parse_factor());
+    }
+    return v;
+  }
+
+  value_type parse_factor()
+  {
+    if (accept("!")) {
+      return builder_.logical_not(parse_factor());
+    }
+    if (accept("(")) {
+      value_type v = parse_expression();
+      if (!accept(")")) {
+        error("')' is expected");
+      }
+      return v;
+    }
+    return parse_key();
+  }
+
+  value_type parse_key()
+  {
+    skip_spaces();
+    std::string key;
+    if (pos_<expr_.size() && expr_[pos_]=='"') {
+      const std::size_t end = expr_.find('"', pos_+1);
+      if (end == std::string::npos) {
+        error("unterminated quotation");
+      }
+      key = expr_.substr(pos_+1, end-pos_-1);
+      pos_ = end+1;
+    }
+    else {
+      const std::size_t begin = pos_;
+      while (pos_<expr_.size()
+             && !std::isspace(static_cast<unsigned char>(expr_[pos_]))
+             && std::string("()!&|\"").find(expr_[pos_]) == std::string::npos) {
+        pos_++;
+      }
+      key = expr_.substr(begin, pos_-begin);
+    }
+
+    if (key.empty()) {
+      error("an EVS key is expected");
+    }
+    if (!builder_.has_key(key)) {
+      error("undefined EVS key "+key);
+    }
+    return builder_.key(key);
+  }
+
+private:
+  const std::string expr_;
+  Builder& builder_;
+  std::size_t pos_ = 0;
+};
+
+} /* namespace anlnext */
+
+#endif /* ANLNEXT_EvsExpression_H */
@@ -0,0 +1,116 @@
+/*************************************************************************
+ *                                                                       *
+ * Copyright (c) 2011 Hirokazu Odaka                                     *
+ *                                                                       *
+ * This program is free software: you can redistribute it and/or modify  *
+ * it under the terms of the GNU General Public License as published by  *
+ * the Free Software Foundation, either version 3 of the License, or     *
+ * (at your option) any later version.                                   *
+ *                                                                       *
+ * This program is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ * GNU General Public License for more details.                          *
+ *                                                                       *
+ * You should have received a copy of the GNU General Public License     *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                       *
+ *************************************************************************/
+
+#ifndef ANLNEXT_EvsIndex_H
+#define ANLNEXT_EvsIndex_H 1
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace anlnext
+{
+
+/**
+ * A set of event (loop) indices stored as runs of consecutive indices.
+ * Indices added in increasing order extend the last run; the others are
+ * sorted and merged by normalize(), which must be called before the set is
+ * read by size(), at(), or the set operations.
+ *
+ * @author Hirokazu Odaka
+ * @date 2026-10-17
+ */
+class EventSet
+{
+public:
+  using Run = std::pair<long int, long int>; // [begin, end)
+
+  void clear();
+  void add(long int index);
+  void add_run(long int begin, long int end);
+  void merge(const EventSet& r);
+  void normalize();
+
+  bool empty() const { return runs_.empty(); }
+  const std::vector<Run>& runs() const { return runs_; }
+
+  /**
+   * @return the number of indices in the set.
+   */
+  long int size() const;
+
+  /**
+   * @return the i-th smallest index in the set.
+   */
+  long int at(long int i) const;
+
+  EventSet operator&(const EventSet& r) const;
+  EventSet operator|(const EventSet& r) const;
+  EventSet operator-(const EventSet& r) const;
+
+private:
+  std::vector<Run> runs_;
+  std::vector<long int> offsets_;
+  bool normalized_ = true;
+};
+
+/**
+ * An index of the final Evs flags of the events of a run, which is written
+ * into a file and used later to process only the events of a selection.
+ *
+ * The file holds the set of processed events and, for each Evs key, the set
+ * of events in which the flag was true. Each set is written either as runs
+ * encoded by variable-length integers (the gap from the previous run and the
+ * length of the run) or as a bitmap, whichever is smaller.
+ *
+ * A selection is given by an expression of Evs keys with the operators
+ * ! (not), && (and), || (or), and parentheses, e.g. "good && !(pileup || noise)".
+ * A key containing spaces or operator characters is quoted by "".
+ * "not" is taken relative to the processed events.
+ *
+ * @author Hirokazu Odaka
+ * @date 2026-10-17
+ */
+class EvsIndex
+{
+public:
+  void clear();
+
+  EventSet& processed() { return processed_; }
+  const EventSet& processed() const { return processed_; }
+  EventSet& flag(const std::string& key) { return flags_[key]; }
+  const std::map<std::string, EventSet>& flags() const { return flags_; }
+
+  void write(const std::string& filename);
+  void read(const std::string& filename);
+
+  /**
+   * @return the processed events that satisfy the expression.
+   */
+  EventSet select(const std::string& expression) const;
+
+private:
+  EventSet processed_;
+  std::map<std::string, EventSet> flags_;
+};
+
+} /* namespace anlnext */
+
+#endif /* ANLNEXT_EvsIndex_H */
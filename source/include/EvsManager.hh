@@ -23,8 +23,11 @@
 #include <cstdint>
 #include <map>
 #include <string>
+#include <vector>
 #include <iostream>
 
+#include "EvsIndex.hh"
+
 namespace anlnext
 {
 
@@ -54,15 +57,70 @@ using EvsMap = std::map<std::string, EvsData>;
 using EvsIter = EvsMap::iterator;
 using EvsConstIter = EvsMap::const_iterator;
 
+/**
+ * A handle to an Evs flag, resolved once by EvsManager::handle().
+ * It is valid for the EvsManager that issued it and for copies of that manager.
+ */
+class EvsHandle
+{
+public:
+  EvsHandle() = default;
+  bool is_valid() const { return index_ != static_cast<std::size_t>(-1); }
+
+private:
+  explicit EvsHandle(std::size_t index) : index_(index) {}
+  std::size_t index_ = static_cast<std::size_t>(-1);
+
+  friend class EvsManager;
+};
+
+/**
+ * An Evs expression compiled by EvsManager::compile() into bit masks.
+ * The expression is held in disjunctive normal form; each clause is a list
+ * of words of the flag bitset with the bits required to be set and reset.
+ * It is valid for the EvsManager that compiled it and for copies of that manager.
+ */
+class EvsPredicate
+{
+public:
+  EvsPredicate() = default;
+  const std::string& expression() const { return expression_; }
+  bool is_empty() const { return expression_.empty(); }
+
+private:
+  struct Word
+  {
+    std::size_t index = 0;
+    uint64_t set = 0;
+    uint64_t reset = 0;
+  };
+
+  std::string expression_;
+  std::vector<Word> words_;
+  std::vector<std::size_t> clause_ends_;
+
+  friend class EvsManager;
+};
+
 /**
  * The Evs (event selection) management class.
  * This class provides a flag that can be accessed from any ANL module for event selection.
  *
+ * Each key is given a slot when it is defined for the first time, and the
+ * flags of all the slots are stored in a bitset, so that the flags are reset
+ * and counted word by word in every event. The flags can be accessed either
+ * by key, which involves a map lookup, or by EvsHandle.
+ *
  * @author Hirokazu Odaka
  * @date 2010-06-xx
  * @date 2014-12-18
  * @date 2016-12-20 | add count_ok
  * @date 2017-07-07 | add merge(), rename methods
+ * @date 2026-10-17 | add save_flags(), load_flags()
+ * @date 2026-10-17 | handles and bitset of the flags
+ * @date 2026-10-17 | recording of the flags for EvsIndex
+ * @date 2026-10-17 | compiled predicates
+ * @date 2026-10-17 | events processed without flags
  */
 class EvsManager
 {
@@ -79,74 +137,177 @@ public:
   /**
    * define an Evs flag.
    */
-  void define(const std::string& key)
-  { data_[key] = EvsData(); }
+  void define(const std::string& key);
 
   /**
    * unregister an Evs flag.
    */
-  void undefine(const std::string& key) { data_.erase(key); }
+  void undefine(const std::string& key);
 
   bool is_defined(const std::string& key) const
-  { return data_.count(key); }
+  {
+    const auto it = index_.find(key);
+    return (it != index_.end() && defined_[it->second]);
+  }
+
+  /**
+   * @return a handle to an Evs flag; an invalid handle if the key is not defined.
+   */
+  EvsHandle handle(const std::string& key) const;
 
   /**
    * get an Evs flag value.
    */
   bool get(const std::string& key) const;
+  bool get(EvsHandle h) const
+  { return (flags_[h.index_/64] >> (h.index_%64)) & 1u; }
 
   /**
    * set an Evs flag as true.
    */
   void set(const std::string& key);
+  void set(EvsHandle h)
+  { flags_[h.index_/64] |= (uint64_t(1) << (h.index_%64)); }
 
   /**
    * set an Evs flag as false.
    */
   void reset(const std::string& key);
+  void reset(EvsHandle h)
+  { flags_[h.index_/64] &= ~(uint64_t(1) << (h.index_%64)); }
   
   void reset_all_flags();
   void reset_all_counts();
 
+  /**
+   * compile an expression of Evs keys such as "A && !(B || C)".
+   * An ANLException is thrown if the expression is invalid or contains an undefined key.
+   */
+  EvsPredicate compile(const std::string& expression) const;
+
+  /**
+   * evaluate a compiled predicate on the current flags.
+   */
+  bool test(const EvsPredicate& predicate) const;
+
+  /**
+   * copy all the flags into an array in the key order, so that they can be
+   * carried to another EvsManager that has the same keys.
+   */
+  void save_flags(std::vector<char>& flags) const;
+  void load_flags(const std::vector<char>& flags);
+
   void count();
   void count_completed();
+
+  /**
+   * count n events whose flags are not kept, i.e. events processed in
+   * batches, which the flag counts and the records do not include.
+   */
+  void count_unflagged(long int n) { unflagged_ += n; }
+  uint64_t num_unflagged() const { return unflagged_; }
+
   void print_summary() const;
 
-  const EvsMap& data() const { return data_; }
+  /**
+   * start (or stop) recording the final flags of every event. The records
+   * are cleared when recording starts and by reset_all_counts().
+   */
+  void set_recording(bool v);
+  bool is_recording() const { return recording_; }
+
+  /**
+   * record the current flags as the final flags of event i_event.
+   */
+  void record(long int i_event);
+
+  /**
+   * copy the records of the defined keys into index.
+   */
+  void fill_index(EvsIndex& index) const;
+
+  /**
+   * @return the flags and counts of the defined keys.
+   */
+  EvsMap data() const;
+
+  /**
+   * add the counts (and records) of r by key.
+   */
   void merge(const EvsManager& r);
 
 private:
-  EvsMap data_;
+  std::size_t find_slot(const std::string& key) const;
+  std::size_t make_slot(const std::string& key);
+
+private:
+  std::map<std::string, std::size_t> index_;
+  std::vector<char> defined_;
+  std::vector<uint64_t> flags_;
+  std::vector<uint64_t> counts_;
+  std::vector<uint64_t> counts_ok_;
+  uint64_t unflagged_ = 0;
+  bool recording_ = false;
+  EventSet recorded_events_;
+  std::vector<EventSet> recorded_flags_;
 };
 
-inline bool EvsManager::get(const std::string& key) const
+inline std::size_t EvsManager::find_slot(const std::string& key) const
 {
-  EvsConstIter it = data_.find(key);
-  if (it==data_.end()) {
+  const auto it = index_.find(key);
+  if (it==index_.end() || !defined_[it->second]) {
     std::cout << "EvsManager: Undefined key is given: " << key << std::endl;
+    return static_cast<std::size_t>(-1);
+  }
+  return it->second;
+}
+
+inline bool EvsManager::get(const std::string& key) const
+{
+  const EvsHandle h(find_slot(key));
+  if (!h.is_valid()) {
     return false;
   }
-  return it->second.flag;
+  return get(h);
 }
 
 inline void EvsManager::set(const std::string& key)
 {
-  EvsIter it = data_.find(key);
-  if (it==data_.end()) {
-    std::cout << "EvsManager: Undefined key is given: " << key << std::endl;
+  const EvsHandle h(find_slot(key));
+  if (!h.is_valid()) {
     return;
   }
-  it->second.flag = true;
+  set(h);
 }
 
 inline void EvsManager::reset(const std::string& key)
 {
-  EvsIter it = data_.find(key);
-  if (it==data_.end()) {
-    std::cout << "EvsManager: Undefined key is given: " << key << std::endl;
-    return; 
+  const EvsHandle h(find_slot(key));
+  if (!h.is_valid()) {
+    return;
+  }
+  reset(h);
+}
+
+inline bool EvsManager::test(const EvsPredicate& predicate) const
+{
+  std::size_t k = 0;
+  for (const std::size_t end: predicate.clause_ends_) {
+    bool satisfied = true;
+    for (; k<end; k++) {
+      const EvsPredicate::Word& w = predicate.words_[k];
+      const uint64_t bits = flags_[w.index];
+      if ((bits & w.set) != w.set || (bits & w.reset) != 0) {
+        satisfied = false;
+        k = end;
+        break;
+      }
+    }
+    if (satisfied) {
+      return true;
+    }
   }
-  it->second.flag = false;
+  return false;
 }
 
 } /* namespace anlnext */
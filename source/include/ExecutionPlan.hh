@@ -0,0 +1,306 @@
+/*************************************************************************
+ *                                                                       *
+ * Copyright (c) 2011 Hirokazu Odaka                                     *
+ *                                                                       *
+ * This program is free software: you can redistribute it and/or modify  *
+ * it under the terms of the GNU General Public License as published by  *
+ * the Free Software Foundation, either version 3 of the License, or     *
+ * (at your option) any later version.                                   *
+ *                                                                       *
+ * This program is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ * GNU General Public License for more details.                          *
+ *                                                                       *
+ * You should have received a copy of the GNU General Public License     *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                       *
+ *************************************************************************/
+
+#ifndef ANLNEXT_ExecutionPlan_H
+#define ANLNEXT_ExecutionPlan_H 1
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "BasicModule.hh"
+#include "LoopCounter.hh"
+
+namespace anlnext
+{
+
+class Sequencer;
+class DependencyGraph;
+class WorkerThreadPool;
+
+/**
+ * A flat list of the steps to be done in each event, compiled from a module
+ * chain so that the event loop touches only the enabled modules and the
+ * order keepers that exist. A disabled module appears in the plan only if it
+ * has an order keeper, which must be passed in every event.
+ *
+ * The plan is rebuilt by update() if any module has been switched on or off
+ * since it was built. The event loop calls it at the beginning of each event,
+ * so a module switched during an event is reflected from the next event.
+ *
+ * The longest run of consecutive steps whose modules support
+ * mod_analyze_batch() is the batch segment of the plan, which is processed
+ * for a batch of events at once; the steps before and after it are
+ * processed event by event (see process_event_batch()). A plan has no batch
+ * segment if any enabled module has an EVS gate or if the chain has an
+ * order keeper.
+ *
+ * Consecutive commutable filters (see BasicModule::mod_is_commutable_filter())
+ * can be reordered: the plan measures their cost and rejection rate during
+ * a warm-up window, and then sorts each run of them by the cost per
+ * rejection, so that an event is rejected earliest for the least cost.
+ * A filter with an order keeper or an EVS gate, or one defining event data,
+ * is not moved. The plans of parallel chains may share one order (see
+ * share_order()): the first plan that finishes its warm-up decides the
+ * order for all of them.
+ *
+ * If a thread pool is given by set_concurrency(), the steps are divided into
+ * groups, which are processed one after another. Each run of consecutive
+ * concurrent modules (see BasicModule::mod_analyze_is_concurrent()) without
+ * an EVS gate or an order keeper is split into levels by the dependency
+ * graph: a module goes to the level after the last one that has a module
+ * depending on it or on which it depends. The modules of a level form a
+ * group and are processed concurrently, so none of them may reject the
+ * event; every other step forms a group by itself.
+ *
+ * @author Hirokazu Odaka
+ * @date 2026-10-17
+ * @date 2026-10-17 | batches
+ * @date 2026-10-17 | batch segments
+ * @date 2026-10-17 | filter reordering
+ * @date 2026-10-17 | concurrent groups
+ * @date 2026-10-17 | share_order()
+ * @date 2026-10-17 | event counts
+ */
+class ExecutionPlan
+{
+public:
+  /**
+   * cost and rejections of a commutable filter measured in the warm-up window.
+   */
+  struct FilterProfile
+  {
+    double seconds = 0.0;
+    long int entries = 0;
+    long int rejections = 0;
+
+    void add(std::chrono::steady_clock::duration t, ANLStatus status)
+    {
+      seconds += std::chrono::duration<double>(t).count();
+      entries++;
+      if (status == AS_SKIP || status == AS_SKIP_ERROR) {
+        rejections++;
+      }
+    }
+
+    double cost() const { return entries > 0 ? seconds/entries : 0.0; }
+    double rejection_rate() const
+    { return entries > 0 ? static_cast<double>(rejections)/entries : 0.0; }
+  };
+
+  struct Step
+  {
+    BasicModule* module = nullptr;
+    LoopCounter* counter = nullptr;
+    Sequencer* keeper = nullptr;
+    bool active = false;
+    FilterProfile* profile = nullptr;
+    std::size_t index = 0;
+  };
+
+  /**
+   * the steps [first, last) which may be processed concurrently.
+   */
+  struct Group
+  {
+    std::size_t first;
+    std::size_t last;
+
+    std::size_t size() const { return last-first; }
+  };
+
+  /**
+   * working buffers of process_event_batch().
+   */
+  struct BatchBuffer
+  {
+    std::vector<ANLStatus> status;
+    std::vector<char> entered;
+  };
+
+  ExecutionPlan() = default;
+  ~ExecutionPlan() = default;
+  ExecutionPlan(const ExecutionPlan&) = delete;
+  ExecutionPlan(ExecutionPlan&&) = default;
+  ExecutionPlan& operator=(const ExecutionPlan&) = delete;
+  ExecutionPlan& operator=(ExecutionPlan&&) = default;
+
+  /**
+   * compile the plan of modules, whose counters are counters[0..n).
+   * keepers, if given, are the order keepers of the modules (nullptr for none).
+   */
+  void build(const std::vector<BasicModule*>& modules,
+             LoopCounter* counters,
+             const std::vector<std::unique_ptr<Sequencer>>* keepers=nullptr);
+
+  /**
+   * measure the commutable filters in the next warmup events and then
+   * reorder them; 0 disables it. Call this after build(). The filters are
+   * measured only in events processed one by one, so a plan with a batch
+   * segment is not reordered.
+   */
+  void set_reordering_warmup(long int warmup);
+
+  /**
+   * share the order of the filters with other, which must be built from
+   * clones of the same modules and may run on another thread: the first of
+   * the sharing plans that finishes its warm-up reorders the filters, and
+   * the others take its order and its filter profiles at their next event.
+   * Call this after build().
+   */
+  void share_order(ExecutionPlan& other);
+
+  /**
+   * process the independent concurrent modules of an event on the workers of
+   * pool (see the groups above). graph must be built from the same modules
+   * and outlive the plan; a null pool disables it. Call this after build().
+   */
+  void set_concurrency(const DependencyGraph* graph, WorkerThreadPool* pool);
+
+  void update()
+  {
+    if (generation_ != BasicModule::switch_generation()) {
+      rebuild();
+    }
+  }
+
+  /**
+   * update() at the beginning of an event processed one by one; this also
+   * counts down the warm-up window of the filter reordering.
+   */
+  void begin_event()
+  {
+    if (warmup_left_ > 0 && --warmup_left_ == 0) {
+      reorder_filters();
+    }
+    if (!reordered_ && shared_order_ && shared_order_->published.load(std::memory_order_acquire)) {
+      adopt_shared_order();
+    }
+    update();
+  }
+
+  /**
+   * count an event processed by the plan, which has passed all the steps if
+   * status is AS_OK. An event to be redone is not counted.
+   */
+  void count_event(ANLStatus status)
+  {
+    if (status == AS_REDO) { return; }
+    num_events_++;
+    if (status == AS_OK) { num_completed_events_++; }
+  }
+
+  /**
+   * @return the events counted since the plan was built.
+   */
+  long int number_of_events() const { return num_events_; }
+  long int number_of_completed_events() const { return num_completed_events_; }
+
+  const std::vector<Step>& steps() const { return steps_; }
+
+  /**
+   * @return the enabled modules, to which the loop index is given.
+   */
+  const std::vector<BasicModule*>& active_modules() const { return active_modules_; }
+
+  bool is_batchable() const { return batch_segment_.size() > 0; }
+
+  /**
+   * @return the steps processed by mod_analyze_batch(), which are empty if
+   * the plan is not batchable.
+   */
+  const Group& batch_segment() const { return batch_segment_; }
+  BatchBuffer& batch_buffer() { return batch_buffer_; }
+
+  bool is_reordered() const { return reordered_; }
+
+  bool is_concurrent() const { return pool_ != nullptr; }
+  WorkerThreadPool* thread_pool() const { return pool_; }
+
+  /**
+   * @return the groups of the steps, which are given only if is_concurrent().
+   */
+  const std::vector<Group>& groups() const { return groups_; }
+
+  /**
+   * @return a buffer of the results of the steps processed in a group.
+   */
+  std::vector<ANLStatus>& group_results() { return group_results_; }
+
+  /**
+   * @return the indices of the modules in the order of the steps.
+   */
+  const std::vector<std::size_t>& order() const { return order_; }
+
+  /**
+   * @return the runs of commutable filters as ranges [first, last) of positions in order().
+   */
+  const std::vector<std::pair<std::size_t, std::size_t>>& filter_runs() const { return filter_runs_; }
+
+  const FilterProfile& filter_profile(std::size_t i_module) const { return profiles_[i_module]; }
+
+private:
+  /**
+   * the order published by the first plan that finishes its warm-up.
+   */
+  struct SharedOrder
+  {
+    std::mutex mutex;
+    std::atomic<bool> published{false};
+    std::vector<std::size_t> order;
+    std::vector<FilterProfile> profiles;
+  };
+
+  void rebuild();
+  void find_filter_runs();
+  void reorder_filters();
+  void adopt_shared_order();
+  void build_groups();
+  void find_batch_segment(bool batchable);
+
+private:
+  std::vector<BasicModule*> modules_;
+  LoopCounter* counters_ = nullptr;
+  std::vector<Sequencer*> keepers_;
+  std::vector<Step> steps_;
+  std::vector<BasicModule*> active_modules_;
+  std::vector<std::size_t> order_;
+  std::vector<std::pair<std::size_t, std::size_t>> filter_runs_;
+  std::vector<FilterProfile> profiles_;
+  long int warmup_left_ = 0;
+  bool reordered_ = false;
+  std::shared_ptr<SharedOrder> shared_order_;
+  const DependencyGraph* graph_ = nullptr;
+  WorkerThreadPool* pool_ = nullptr;
+  std::vector<Group> groups_;
+  std::vector<ANLStatus> group_results_;
+  Group batch_segment_{0, 0};
+  BatchBuffer batch_buffer_;
+  long int num_events_ = 0;
+  long int num_completed_events_ = 0;
+  unsigned long generation_ = 0;
+};
+
+} /* namespace anlnext */
+
+#endif /* ANLNEXT_ExecutionPlan_H */
@@ -0,0 +1,115 @@
+/*************************************************************************
+ *                                                                       *
+ * Copyright (c) 2011 Hirokazu Odaka                                     *
+ *                                                                       *
+ * This program is free software: you can redistribute it and/or modify  *
+ * it under the terms of the GNU General Public License as published by  *
+ * the Free Software Foundation, either version 3 of the License, or     *
+ * (at your option) any later version.                                   *
+ *                                                                       *
+ * This program is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ * GNU General Public License for more details.                          *
+ *                                                                       *
+ * You should have received a copy of the GNU General Public License     *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                       *
+ *************************************************************************/
+
+#ifndef ANLNEXT_LatencyHistogram_H
+#define ANLNEXT_LatencyHistogram_H 1
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <boost/property_tree/ptree.hpp>
+
+namespace anlnext
+{
+
+/**
+ * a value written by a single thread and read by any thread, e.g. by the
+ * console while the event loop is running.
+ */
+template <typename T>
+class SingleWriterValue
+{
+public:
+  SingleWriterValue(T v=T()) : value_(v) {}
+  SingleWriterValue(const SingleWriterValue& r) : value_(r.get()) {}
+  SingleWriterValue& operator=(const SingleWriterValue& r) { set(r.get()); return *this; }
+
+  T get() const { return value_.load(std::memory_order_relaxed); }
+  void set(T v) { value_.store(v, std::memory_order_relaxed); }
+  void add(T v) { set(get()+v); }
+
+private:
+  std::atomic<T> value_;
+};
+
+/**
+ * A histogram of latencies in nanoseconds with logarithmic bins, in the
+ * manner of HDR histograms: each power of two is divided into 16 bins, so
+ * a value is known within 1/16 of it up to 2^47 ns (about 39 hours).
+ * Larger values go to the last bin.
+ *
+ * A histogram is recorded by a single thread; the other threads may read it
+ * at any time.
+ *
+ * @author Hirokazu Odaka
+ * @date 2026-10-17
+ */
+class LatencyHistogram
+{
+public:
+  static constexpr int SubBucketBits = 4;
+  static constexpr std::size_t NumSubBuckets = std::size_t(1) << SubBucketBits;
+  static constexpr int MaxMagnitude = 47;
+  static constexpr std::size_t NumBins = NumSubBuckets * (MaxMagnitude-SubBucketBits+2);
+
+  void record(std::int64_t ns, std::uint64_t n=1);
+
+  std::uint64_t count() const { return count_.get(); }
+  bool empty() const { return count() == 0; }
+  std::int64_t min() const { return empty() ? 0 : min_.get(); }
+  std::int64_t max() const { return max_.get(); }
+  double mean() const { return empty() ? 0.0 : static_cast<double>(sum_.get())/count(); }
+
+  /**
+   * @return the value below which a fraction q of the entries fall, as the
+   * middle of its bin; 0 if the histogram is empty.
+   */
+  std::int64_t percentile(double q) const;
+
+  void reset();
+  LatencyHistogram& operator+=(const LatencyHistogram& r);
+
+  /**
+   * @return a tree of count, mean, min, max and percentiles in seconds.
+   */
+  boost::property_tree::ptree to_property_tree() const;
+
+  /**
+   * print a line of count, mean, p50, p90, p99, p99.9 and max.
+   */
+  void print_line(std::ostream& os) const;
+
+  static std::size_t bin_of(std::int64_t ns);
+  static std::int64_t lower_edge(std::size_t bin);
+  static std::int64_t upper_edge(std::size_t bin);
+
+private:
+  std::array<SingleWriterValue<std::uint64_t>, NumBins> bins_;
+  SingleWriterValue<std::uint64_t> count_;
+  SingleWriterValue<std::int64_t> sum_;
+  SingleWriterValue<std::int64_t> min_{std::numeric_limits<std::int64_t>::max()};
+  SingleWriterValue<std::int64_t> max_;
+};
+
+} /* namespace anlnext */
+
+#endif /* ANLNEXT_LatencyHistogram_H */
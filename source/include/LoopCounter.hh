@@ -30,6 +30,7 @@ namespace anlnext
  *
  * @author Hirokazu Odaka
  * @date 2017-07-02 | based on struct ANLModuleCounter
+ * @date 2026-10-17 | count of gated events
  */
 class LoopCounter
 {
@@ -46,6 +47,11 @@ public:
   long int error() const { return error_; }
   long int skip() const { return skip_; }
   long int quit() const { return quit_; }
+
+  /**
+   * @return the number of events in which the module was skipped by its EVS gate.
+   */
+  long int gated() const { return gated_; }
   
   void reset()
   {
@@ -54,6 +60,7 @@ public:
     error_ = 0;
     skip_ = 0;
     quit_ = 0;
+    gated_ = 0;
   }
 
   void count_up_by_entry()
@@ -61,6 +68,11 @@ public:
     ++entry_;
   }
 
+  void count_up_by_gate()
+  {
+    ++gated_;
+  }
+
   void count_up_by_result(ANLStatus status)
   {
     if (is_error(status)) {
@@ -87,6 +99,7 @@ public:
     a.error_ += r.error_;
     a.skip_  += r.skip_;
     a.quit_  += r.quit_;
+    a.gated_ += r.gated_;
     return a;
   }
 
@@ -102,6 +115,7 @@ private:
   long int error_ = 0;
   long int skip_ = 0;
   long int quit_ = 0;
+  long int gated_ = 0;
 };
 
 } /* namespace anlnext */
@@ -0,0 +1,71 @@
+/*************************************************************************
+ *                                                                       *
+ * Copyright (c) 2011 Hirokazu Odaka                                     *
+ *                                                                       *
+ * This program is free software: you can redistribute it and/or modify  *
+ * it under the terms of the GNU General Public License as published by  *
+ * the Free Software Foundation, either version 3 of the License, or     *
+ * (at your option) any later version.                                   *
+ *                                                                       *
+ * This program is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ * GNU General Public License for more details.                          *
+ *                                                                       *
+ * You should have received a copy of the GNU General Public License     *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                       *
+ *************************************************************************/
+
+#ifndef ANLNEXT_ModuleHandle_H
+#define ANLNEXT_ModuleHandle_H 1
+
+#include <string>
+
+namespace anlnext
+{
+
+class BasicModule;
+
+/**
+ * A typed pointer to another module, which is given by
+ * BasicModule::get_module_handle() or get_module_handle_NC().
+ * The module is looked up and type-checked once when the handle is
+ * resolved, so a dereference is a single pointer load. A handle is valid
+ * for the chain of the module that resolved it; resolve it in
+ * mod_initialize(), which is called for every cloned chain.
+ *
+ * @author Hirokazu Odaka
+ * @date 2026-10-17
+ */
+template <typename T>
+class ModuleHandle
+{
+public:
+  ModuleHandle() = default;
+
+  T* get() const { return ptr_; }
+  T* operator->() const { return ptr_; }
+  T& operator*() const { return *ptr_; }
+  explicit operator bool() const { return ptr_ != nullptr; }
+
+private:
+  explicit ModuleHandle(T* ptr) : ptr_(ptr) {}
+  T* ptr_ = nullptr;
+
+  friend class BasicModule;
+};
+
+/**
+ * a module on which another module depends through a ModuleHandle.
+ */
+struct ModuleDependency
+{
+  const BasicModule* module;
+  std::string name;
+  bool writable;
+};
+
+} /* namespace anlnext */
+
+#endif /* ANLNEXT_ModuleHandle_H */
@@ -0,0 +1,128 @@
+/*************************************************************************
+ *                                                                       *
+ * Copyright (c) 2011 Hirokazu Odaka                                     *
+ *                                                                       *
+ * This program is free software: you can redistribute it and/or modify  *
+ * it under the terms of the GNU General Public License as published by  *
+ * the Free Software Foundation, either version 3 of the License, or     *
+ * (at your option) any later version.                                   *
+ *                                                                       *
+ * This program is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ * GNU General Public License for more details.                          *
+ *                                                                       *
+ * You should have received a copy of the GNU General Public License     *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                       *
+ *************************************************************************/
+
+#ifndef ANLNEXT_ModuleTiming_H
+#define ANLNEXT_ModuleTiming_H 1
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <boost/property_tree/ptree.hpp>
+
+#include "LatencyHistogram.hh"
+
+namespace anlnext
+{
+
+/**
+ * the phases in which the mod_*() methods of a module are called.
+ */
+enum class ModulePhase
+{
+  define, pre_initialize, initialize, begin_run, analyze, end_run, finalize
+};
+
+constexpr std::size_t NumModulePhases = 7;
+
+const char* module_phase_name(ModulePhase phase);
+
+/**
+ * Time spent in the mod_*() methods of a module, accumulated per phase.
+ * Each module (each clone in the multi-thread mode) has its own timing,
+ * which is updated only by the thread calling the module and can be read by
+ * the other threads. The calls of mod_analyze() are also filled in a
+ * latency histogram.
+ *
+ * The managers measure the calls with the monotonic clock only while the
+ * timing is enabled by set_enabled(); otherwise a call costs a relaxed load
+ * of the flag.
+ *
+ * @author Hirokazu Odaka
+ * @date 2026-10-17
+ * @date 2026-10-17 | latency histogram of mod_analyze()
+ */
+class ModuleTiming
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  static bool is_enabled() { return enabled_.load(std::memory_order_relaxed); }
+  static void set_enabled(bool v) { enabled_.store(v, std::memory_order_relaxed); }
+
+  /**
+   * add calls that took time t in total; the calls of mod_analyze() are
+   * each given the mean time in the latency histogram.
+   */
+  void add(ModulePhase phase, Clock::duration t, long int calls=1)
+  {
+    const std::size_t i = static_cast<std::size_t>(phase);
+    const std::int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t).count();
+    nanoseconds_[i].add(ns);
+    calls_[i].add(calls);
+    if (phase == ModulePhase::analyze && calls > 0) {
+      analyze_latency_.record(ns/calls, static_cast<std::uint64_t>(calls));
+    }
+  }
+
+  double seconds(ModulePhase phase) const
+  { return 1.0e-9 * nanoseconds_[static_cast<std::size_t>(phase)].get(); }
+  long int calls(ModulePhase phase) const
+  { return calls_[static_cast<std::size_t>(phase)].get(); }
+
+  const LatencyHistogram& analyze_latency() const { return analyze_latency_; }
+
+  /**
+   * @return the mean time of a call in the phase; 0 if it has not been called.
+   */
+  double mean_seconds(ModulePhase phase) const
+  {
+    const long int n = calls(phase);
+    return n > 0 ? seconds(phase)/n : 0.0;
+  }
+
+  double total_seconds() const;
+
+  /**
+   * @return the time of the phases before the event loop (define to begin_run).
+   */
+  double startup_seconds() const;
+
+  bool empty() const;
+  void reset();
+
+  ModuleTiming& operator+=(const ModuleTiming& r);
+
+  /**
+   * @return a tree of {phase: {seconds, calls}} of the phases called.
+   */
+  boost::property_tree::ptree to_property_tree() const;
+
+private:
+  std::array<SingleWriterValue<std::int64_t>, NumModulePhases> nanoseconds_;
+  std::array<SingleWriterValue<long int>, NumModulePhases> calls_;
+  LatencyHistogram analyze_latency_;
+
+  static std::atomic<bool> enabled_;
+};
+
+} /* namespace anlnext */
+
+#endif /* ANLNEXT_ModuleTiming_H */
@@ -28,6 +28,8 @@ namespace anlnext
 
 /**
  * OrderKeeper
+ * A simple implementation with a condition variable, which wakes all waiting threads.
+ * ANLManagerMT uses Sequencer instead.
  *
  * @author Hirokazu Odaka
  * @date 2017-07-12
@@ -55,6 +57,12 @@ public:
     cv_.notify_all();
   }
 
+  void reset()
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    last_done_index_ = -1;
+  }
+
 private:
   std::mutex mutex_;
   std::condition_variable cv_;
@@ -0,0 +1,144 @@
+/*************************************************************************
+ *                                                                       *
+ * Copyright (c) 2011 Hirokazu Odaka                                     *
+ *                                                                       *
+ * This program is free software: you can redistribute it and/or modify  *
+ * it under the terms of the GNU General Public License as published by  *
+ * the Free Software Foundation, either version 3 of the License, or     *
+ * (at your option) any later version.                                   *
+ *                                                                       *
+ * This program is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ * GNU General Public License for more details.                          *
+ *                                                                       *
+ * You should have received a copy of the GNU General Public License     *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                       *
+ *************************************************************************/
+
+#ifndef ANLNEXT_PerfCounters_H
+#define ANLNEXT_PerfCounters_H 1
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <boost/property_tree/ptree.hpp>
+
+#include "LatencyHistogram.hh"
+
+namespace anlnext
+{
+
+/**
+ * the hardware events counted by PerfCounters.
+ */
+enum class PerfEvent
+{
+  cycles, instructions, cache_misses, branch_misses
+};
+
+constexpr std::size_t NumPerfEvents = 4;
+
+const char* perf_event_name(PerfEvent event);
+
+/**
+ * Hardware event counts of the calls of mod_analyze() of a module.
+ * Like ModuleTiming, each module (each clone in the multi-thread mode) has
+ * its own counts, which are updated only by the thread calling the module.
+ *
+ * @author Hirokazu Odaka
+ * @date 2026-10-17
+ */
+class ModuleCounters
+{
+public:
+  using Values = std::array<std::uint64_t, NumPerfEvents>;
+
+  /**
+   * add the counts between two readings of PerfCounters for calls.
+   */
+  void add(const Values& begin, const Values& end, long int calls=1)
+  {
+    for (std::size_t i=0; i<NumPerfEvents; i++) {
+      if (end[i] > begin[i]) { counts_[i].add(end[i]-begin[i]); }
+    }
+    calls_.add(calls);
+  }
+
+  std::uint64_t count(PerfEvent event) const
+  { return counts_[static_cast<std::size_t>(event)].get(); }
+  long int calls() const { return calls_.get(); }
+
+  /**
+   * @return instructions per cycle.
+   */
+  double ipc() const;
+
+  /**
+   * @return misses of the event per 1000 instructions.
+   */
+  double misses_per_kilo_instructions(PerfEvent event) const;
+
+  bool empty() const { return calls() == 0; }
+  void reset();
+
+  ModuleCounters& operator+=(const ModuleCounters& r);
+
+  boost::property_tree::ptree to_property_tree() const;
+
+private:
+  std::array<SingleWriterValue<std::uint64_t>, NumPerfEvents> counts_;
+  SingleWriterValue<long int> calls_;
+};
+
+/**
+ * The hardware performance counters of the calling thread, opened by
+ * perf_event_open(2) in per-thread counting mode (user space only) at the
+ * first reading on each thread and kept open until the thread exits.
+ *
+ * set_enabled(true) opens the counters on the calling thread to check that
+ * they are available. In a kernel without perf events, or in a container
+ * that forbids them (see /proc/sys/kernel/perf_event_paranoid and seccomp),
+ * it prints the reason and leaves the counters disabled. The events that the
+ * CPU does not support are read as 0.
+ *
+ * The counts are scaled when the kernel multiplexes the counters.
+ *
+ * @author Hirokazu Odaka
+ * @date 2026-10-17
+ */
+class PerfCounters
+{
+public:
+  using Values = ModuleCounters::Values;
+
+  static bool is_enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+  /**
+   * @return true if the counters are enabled as requested.
+   */
+  static bool set_enabled(bool v);
+
+  /**
+   * @return true if the event was counted on the thread that enabled the counters.
+   */
+  static bool is_counted(PerfEvent event)
+  { return (counted_events_.load(std::memory_order_relaxed) >> static_cast<int>(event)) & 1u; }
+
+  /**
+   * read the counters of the calling thread.
+   * @return false if they are not available on this thread
+   */
+  static bool read(Values& values);
+
+private:
+  static std::atomic<bool> enabled_;
+  static std::atomic<unsigned int> counted_events_;
+};
+
+} /* namespace anlnext */
+
+#endif /* ANLNEXT_PerfCounters_H */
@@ -0,0 +1,124 @@
+/*************************************************************************
+ *                                                                       *
+ * Copyright (c) 2011 Hirokazu Odaka                                     *
+ *                                                                       *
+ * This program is free software: you can redistribute it and/or modify  *
+ * it under the terms of the GNU General Public License as published by  *
+ * the Free Software Foundation, either version 3 of the License, or     *
+ * (at your option) any later version.                                   *
+ *                                                                       *
+ * This program is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ * GNU General Public License for more details.                          *
+ *                                                                       *
+ * You should have received a copy of the GNU General Public License     *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                       *
+ *************************************************************************/
+
+#ifndef ANLNEXT_Sequencer_H
+#define ANLNEXT_Sequencer_H 1
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+namespace anlnext
+{
+
+/**
+ * Sequencer lets threads pass one after another in the order of event indices.
+ * It has the same interface as OrderKeeper, so it can be used in KeeperBlock.
+ *
+ * A waiting thread spins for a short time and then sleeps on one of the slots
+ * chosen by its index. send_done(i) wakes only the slot of index i+1,
+ * so that the other waiting threads are not woken up in vain.
+ * On Linux, a slot is a futex word; elsewhere it is a mutex and a condition variable.
+ *
+ * The time that the threads spend in the slow path of wait() is accumulated
+ * until the next reset(); a thread passing at once adds nothing. Each thread
+ * also accumulates the time it has waited at any sequencer
+ * (see thread_wait_time()).
+ *
+ * @author Hirokazu Odaka
+ * @date 2026-10-17
+ * @date 2026-10-17 | wait time
+ */
+class Sequencer
+{
+public:
+  Sequencer();
+  ~Sequencer();
+  Sequencer(const Sequencer&) = delete;
+  Sequencer(Sequencer&&) = delete;
+  Sequencer& operator=(const Sequencer&) = delete;
+  Sequencer& operator=(Sequencer&&) = delete;
+
+  void wait(long int index)
+  {
+    if (last_done_index_.load(std::memory_order_acquire) != index-1) {
+      wait_slow(index);
+    }
+  }
+
+  void send_done(long int index)
+  {
+    last_done_index_.store(index, std::memory_order_seq_cst);
+    wake(index+1);
+  }
+
+  void reset()
+  {
+    last_done_index_.store(-1, std::memory_order_seq_cst);
+    wait_nanoseconds_.store(0, std::memory_order_relaxed);
+    num_waits_.store(0, std::memory_order_relaxed);
+  }
+
+  /**
+   * @return the total time that the threads have waited, summed over the threads.
+   */
+  std::chrono::nanoseconds wait_time() const
+  { return std::chrono::nanoseconds(wait_nanoseconds_.load(std::memory_order_relaxed)); }
+
+  /**
+   * @return the number of waits that did not pass at once.
+   */
+  long int num_waits() const { return num_waits_.load(std::memory_order_relaxed); }
+
+  /**
+   * @return the total time that the calling thread has waited at any
+   * sequencer; it is never reset, so take the difference over a run.
+   */
+  static std::chrono::nanoseconds thread_wait_time()
+  { return std::chrono::nanoseconds(thread_wait_nanoseconds_); }
+
+  /**
+   * set the number of checks before a waiting thread sleeps.
+   */
+  void set_spin_count(int v) { spin_count_ = v; }
+  int spin_count() const { return spin_count_; }
+
+private:
+  struct Slot;
+  static constexpr long int NumSlots = 64;
+
+  void wait_slow(long int index);
+  void wake(long int index);
+
+private:
+  std::unique_ptr<Slot[]> slots_;
+  int spin_count_ = 2000;
+  char padding_[64];
+  std::atomic<long int> last_done_index_{-1};
+  char padding_end_[64];
+  std::atomic<std::int64_t> wait_nanoseconds_{0};
+  std::atomic<long int> num_waits_{0};
+
+  static thread_local std::int64_t thread_wait_nanoseconds_;
+};
+
+} /* namespace anlnext */
+
+#endif /* ANLNEXT_Sequencer_H */
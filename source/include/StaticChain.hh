@@ -0,0 +1,214 @@
+/*************************************************************************
+ *                                                                       *
+ * Copyright (c) 2011 Hirokazu Odaka                                     *
+ *                                                                       *
+ * This program is free software: you can redistribute it and/or modify  *
+ * it under the terms of the GNU General Public License as published by  *
+ * the Free Software Foundation, either version 3 of the License, or     *
+ * (at your option) any later version.                                   *
+ *                                                                       *
+ * This program is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ * GNU General Public License for more details.                          *
+ *                                                                       *
+ * You should have received a copy of the GNU General Public License     *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                       *
+ *************************************************************************/
+
+#ifndef ANLNEXT_StaticChain_H
+#define ANLNEXT_StaticChain_H 1
+
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "ANLManager.hh"
+#include "ANLManager_impl.hh"
+#include "BasicModule.hh"
+#include "EvsManager.hh"
+#include "EventStore.hh"
+#include "Tracer.hh"
+
+namespace anlnext
+{
+
+/**
+ * call mod_analyze() of a module of a static chain directly, without the
+ * virtual dispatch. This does the same as process_step().
+ */
+template <typename ModuleType>
+inline ANLStatus process_static_step(long int i_event, ModuleType& mod, LoopCounter& counter)
+{
+  if (mod.is_off()) {
+    return AS_OK;
+  }
+
+  if (mod.is_gated()) {
+    counter.count_up_by_gate();
+    return AS_OK;
+  }
+
+  counter.count_up_by_entry();
+
+  ANLStatus status = AS_OK;
+  try {
+    const bool timing = ModuleTiming::is_enabled();
+    const bool traced = Tracer::event_traced();
+    const bool counted = PerfCounters::is_enabled();
+    if (timing || traced || counted) {
+      PerfCounters::Values c0, c1;
+      const bool counting = counted && PerfCounters::read(c0);
+      const ModuleTiming::Clock::time_point t0 = ModuleTiming::Clock::now();
+      status = mod.ModuleType::mod_analyze();
+      const ModuleTiming::Clock::time_point t1 = ModuleTiming::Clock::now();
+      if (counting && PerfCounters::read(c1)) { mod.perf_counters().add(c0, c1); }
+      if (timing) { mod.timing().add(ModulePhase::analyze, t1-t0); }
+      if (traced) { Tracer::record("analyze", "module", &mod, i_event, t0, t1); }
+    }
+    else {
+      status = mod.ModuleType::mod_analyze();
+    }
+  }
+  catch (boost::exception& ex) {
+    ex << ErrorInfoOnLoopIndex(i_event);
+    ex << ErrorInfoOnMethod( mod.module_name() + "::mod_analyze" );
+    ex << ErrorInfoOnModuleID( mod.module_id() );
+    ex << ErrorInfoOnModuleName( mod.module_name() );
+    ex << ErrorInfoOnChainID( mod.copy_id() );
+    throw;
+  }
+
+  counter.count_up_by_result(status);
+  return eliminate_normal_error_status(status);
+}
+
+/**
+ * A module chain whose module types are fixed at compile time.
+ * The chain owns the modules, and the event loop over them is unrolled so
+ * that mod_analyze() of each module is called directly and can be inlined.
+ * Run it by StaticChainManager.
+ *
+ * @author Hirokazu Odaka
+ * @date 2026-10-17
+ */
+template <typename... ModuleTypes>
+class StaticChain
+{
+public:
+  using tuple_type = std::tuple<ModuleTypes...>;
+
+  template <std::size_t I>
+  using module_type = typename std::tuple_element<I, tuple_type>::type;
+
+  static constexpr std::size_t size() { return sizeof...(ModuleTypes); }
+
+  template <std::size_t I>
+  module_type<I>& get() { return std::get<I>(modules_); }
+
+  template <std::size_t I>
+  const module_type<I>& get() const { return std::get<I>(modules_); }
+
+  std::vector<BasicModule*> modules()
+  { return modules_impl(std::index_sequence_for<ModuleTypes...>()); }
+
+  /**
+   * process one event by the modules in order.
+   * @param counters the loop counters of the modules
+   */
+  ANLStatus process(long int i_event, LoopCounter* counters)
+  {
+    set_loop_index(i_event, std::index_sequence_for<ModuleTypes...>());
+    return process_from(i_event, counters, std::integral_constant<std::size_t, 0>());
+  }
+
+private:
+  template <std::size_t... I>
+  std::vector<BasicModule*> modules_impl(std::index_sequence<I...>)
+  { return { static_cast<BasicModule*>(&std::get<I>(modules_))... }; }
+
+  template <std::size_t... I>
+  void set_loop_index(long int i_event, std::index_sequence<I...>)
+  {
+    using expand = int[];
+    (void)expand{0, (std::get<I>(modules_).set_loop_index(i_event), 0)...};
+  }
+
+  ANLStatus process_from(long int, LoopCounter*,
+                         std::integral_constant<std::size_t, sizeof...(ModuleTypes)>)
+  { return AS_OK; }
+
+  template <std::size_t I>
+  ANLStatus process_from(long int i_event, LoopCounter* counters,
+                         std::integral_constant<std::size_t, I>)
+  {
+    const ANLStatus status = process_static_step(i_event, std::get<I>(modules_), counters[I]);
+    if (status != AS_OK) {
+      return status;
+    }
+    return process_from(i_event, counters, std::integral_constant<std::size_t, I+1>());
+  }
+
+private:
+  tuple_type modules_;
+};
+
+/**
+ * A single-thread manager that runs a StaticChain. The lifecycle routines,
+ * EVS, the event store, the counters and the module access are the same as
+ * those of ANLManager; only the event loop is compiled for the chain.
+ * Modules switched on or off during the loop take effect immediately.
+ *
+ * @author Hirokazu Odaka
+ * @date 2026-10-17
+ */
+template <typename... ModuleTypes>
+class StaticChainManager : public ANLManager
+{
+public:
+  using chain_type = StaticChain<ModuleTypes...>;
+
+  StaticChainManager()
+  {
+    set_modules(chain_.modules());
+  }
+
+  StaticChainManager(const StaticChainManager&) = delete;
+  StaticChainManager& operator=(const StaticChainManager&) = delete;
+
+  chain_type& chain() { return chain_; }
+  const chain_type& chain() const { return chain_; }
+
+protected:
+  ANLStatus process_analysis() override
+  {
+    return event_loop([this](long int, long int i_event, ANLStatus& status) {
+        status = process_static_event(i_event);
+        return 1L;
+      });
+  }
+
+private:
+  ANLStatus process_static_event(long int i_event)
+  {
+    Tracer::begin_event(i_event);
+    evs_manager_->reset_all_flags();
+    event_store_->reset_event();
+    const ANLStatus status = chain_.process(i_event, counters_.data());
+    // the plan is not used to process the event, but it counts the events
+    // for the Put and Get of the summary.
+    execution_plan_.count_event(status);
+    count_evs(i_event, status, *evs_manager_);
+    return status;
+  }
+
+private:
+  chain_type chain_;
+};
+
+} /* namespace anlnext */
+
+#endif /* ANLNEXT_StaticChain_H */
@@ -0,0 +1,95 @@
+/*************************************************************************
+ *                                                                       *
+ * Copyright (c) 2011 Hirokazu Odaka                                     *
+ *                                                                       *
+ * This program is free software: you can redistribute it and/or modify  *
+ * it under the terms of the GNU General Public License as published by  *
+ * the Free Software Foundation, either version 3 of the License, or     *
+ * (at your option) any later version.                                   *
+ *                                                                       *
+ * This program is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ * GNU General Public License for more details.                          *
+ *                                                                       *
+ * You should have received a copy of the GNU General Public License     *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                       *
+ *************************************************************************/
+
+#ifndef ANLNEXT_ThreadAffinity_H
+#define ANLNEXT_ThreadAffinity_H 1
+
+#include <vector>
+
+namespace anlnext
+{
+
+/**
+ * scoped enum to select how the analysis threads are bound to CPUs.
+ *
+ * none: threads are not bound.
+ * compact: threads fill the CPUs of one socket before moving to the next.
+ * scatter: threads are spread over the sockets in turn.
+ * cpu_list: thread i is bound to the i-th CPU of a given list.
+ */
+enum class AffinityPolicy {
+  none,
+  compact,
+  scatter,
+  cpu_list,
+};
+
+/**
+ * CPU assignment of the analysis threads.
+ * The CPUs allowed for the process are ordered according to the policy
+ * by using the socket and core IDs, and thread i takes the i-th CPU
+ * (cyclically if there are more threads than CPUs).
+ * Binding is supported only on Linux; elsewhere bind() does nothing.
+ *
+ * @author Hirokazu Odaka
+ * @date 2026-10-17
+ */
+class ThreadAffinity
+{
+public:
+  void set_policy(AffinityPolicy v) { policy_ = v; }
+  AffinityPolicy policy() const { return policy_; }
+
+  /**
+   * set the CPUs of the threads, and select the cpu_list policy.
+   */
+  void set_cpu_list(const std::vector<int>& v)
+  {
+    cpu_list_ = v;
+    policy_ = AffinityPolicy::cpu_list;
+  }
+  const std::vector<int>& cpu_list() const { return cpu_list_; }
+
+  bool enabled() const { return policy_ != AffinityPolicy::none; }
+
+  /**
+   * determine the order of CPUs for the current policy.
+   */
+  void setup();
+
+  /**
+   * @return the CPU assigned to thread i_thread, or -1 if there is none.
+   */
+  int cpu_for_thread(int i_thread) const;
+
+  /**
+   * bind the calling thread to the CPU assigned to thread i_thread.
+   * @return false if the thread is not bound.
+   */
+  bool bind(int i_thread) const;
+
+private:
+  AffinityPolicy policy_ = AffinityPolicy::none;
+  std::vector<int> cpu_list_;
+  std::vector<int> cpus_;
+};
+
+} /* namespace anlnext */
+
+#endif /* ANLNEXT_ThreadAffinity_H */
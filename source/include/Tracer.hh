@@ -0,0 +1,151 @@
+/*************************************************************************
+ *                                                                       *
+ * Copyright (c) 2011 Hirokazu Odaka                                     *
+ *                                                                       *
+ * This program is free software: you can redistribute it and/or modify  *
+ * it under the terms of the GNU General Public License as published by  *
+ * the Free Software Foundation, either version 3 of the License, or     *
+ * (at your option) any later version.                                   *
+ *                                                                       *
+ * This program is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ * GNU General Public License for more details.                          *
+ *                                                                       *
+ * You should have received a copy of the GNU General Public License     *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                       *
+ *************************************************************************/
+
+#ifndef ANLNEXT_Tracer_H
+#define ANLNEXT_Tracer_H 1
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ModuleTiming.hh"
+
+namespace anlnext
+{
+
+class BasicModule;
+
+/**
+ * A tracer of the execution of the chains, which records spans (module
+ * calls, keeper waits, event dispatch, lifecycle phases and reduction) and
+ * writes them in the Chrome trace JSON format, which can be opened by
+ * chrome://tracing or Perfetto.
+ *
+ * Each thread records its spans into its own ring buffer without locks; a
+ * buffer keeps the latest spans of its thread. The spans of an event are
+ * recorded only if the event is sampled: its loop index is in the range
+ * selected by start() and a multiple of the period from its beginning.
+ * The lifecycle phases and the reduction are always recorded.
+ *
+ * The tracer is global. start(), write() and clear() must be called while
+ * no thread is recording, i.e. between runs, because the threads write their
+ * buffers without locks.
+ *
+ * @author Hirokazu Odaka
+ * @date 2026-10-17
+ * @date 2026-10-17 | module IDs copied when recorded
+ */
+class Tracer
+{
+public:
+  using Clock = ModuleTiming::Clock;
+
+  struct Span
+  {
+    const char* name = nullptr;
+    const char* category = nullptr;
+    std::string module_id;
+    long int event = -1;
+    std::int64_t begin = 0;
+    std::int64_t end = 0;
+  };
+
+  /**
+   * start tracing the events [first_event, last_event] (no upper limit if
+   * last_event is negative) every period events, keeping the latest
+   * capacity spans per thread. The spans recorded so far are cleared.
+   * Call this between runs only.
+   */
+  static void start(long int first_event, long int last_event, long int period,
+                    std::size_t capacity=65536);
+  static void stop() { enabled_.store(false, std::memory_order_relaxed); }
+  static bool is_enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+  static bool is_sampled(long int i_event)
+  {
+    return (i_event >= first_event_
+            && (last_event_ < 0 || i_event <= last_event_)
+            && (i_event-first_event_) % period_ == 0);
+  }
+
+  /**
+   * set the event processed by the current thread, whose spans are
+   * recorded if it is sampled.
+   */
+  static void begin_event(long int i_event)
+  {
+    current_event_ = i_event;
+    event_traced_ = is_enabled() && is_sampled(i_event);
+  }
+
+  /**
+   * @return true if the spans of the current event of this thread are recorded.
+   */
+  static bool event_traced() { return event_traced_; }
+  static long int current_event() { return current_event_; }
+
+  /**
+   * record a span of the current thread.
+   * @param name a string that lives as long as the tracer, e.g. a literal
+   * @param module the module called, if any; its ID is copied, since the
+   * module may be destroyed before write(), and shown as the name
+   */
+  static void record(const char* name, const char* category, const BasicModule* module,
+                     long int event, Clock::time_point begin, Clock::time_point end);
+
+  static void clear();
+
+  /**
+   * write the spans of all the threads into a Chrome trace JSON file.
+   * @return the number of spans written
+   */
+  static std::size_t write(const std::string& filename);
+
+private:
+  struct Buffer
+  {
+    int thread_id = 0;
+    std::vector<Span> spans;
+    std::size_t next = 0;
+  };
+
+  static Buffer* thread_buffer();
+
+private:
+  static std::atomic<bool> enabled_;
+  static long int first_event_;
+  static long int last_event_;
+  static long int period_;
+  static std::size_t capacity_;
+  static Clock::time_point origin_;
+  static std::mutex mutex_;
+  static std::vector<std::unique_ptr<Buffer>> buffers_;
+
+  static thread_local Buffer* buffer_;
+  static thread_local long int current_event_;
+  static thread_local bool event_traced_;
+};
+
+} /* namespace anlnext */
+
+#endif /* ANLNEXT_Tracer_H */
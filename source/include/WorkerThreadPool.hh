@@ -0,0 +1,82 @@
+/*************************************************************************
+ *                                                                       *
+ * Copyright (c) 2011 Hirokazu Odaka                                     *
+ *                                                                       *
+ * This program is free software: you can redistribute it and/or modify  *
+ * it under the terms of the GNU General Public License as published by  *
+ * the Free Software Foundation, either version 3 of the License, or     *
+ * (at your option) any later version.                                   *
+ *                                                                       *
+ * This program is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ * GNU General Public License for more details.                          *
+ *                                                                       *
+ * You should have received a copy of the GNU General Public License     *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                       *
+ *************************************************************************/
+
+#ifndef ANLNEXT_WorkerThreadPool_H
+#define ANLNEXT_WorkerThreadPool_H 1
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+
+namespace anlnext
+{
+
+/**
+ * A pool of persistent worker threads.
+ * Worker i always executes the i-th part of a task, so that a worker can be bound to a module chain.
+ * The workers park between tasks and are joined when the pool is destroyed.
+ *
+ * @author Hirokazu Odaka
+ * @date 2026-10-17
+ */
+class WorkerThreadPool
+{
+public:
+  WorkerThreadPool() = default;
+  ~WorkerThreadPool();
+  WorkerThreadPool(const WorkerThreadPool&) = delete;
+  WorkerThreadPool(WorkerThreadPool&&) = delete;
+  WorkerThreadPool& operator=(const WorkerThreadPool&) = delete;
+  WorkerThreadPool& operator=(WorkerThreadPool&&) = delete;
+
+  /**
+   * launch worker threads. Nothing is done if the pool already has them.
+   */
+  void start(int num_threads);
+  void stop();
+
+  int size() const { return static_cast<int>(threads_.size()); }
+
+  /**
+   * execute task(i) on every worker i and wait for all of them.
+   * An exception thrown by a task is rethrown on the calling thread.
+   */
+  void run(const std::function<void(int)>& task);
+
+private:
+  void work(int i_thread, unsigned long int done_generation);
+
+private:
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable start_cv_;
+  std::condition_variable done_cv_;
+  const std::function<void(int)>* task_ = nullptr;
+  unsigned long int generation_ = 0;
+  int num_running_ = 0;
+  bool stopping_ = false;
+  std::exception_ptr exception_;
+};
+
+} /* namespace anlnext */
+
+#endif /* ANLNEXT_WorkerThreadPool_H */
@@ -59,6 +59,25 @@ enum class ANLStatus {
 
 std::string status_to_string(ANLStatus status);
 
+enum class EventSchedule {
+  dynamic,
+  guided,
+  work_stealing,
+};
+
+enum class ExecutionMode {
+  event_parallel,
+  pipeline,
+  farm,
+};
+
+enum class AffinityPolicy {
+  none,
+  compact,
+  scatter,
+  cpu_list,
+};
+
 struct ANLException
 {
   static void SetVerboseLevel(int v);
@@ -154,6 +173,9 @@ class BasicModule
   void set_order_sensitive(bool v);
   bool is_order_sensitive() const;
 
+  void set_stage_head(bool v=true);
+  bool is_stage_head() const;
+
   void set_singleton(int copyID);
   void unset_singleton();
   bool is_singleton() const;
@@ -169,6 +191,9 @@ class BasicModule
   void off();
   bool is_on();
   bool is_off();
+
+  void set_evs_gate(const std::string& expression);
+  std::string evs_gate() const;
   
   %exception{
     try {
@@ -259,6 +284,19 @@ class ANLManager
 
   void set_display_period(long int v);
   int display_period() const;
+
+  void set_batch_size(long int v);
+  long int batch_size() const;
+  void set_reordering_warmup(long int v);
+  long int reordering_warmup() const;
+  void set_intra_event_threads(int v);
+  int intra_event_threads() const;
+  void set_module_timing(bool v);
+  bool module_timing() const;
+  bool set_perf_counters(bool v);
+  bool perf_counters() const;
+  void set_trace(const std::string& filename,
+                 long int first_event=0, long int last_event=-1, long int period=1);
   
   void set_modules(std::vector<anlnext::BasicModule*> modules);
 
@@ -275,6 +313,11 @@ class ANLManager
 
   void parameters_to_json(const std::string& filename) const;
 
+  void set_evs_index_output(const std::string& filename);
+  std::string evs_index_output() const;
+  void set_event_selection(const std::string& index_file, const std::string& expression);
+  void clear_event_selection();
+
   virtual ANLStatus do_interactive_comunication();
   virtual ANLStatus do_interactive_analysis();
 
@@ -286,6 +329,24 @@ class ANLManagerMT : public ANLManager
 public:
   explicit ANLManagerMT(int num_parallels=1);
   virtual ~ANLManagerMT();
+
+  void set_event_schedule(EventSchedule v);
+  EventSchedule event_schedule() const;
+  void set_chunk_size(long int v);
+  long int chunk_size() const;
+  void set_execution_mode(ExecutionMode v);
+  ExecutionMode execution_mode() const;
+  void set_pipeline_depth(int v);
+  int pipeline_depth() const;
+  void set_parallel_routines(bool v=true);
+  bool parallel_routines() const;
+  void set_snapshot_period(long int num_events, double seconds=0.0);
+  long int snapshot_period_events() const;
+  double snapshot_period_seconds() const;
+  void set_affinity_policy(AffinityPolicy v);
+  AffinityPolicy affinity_policy() const;
+  void set_cpu_list(const std::vector<int>& v);
+  std::vector<int> cpu_list() const;
 };
  
 } /* namespace anlnext */
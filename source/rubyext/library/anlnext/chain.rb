@@ -78,7 +78,15 @@ module ANL
       :modify, :modify_parameters,
       :define, :load_all_parameters,
       :print_all_parameters, :parameters_to_object, :make_doc,
-      :num_parallels, :num_parallels=,
+      :num_parallels, :num_parallels=, :set_num_parallels,
+      :event_schedule, :event_schedule=, :chunk_size, :chunk_size=,
+      :execution_mode, :execution_mode=, :stage_boundary, :gate,
+      :parallel_routines, :parallel_routines=, :set_snapshot_period,
+      :thread_affinity, :thread_affinity=, :set_thread_affinity,
+      :evs_index_output, :evs_index_output=, :set_event_selection,
+      :batch_size, :batch_size=, :reordering_warmup, :reordering_warmup=,
+      :intra_event_threads, :intra_event_threads=,
+      :module_timing, :module_timing=, :perf_counters, :perf_counters=, :set_trace,
       :display_period=,
     ]
     def_delegators :@_anlapp_analysis_chain, *anlapp_methods
@@ -154,6 +162,22 @@ module ANL
                                           namespace: namespace,
                                           app_name: app_name)
     end
+
+    def make_main(output: nil,
+                  headers: nil,
+                  namespace: nil,
+                  num_loop: 100000)
+      if @_anlapp_analysis_chain.chain_empty?
+        setup()
+      end
+
+      app_name = self.class.to_s
+      @_anlapp_analysis_chain.make_main(output: output,
+                                        headers: headers,
+                                        namespace: namespace,
+                                        num_loop: num_loop,
+                                        app_name: app_name)
+    end
   end
 
 
@@ -165,6 +189,21 @@ module ANL
     def initialize()
       @console = true
       @num_parallels = 1
+      @event_schedule = :dynamic
+      @chunk_size = 0
+      @execution_mode = :event_parallel
+      @stage_boundary = false
+      @parallel_routines = false
+      @snapshot_period = nil
+      @thread_affinity = nil
+      @evs_index_output = nil
+      @event_selection = nil
+      @batch_size = nil
+      @reordering_warmup = nil
+      @intra_event_threads = nil
+      @module_timing = nil
+      @perf_counters = nil
+      @trace = nil
       @display_period = nil
       @parameters_json_filename = nil
       @parameters_json_master = true
@@ -180,11 +219,92 @@ module ANL
     # Accessors to internal information (instance variables).
     attr_accessor :console
     attr_accessor :num_parallels
+    attr_accessor :event_schedule
+    attr_accessor :chunk_size
+    attr_accessor :execution_mode
+    attr_accessor :parallel_routines
+    attr_accessor :thread_affinity
+    attr_accessor :evs_index_output
+    attr_accessor :batch_size
+    attr_accessor :reordering_warmup
+    attr_accessor :intra_event_threads
+    attr_accessor :module_timing
+    attr_accessor :perf_counters
     attr_accessor :current_module
     attr_accessor :display_period
     attr_accessor :parameters_json_filename
     attr_accessor :parameters_json_master
 
+    # Set the number of parallel chains and how events are scheduled.
+    #
+    # @param [Integer] num number of parallel chains (threads).
+    # @param [Symbol] event_schedule :dynamic, :guided, or :work_stealing.
+    # @param [Integer] chunk_size number of events taken at once. 0 for automatic.
+    #
+    def set_num_parallels(num, event_schedule: nil, chunk_size: nil)
+      @num_parallels = num
+      @event_schedule = event_schedule if event_schedule
+      @chunk_size = chunk_size if chunk_size
+    end
+
+    # Take snapshots of the module results during the analysis loop
+    # in the multi-thread mode. Only modules supporting snapshots are included.
+    #
+    # @param [Integer] events period in number of events. 0 for none.
+    # @param [Float] seconds period in seconds. 0 for none.
+    #
+    def set_snapshot_period(events: 0, seconds: 0.0)
+      @snapshot_period = [events, seconds]
+    end
+
+    # Bind the analysis threads to CPUs in the multi-thread mode.
+    # Then the modules of each chain are initialized on its own thread.
+    #
+    # @param [Symbol, Array] policy :compact, :scatter, or an array of
+    #   CPU numbers whose i-th element is used by thread i.
+    #
+    def set_thread_affinity(policy)
+      @thread_affinity = policy
+    end
+
+    # Process only the events that satisfy an expression of EVS keys
+    # (e.g. "good && !pileup"), using an EVS index file written by a
+    # previous run with evs_index_output. The number of loops then counts
+    # the selected events.
+    #
+    # @param [String] index_file EVS index file.
+    # @param [String] expression selection by EVS keys with !, &&, ||, and ().
+    #
+    def set_event_selection(index_file, expression)
+      @event_selection = [index_file, expression]
+    end
+
+    # Trace the execution into a Chrome trace JSON file, which can be
+    # opened by chrome://tracing or Perfetto. The file is written by
+    # Finalize().
+    #
+    # @param [String] filename output JSON file.
+    # @param [Integer] first_event first event traced.
+    # @param [Integer] last_event last event traced; -1 for no limit.
+    # @param [Integer] period trace every period events.
+    #
+    def set_trace(filename, first_event=0, last_event=-1, period=1)
+      @trace = [filename, first_event, last_event, period]
+    end
+
+    # Start a new pipeline stage from the next module pushed to the chain.
+    # This takes effect when execution_mode is :pipeline or :farm.
+    # In the farm mode, the first stage is the head, the last stage is
+    # the tail (if there are three stages or more), and the others run
+    # on num_parallels cloned chains.
+    # A redo (AS_REDO) re-runs only the stage of the module that gives it,
+    # so a module that should redraw the event on a redo must be in the
+    # same stage.
+    #
+    def stage_boundary()
+      @stage_boundary = true
+    end
+
     # Clear all internal information on the analysis chain.
     # But it keeps setting not strongly related to the chain.
     # (e.g., console, parallel number, display period)
@@ -196,6 +316,7 @@ module ANL
       @set_param_list.clear
       @namespace_list.clear; @namespace_list << Object
       @modification_block = nil
+      @stage_boundary = false
       @stage = nil
     end
 
@@ -231,9 +352,18 @@ module ANL
       end
       @module_hash[module_id] = anl_module
       @module_list << anl_module
+      mark_stage_head(anl_module)
       @current_module = anl_module
     end
 
+    def mark_stage_head(anl_module)
+      if @stage_boundary
+        anl_module.set_stage_head(true)
+        @stage_boundary = false
+      end
+    end
+    private :mark_stage_head
+
     # Insert an ANL module to the module chain at a specified position.
     #
     # @param [Integer] index position to be inserted.
@@ -247,6 +377,7 @@ module ANL
       end
       @module_hash[module_id] = anl_module
       @module_list.insert(index, anl_module)
+      mark_stage_head(anl_module)
       @current_module = anl_module
     end
 
@@ -351,6 +482,17 @@ module ANL
       return
     end
 
+    # Set an EVS predicate gating the current module.
+    # mod_analyze() of the module is called only in the events in which the
+    # predicate is satisfied; the other events are counted as gated.
+    #
+    # @param [String] expression EVS predicate, e.g. "HitFound && !Saturated".
+    #
+    def gate(expression)
+      @current_module.set_evs_gate(expression.to_s)
+      return
+    end
+
     # Set a parameter of the current module.
     # Before the ANL definition stage, this method reserves parameter setting,
     # and acctual setting to the ANL module object is performed after the
@@ -665,12 +807,36 @@ module ANL
     # Execute the ANL definition stage.
     #
     def define()
-      if @num_parallels > 1
+      if @execution_mode == :pipeline
+        @anl = ANL::ANLManagerMT.new
+        @anl.set_execution_mode(ANL::ExecutionMode_pipeline)
+      elsif @execution_mode == :farm
+        @anl = ANL::ANLManagerMT.new(@num_parallels)
+        @anl.set_execution_mode(ANL::ExecutionMode_farm)
+      elsif @num_parallels > 1
         @anl = ANL::ANLManagerMT.new(@num_parallels)
+        @anl.set_event_schedule(ANL.const_get("EventSchedule_#{@event_schedule}"))
+        @anl.set_chunk_size(@chunk_size)
       else
         @anl = ANL::ANLManager.new
       end
 
+      if @anl.is_a?(ANL::ANLManagerMT)
+        @anl.set_parallel_routines(@parallel_routines)
+        @anl.set_snapshot_period(*@snapshot_period) if @snapshot_period
+        if @thread_affinity.is_a?(Array)
+          @anl.set_cpu_list(ANL::VectorI.new(@thread_affinity))
+        elsif @thread_affinity
+          @anl.set_affinity_policy(ANL.const_get("AffinityPolicy_#{@thread_affinity}"))
+        end
+      end
+
+      @anl.set_reordering_warmup(@reordering_warmup) if @reordering_warmup
+      @anl.set_intra_event_threads(@intra_event_threads) if @intra_event_threads
+      @anl.set_module_timing(@module_timing) unless @module_timing.nil?
+      @anl.set_perf_counters(@perf_counters) unless @perf_counters.nil?
+      @anl.set_trace(*@trace) if @trace
+
       vec = ANL::ModuleVector.new(@module_list)
       @anl.set_modules(vec)
 
@@ -730,6 +896,9 @@ module ANL
       puts "<Begin Analysis> | Time: " + Time.now.to_s
       $stdout.flush
       anl.set_display_period(@display_period)
+      anl.set_batch_size(@batch_size) if @batch_size
+      anl.set_evs_index_output(@evs_index_output) if @evs_index_output
+      anl.set_event_selection(*@event_selection) if @event_selection
       status = anl.Analyze(num_loop, @console)
       puts ""
       puts "<End Analysis>   | Time: " + Time.now.to_s
@@ -1015,6 +1184,147 @@ module ANL
       out.puts "anl.run(num_loop)"
       out.close if output
     end
+
+    # Make a C++ main program that runs this ANL chain as a static chain
+    # (anlnext::StaticChainManager), whose event loop is compiled for the
+    # module types. The module IDs, EVS gates, switches and parameters are
+    # taken from the chain after the definition stage.
+    #
+    # @param [STRING] output output source filename. If nil, output to STDOUT.
+    # @param [Array<STRING>] headers header files of the modules.
+    #     By default, "<module name>.hh" for each module.
+    # @param [STRING] namespace C++ namespace of the module classes.
+    # @param [Integer] num_loop number of loops when not given as the
+    #     first argument of the program.
+    # @param [STRING] app_name class name of the application
+    #
+    def make_main(output: nil,
+                  headers: nil,
+                  namespace: nil,
+                  num_loop: 100000,
+                  app_name: "MyApp")
+      define() unless self.definition_already_done?
+      load_all_parameters() unless @stage == :loading_parameters_done
+
+      prefix = namespace ? namespace+'::' : ''
+      headers ||= @module_list.map{|mod| mod.module_name+'.hh' }.uniq
+      module_types = @module_list.map{|mod| prefix+mod.module_name }
+
+      out = output ? File::open(output, 'w') : STDOUT
+      out.puts "// main program of #{app_name}"
+      out.puts '// generated by ANL::ANLApp#make_main()'
+      out.puts ''
+      out.puts '#include <cstdlib>'
+      out.puts '#include <string>'
+      out.puts '#include <vector>'
+      out.puts '#include <anlnext/StaticChain.hh>'
+      out.puts ''
+      headers.each do |header|
+        out.puts '#include "'+header+'"'
+      end
+      out.puts ''
+      out.puts 'using namespace anlnext;'
+      out.puts ''
+      out.puts 'int main(int argc, char** argv)'
+      out.puts '{'
+      out.puts "  const long int num_loop = (argc > 1) ? std::atol(argv[1]) : #{num_loop};"
+      out.puts ''
+      out.puts '  StaticChainManager<'+module_types.join(",\n                     ")+'> anl;'
+      @module_list.each_with_index do |mod, i|
+        if mod.module_id != mod.module_name
+          out.puts "  anl.chain().get<#{i}>().set_module_id(#{cxx_string(mod.module_id)});"
+        end
+        unless mod.evs_gate.empty?
+          out.puts "  anl.chain().get<#{i}>().set_evs_gate(#{cxx_string(mod.evs_gate)});"
+        end
+      end
+      if @display_period
+        out.puts "  anl.set_display_period(#{@display_period});"
+      end
+      out.puts ''
+      out.puts '  try {'
+      out.puts '    if (anl.Define() != AS_OK) { return 1; }'
+      out.puts ''
+      @module_list.each_with_index do |mod, i|
+        lines = mod.parameter_list.map{|param| cxx_parameter_setting(param) }.flatten
+        next if lines.empty?
+        out.puts "    {"
+        out.puts "      auto& mod = anl.chain().get<#{i}>();"
+        lines.each{|line| out.puts '      '+line }
+        out.puts "    }"
+      end
+      @module_list.each_with_index do |mod, i|
+        if mod.is_off
+          out.puts "    anl.chain().get<#{i}>().off();"
+        end
+      end
+      out.puts ''
+      out.puts '    if (anl.PreInitialize() != AS_OK) { return 1; }'
+      out.puts '    if (anl.Initialize() != AS_OK) { return 1; }'
+      out.puts '    if (anl.Analyze(num_loop, false) != AS_OK) { return 1; }'
+      out.puts '    if (anl.Finalize() != AS_OK) { return 1; }'
+      out.puts '  }'
+      out.puts '  catch (ANLException& ex) {'
+      out.puts '    print_exception(ex);'
+      out.puts '    return 1;'
+      out.puts '  }'
+      out.puts ''
+      out.puts '  return 0;'
+      out.puts '}'
+      out.close if output
+    end
+
+    def cxx_string(s)
+      '"'+s.to_s.gsub(/["\\]/){|c| "\\"+c }.gsub("\n", "\\n")+'"'
+    end
+    private :cxx_string
+
+    def cxx_value(v)
+      case v
+      when String
+        'std::string('+cxx_string(v)+')'
+      else
+        v.to_s
+      end
+    end
+    private :cxx_value
+
+    # @return [Array<String>] C++ statements that set the current value of
+    #     the parameter to a module referred to as "mod".
+    def cxx_parameter_setting(param)
+      name = cxx_string(param.name)
+      type = param.type_name
+      case type
+      when 'map'
+        param.to_value_object.map do |key, elements|
+          ["mod.expose_parameter(#{name});",
+           "mod.set_map_key(#{cxx_string(key)});"] +
+            elements.map{|k, v| "mod.set_value_element(#{cxx_string(k)}, #{cxx_value(v)});" } +
+            ["mod.insert_to_container();"]
+        end.flatten
+      when 'vector'
+        ["// #{param.name}: a vector of structures is not reproduced; set it in the module."]
+      when 'vector<int>', 'vector<double>', 'vector<string>'
+        values = param.to_value_object
+        if values.empty?
+          ["mod.clear_array(#{name});"]
+        else
+          element_type = {'vector<int>'=>'int', 'vector<double>'=>'double', 'vector<string>'=>'std::string'}[type]
+          ["mod.set_parameter(#{name}, std::vector<#{element_type}>{#{values.map{|v| v.is_a?(String) ? cxx_string(v) : v.to_s }.join(', ')}});"]
+        end
+      when '2-vector', '3-vector'
+        v = param.to_value_object
+        v = [v.x, v.y, v.z].compact if v.respond_to?(:x)
+        ["mod.set_parameter(#{name}, #{v.map{|x| x.to_f.to_s }.join(', ')});"]
+      when 'int', 'integer'
+        ["mod.set_parameter_integer(#{name}, #{param.to_value_object});"]
+      when 'bool', 'double', 'string'
+        ["mod.set_parameter(#{name}, #{cxx_value(param.to_value_object)});"]
+      else
+        ["// #{param.name}: type #{type} is not reproduced; set it in the module."]
+      end
+    end
+    private :cxx_parameter_setting
   end
 
 end # module ANL
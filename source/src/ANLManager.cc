@@ -20,6 +20,8 @@
 #include "ANLManager.hh"
 
 #include <iomanip>
+#include <sstream>
+#include <chrono>
 #include <algorithm>
 #include <functional>
 #include <memory>
@@ -37,9 +39,12 @@
 #include "BasicModule.hh"
 #include "EvsManager.hh"
 #include "ModuleAccess.hh"
+#include "Tracer.hh"
 #include "ANLException.hh"
 #include "ANLManager_impl.hh"
 #include "OrderKeeper.hh"
+#include "Sequencer.hh"
+#include "WorkerThreadPool.hh"
 
 #if ANLNEXT_USE_READLINE
 #include <unistd.h>
@@ -63,6 +68,7 @@ ANLManager::ANLManager()
   : print_clone_parameters_(false),
     num_events_(0),
     evs_manager_(new EvsManager),
+    event_store_(new EventStore),
     requested_(ANLRequest::none),
     exception_propagation_(true),
     display_period_(-1),
@@ -80,6 +86,7 @@ void ANLManager::set_modules(std::vector<BasicModule*> modules)
 
   for (BasicModule* mod: modules_) {
     mod->set_evs_manager(evs_manager_.get());
+    mod->set_event_store(event_store_.get());
     mod->set_module_access(module_access_.get());
   }
 
@@ -194,6 +201,14 @@ ANLStatus ANLManager::Initialize()
     goto final;
   }
 
+  dependency_graph_.build(modules_);
+  if (!dependency_graph_.empty()) {
+    dependency_graph_.print();
+  }
+
+  build_execution_plans();
+  stop_dependency_recording();
+
   final:
     std::cout << std::endl;
 #if ANLNEXT_INITIALIZE_INTERRUPT
@@ -217,8 +232,21 @@ ANLStatus ANLManager::Analyze(long int num_events, bool enable_console)
   num_events_ = num_events;
   requested_ = ANLRequest::none;
 
-  std::cout << "Number of events: " << num_events << '\n'
-            << std::endl;
+  if (event_selection_) {
+    const long int num_selected = event_selection_->size();
+    if (num_events < 0 || num_selected < num_events) {
+      num_events_ = num_selected;
+    }
+    std::cout << "Number of events: " << num_events_
+              << " (selected by EVS: " << event_selection_expression_ << ")\n"
+              << std::endl;
+  }
+  else {
+    std::cout << "Number of events: " << num_events << '\n'
+              << std::endl;
+  }
+
+  evs_manager_->set_recording(!evs_index_output_.empty());
 
 #if ANLNEXT_ANALYZE_INTERRUPT
   struct sigaction sa;
@@ -247,6 +275,9 @@ ANLStatus ANLManager::Analyze(long int num_events, bool enable_console)
               << "  input '.q' => quit the analysis loop\n"
               << "  input '.i' => show the current event index\n"
               << "  input '.s' => show the status of event selections (of the master thread)\n"
+              << "  input '.r' => show the module results (a snapshot in the multi-thread mode)\n"
+              << "  input '.t' => switch the module timing on/off\n"
+              << "  input '.l' => show the latency and the throughput (with the module timing on)\n"
               << "----------------------------------------------------------------------------\n"
               << std::endl;
 
@@ -297,6 +328,9 @@ ANLStatus ANLManager::Analyze(long int num_events, bool enable_console)
   reduce_statistics();
   print_summary();
   evs_manager_->print_summary();
+  if (evs_manager_->is_recording()) {
+    write_evs_index();
+  }
   print_results();
   requested_ = ANLRequest::none;
 
@@ -339,6 +373,13 @@ ANLStatus ANLManager::Finalize()
   final:
     std::cout << std::endl;
 
+  if (!trace_output_.empty()) {
+    Tracer::stop();
+    const std::size_t num_spans = Tracer::write(trace_output_);
+    std::cout << "ANLManager: " << num_spans << " spans written to " << trace_output_ << "\n"
+              << std::endl;
+  }
+
 #if ANLNEXT_FINALIZE_INTERRUPT
   if ( sigaction(SIGINT, &sa_org, 0) != 0 ) {
     std::cout << "sigaction(2) error!" << std::endl;
@@ -453,93 +494,147 @@ void ANLManager::print_results()
   }
 }
 
-void ANLManager::reset_counters()
+long int ANLManager::batch_length(long int i_position, ExecutionPlan& plan) const
 {
-  counters_.resize(modules_.size());
-  for (LoopCounter& c: counters_) {
-    c.reset();
+  if (batch_size_ <= 1) {
+    return 1;
+  }
+
+  plan.update();
+  if (!plan.is_batchable() || evs_manager_->is_recording()) {
+    return 1;
+  }
+
+  long int n = batch_size_;
+  if (num_events_ >= 0) {
+    n = std::min(n, num_events_-i_position);
   }
+  if (event_selection_) {
+    const long int first_event = event_index(i_position);
+    long int k = 1;
+    while (k<n && event_index(i_position+k) == first_event+k) {
+      k++;
+    }
+    n = k;
+  }
+  return n;
 }
 
-ANLStatus ANLManager::process_analysis()
+void ANLManager::stop_dependency_recording()
 {
-  ANLStatus status = AS_OK;
+  for (BasicModule* mod: modules_) {
+    mod->set_dependency_recording(false);
+  }
+}
 
-  const std::vector<BasicModule*>& modules = modules_;
-  const long int period_disp = display_period();
-  const long int num_events = number_of_loops();
+void ANLManager::build_execution_plans()
+{
+  execution_plan_.build(modules_, counters_.data());
+  execution_plan_.set_reordering_warmup(reordering_warmup_);
 
-  try {
-    for (long int i_event=0; i_event!=num_events; i_event++) {
-      if (period_disp != 0 && i_event%period_disp == 0) {
-        print_event_index(i_event);
-      }
+  if (intra_event_threads_ > 1) {
+    if (!intra_event_pool_) {
+      intra_event_pool_.reset(new WorkerThreadPool);
+      intra_event_pool_->start(intra_event_threads_);
+    }
+    execution_plan_.set_concurrency(&dependency_graph_, intra_event_pool_.get());
+    print_concurrent_groups();
+  }
+}
 
-      status = process_one_event(i_event, modules, counters_, *evs_manager_);
+void ANLManager::print_concurrent_groups()
+{
+  const std::vector<ExecutionPlan::Step>& steps = execution_plan_.steps();
+  bool header = false;
+  for (const ExecutionPlan::Group& group: execution_plan_.groups()) {
+    if (group.size() < 2) { continue; }
+    if (!header) {
+      std::cout << "Modules processed concurrently on " << intra_event_threads_ << " threads:\n";
+      header = true;
+    }
+    std::cout << "  ----\n";
+    for (std::size_t k=group.first; k<group.last; k++) {
+      std::cout << boost::format("  [%4d]  %s\n") % steps[k].index % steps[k].module->module_id();
+    }
+  }
+  if (header) {
+    std::cout << std::endl;
+  }
+}
 
-      if (is_critical_error(status)) {
-        return status;
-      }
+void ANLManager::reset_counters()
+{
+  counters_.resize(modules_.size());
+  for (LoopCounter& c: counters_) {
+    c.reset();
+  }
+  event_statistics_.reset();
+  statistics_origin_ = ModuleTiming::Clock::now();
+}
 
-      if (status==AS_QUIT || status==AS_QUIT_ALL) {
-        break;
-      }
+void ANLManager::set_trace(const std::string& filename,
+                           long int first_event, long int last_event, long int period)
+{
+  trace_output_ = filename;
+  if (filename.empty()) {
+    Tracer::stop();
+  }
+  else {
+    Tracer::start(first_event, last_event, period);
+  }
+}
 
-      if (requested_ != ANLRequest::none) {
-        std::lock_guard<std::mutex> lock(mutex_);
-        if (requested_ == ANLRequest::quit) {
-          break;
-        }
-        else if (requested_ == ANLRequest::show_event_index) {
-          print_event_index(i_event);
-        }
-        else if (requested_ == ANLRequest::show_evs_summary) {
-          print_event_index(i_event);
-          evs_manager_->print_summary();
-        }
-        requested_ = ANLRequest::none;
-      }
+void ANLManager::set_event_selection(const std::string& index_file, const std::string& expression)
+{
+  EvsIndex index;
+  index.read(index_file);
+  event_selection_.reset(new EventSet(index.select(expression)));
+  event_selection_expression_ = expression;
+}
 
-      if (status==ANLStatus::skip) {
-        ;
-      }
-      else if (status==ANLStatus::redo) {
-        i_event--;
-      }
-    }
+void ANLManager::clear_event_selection()
+{
+  event_selection_.reset();
+  event_selection_expression_.clear();
+}
+
+void ANLManager::write_evs_index()
+{
+  evs_manager_->set_recording(false);
+  EvsIndex index;
+  evs_manager_->fill_index(index);
+  try {
+    index.write(evs_index_output_);
+    std::cout << "EVS index of " << index.processed().size() << " events has been written into "
+              << evs_index_output_ << ".\n" << std::endl;
   }
   catch (ANLException& ex) {
-    if (const ANLException::Treatment* t = boost::get_error_info<ExceptionTreatment>(ex)) {
-      if (*t == ANLException::Treatment::rethrow) {
-        throw;
-      }
-      else if (*t == ANLException::Treatment::finalize) {
-        print_exception(ex);
-        return ANLStatus::critical_error_to_finalize_from_exception;
-      }
-      else if (*t == ANLException::Treatment::terminate) {
-        print_exception(ex);
-        return ANLStatus::critical_error_to_terminate_from_exception;
-      }
-      else if (*t == ANLException::Treatment::hard_terminate) {
-        print_exception(ex);
-        std::terminate();
-      }
-    }
-    throw;
+    print_exception(ex);
   }
+}
 
-  return AS_OK;
+ANLStatus ANLManager::process_analysis()
+{
+  return event_loop([this](long int i_position, long int i_event, ANLStatus& status) {
+      const long int batch = batch_length(i_position, execution_plan_);
+      if (batch > 1) {
+        return process_event_batch(i_event, batch, execution_plan_, *evs_manager_, *event_store_, status);
+      }
+      status = process_one_event(i_event, execution_plan_, *evs_manager_, *event_store_);
+      return 1L;
+    });
 }
 
 void ANLManager::print_summary()
 {
   const std::size_t n = modules_.size();
+  long int put = 0, get = 0;
+  count_put_and_get(put, get);
   std::cout << '\n'
             << "        **************************************\n"
             << "        ****        Analysis chain        ****\n"
             << "        **************************************\n"
-            << "               Put: " << counters_[0].entry() << '\n'
+            << "               Put: " << put << '\n'
             << "                |\n";
 
   for (std::size_t i=0; i<n; i++) {
@@ -556,9 +651,162 @@ void ANLManager::print_summary()
       % counters_[i].ok()
       % counters_[i].skip()
       % counters_[i].error();
+    if (counters_[i].gated() > 0) {
+      std::cout << boost::format(" | Gated: %10d") % counters_[i].gated();
+    }
     std::cout << '\n';
   }
-  std::cout << "               Get: " << counters_[n-1].ok() << '\n';
+  std::cout << "               Get: " << get << '\n';
+  std::cout << std::endl;
+
+  if (execution_plan_.is_reordered()) {
+    const std::vector<std::size_t>& order = execution_plan_.order();
+    std::cout << "    Commutable filters were reordered after the warm-up of "
+              << reordering_warmup_ << " events:\n";
+    for (const auto& run: execution_plan_.filter_runs()) {
+      std::cout << "      ----\n";
+      for (std::size_t k=run.first; k<run.second; k++) {
+        const std::size_t i = order[k];
+        const ExecutionPlan::FilterProfile& profile = execution_plan_.filter_profile(i);
+        std::string module_ID = modules_[i]->module_name();
+        if (modules_[i]->module_id() != modules_[i]->module_name()) {
+          module_ID += "/" + modules_[i]->module_id();
+        }
+        std::cout << boost::format("      [%4d]  %-40s  cost: %10.3f us | rejection: %6.2f %%\n")
+          % i % module_ID % (profile.cost()*1.0e6) % (profile.rejection_rate()*100.0);
+      }
+    }
+    std::cout << std::endl;
+  }
+
+  print_module_timing();
+  print_perf_counters();
+  print_latency();
+  print_load_balance();
+}
+
+void ANLManager::count_put_and_get(long int& put, long int& get) const
+{
+  put = execution_plan_.number_of_events();
+  get = execution_plan_.number_of_completed_events();
+}
+
+ModuleTiming ANLManager::total_module_timing(std::size_t i) const
+{
+  return modules_[i]->timing();
+}
+
+ModuleCounters ANLManager::total_perf_counters(std::size_t i) const
+{
+  return modules_[i]->perf_counters();
+}
+
+EventStatistics ANLManager::total_event_statistics() const
+{
+  return event_statistics_;
+}
+
+void ANLManager::print_latency()
+{
+  const EventStatistics statistics = total_event_statistics();
+  if (statistics.empty()) { return; }
+
+  std::cout << '\n'
+            << "        **************************************\n"
+            << "        ****    Latency and throughput    ****\n"
+            << "        **************************************\n"
+            << '\n';
+  std::cout << "    Event latency:\n      ";
+  statistics.latency.print_line(std::cout);
+
+  std::cout << "    Latency of mod_analyze():\n";
+  for (std::size_t i=0; i<modules_.size(); i++) {
+    const ModuleTiming timing = total_module_timing(i);
+    if (timing.analyze_latency().empty()) { continue; }
+    std::cout << boost::format("      [%4d]  %s\n") % i % modules_[i]->module_id();
+    std::cout << "              ";
+    timing.analyze_latency().print_line(std::cout);
+  }
+  statistics.throughput.print(std::cout, 60);
+  std::cout << std::endl;
+}
+
+void ANLManager::print_module_timing()
+{
+  const std::size_t n = modules_.size();
+  std::vector<ModuleTiming> timing(n);
+  double chain_seconds = 0.0;
+  bool measured = false;
+  for (std::size_t i=0; i<n; i++) {
+    timing[i] = total_module_timing(i);
+    chain_seconds += timing[i].total_seconds();
+    measured = measured || !timing[i].empty();
+  }
+  if (!measured) { return; }
+
+  std::cout << '\n'
+            << "        **************************************\n"
+            << "        ****        Module timing         ****\n"
+            << "        **************************************\n"
+            << '\n';
+  for (std::size_t i=0; i<n; i++) {
+    std::string module_ID = modules_[i]->module_name();
+    if (modules_[i]->module_id() != modules_[i]->module_name()) {
+      module_ID += "/" + modules_[i]->module_id();
+    }
+    const double total = timing[i].total_seconds();
+    std::cout << boost::format("    [%4d]  %-40s  total: %12.6f s (%6.2f %%)\n")
+      % i % module_ID % total % (chain_seconds > 0.0 ? 100.0*total/chain_seconds : 0.0);
+    std::cout << boost::format("              startup: %12.6f s | analyze: %12.6f s | mean: %12.3f us | calls: %10d\n")
+      % timing[i].startup_seconds()
+      % timing[i].seconds(ModulePhase::analyze)
+      % (timing[i].mean_seconds(ModulePhase::analyze)*1.0e6)
+      % timing[i].calls(ModulePhase::analyze);
+  }
+  std::cout << boost::format("    chain total: %12.6f s\n") % chain_seconds;
+  std::cout << std::endl;
+}
+
+void ANLManager::print_perf_counters()
+{
+  const std::size_t n = modules_.size();
+  std::vector<ModuleCounters> counters(n);
+  bool measured = false;
+  for (std::size_t i=0; i<n; i++) {
+    counters[i] = total_perf_counters(i);
+    measured = measured || !counters[i].empty();
+  }
+  if (!measured) { return; }
+
+  std::cout << '\n'
+            << "        **************************************\n"
+            << "        ****   Hardware event counters    ****\n"
+            << "        **************************************\n"
+            << '\n';
+  auto per_call = [](const ModuleCounters& c, PerfEvent event) {
+    return static_cast<double>(c.count(event))/c.calls();
+  };
+  for (std::size_t i=0; i<n; i++) {
+    if (counters[i].empty()) { continue; }
+    std::string module_ID = modules_[i]->module_name();
+    if (modules_[i]->module_id() != modules_[i]->module_name()) {
+      module_ID += "/" + modules_[i]->module_id();
+    }
+    const ModuleCounters& c = counters[i];
+    std::cout << boost::format("    [%4d]  %-40s  IPC: %6.3f | calls: %10d\n")
+      % i % module_ID % c.ipc() % c.calls();
+    std::cout << boost::format("              per call  cycles: %12.0f | instructions: %12.0f\n")
+      % per_call(c, PerfEvent::cycles) % per_call(c, PerfEvent::instructions);
+    std::cout << boost::format("              per 1k instructions  cache misses: %8.3f | branch misses: %8.3f\n")
+      % c.misses_per_kilo_instructions(PerfEvent::cache_misses)
+      % c.misses_per_kilo_instructions(PerfEvent::branch_misses);
+  }
+  for (std::size_t k=0; k<NumPerfEvents; k++) {
+    const PerfEvent event = static_cast<PerfEvent>(k);
+    if (!PerfCounters::is_counted(event)) {
+      std::cout << "    " << perf_event_name(event) << " not supported by this CPU; shown as 0\n";
+    }
+  }
   std::cout << std::endl;
 }
 
@@ -566,10 +814,43 @@ boost::property_tree::ptree ANLManager::parameters_to_property_tree() const
 {
   boost::property_tree::ptree pt;
   boost::property_tree::ptree pt_modules;
-  for (const auto& module: modules_) {
+  boost::property_tree::ptree pt_timing;
+  bool measured = false;
+  for (std::size_t i=0; i<modules_.size(); i++) {
+    const BasicModule* module = modules_[i];
     pt_modules.push_back(std::make_pair("", module->parameters_to_property_tree()));
+
+    const ModuleTiming timing = total_module_timing(i);
+    measured = measured || !timing.empty();
+    boost::property_tree::ptree pt_module;
+    pt_module.put("module_id", module->module_id());
+    pt_module.put("total_seconds", timing.total_seconds());
+    pt_module.add_child("phases", timing.to_property_tree());
+    pt_timing.push_back(std::make_pair("", std::move(pt_module)));
   }
   pt.add_child("application.module_list", std::move(pt_modules));
+  if (measured) {
+    pt.add_child("application.module_timing", std::move(pt_timing));
+  }
+
+  boost::property_tree::ptree pt_counters;
+  bool counted = false;
+  for (std::size_t i=0; i<modules_.size(); i++) {
+    const ModuleCounters counters = total_perf_counters(i);
+    counted = counted || !counters.empty();
+    boost::property_tree::ptree pt_module = counters.to_property_tree();
+    pt_module.put("module_id", modules_[i]->module_id());
+    pt_counters.push_back(std::make_pair("", std::move(pt_module)));
+  }
+  if (counted) {
+    pt.add_child("application.perf_counters", std::move(pt_counters));
+  }
+
+  const EventStatistics statistics = total_event_statistics();
+  if (!statistics.empty()) {
+    pt.add_child("application.event_statistics.latency", statistics.latency.to_property_tree());
+    pt.add_child("application.event_statistics.throughput", statistics.throughput.to_property_tree());
+  }
   return pt;
 }
 
@@ -596,7 +877,11 @@ ANLStatus ANLManager::routine_initialize()
 
 ANLStatus ANLManager::routine_begin_run()
 {
-  return routine_modfn(&BasicModule::mod_begin_run, "begin_run", modules_);
+  const ANLStatus status = routine_modfn(&BasicModule::mod_begin_run, "begin_run", modules_);
+  if (status == AS_OK) {
+    compile_evs_gates(modules_);
+  }
+  return status;
 }
 
 ANLStatus ANLManager::routine_end_run()
@@ -676,100 +961,407 @@ void ANLManager::interactive_session()
       std::cout << " ---> Show evs summary\n" << std::endl;
       requested_ = ANLRequest::show_evs_summary;
     }
+    else if (line == ".r") {
+      std::lock_guard<std::mutex> lock(mutex_);
+      std::cout << " ---> Show results\n" << std::endl;
+      requested_ = ANLRequest::show_results;
+    }
+    else if (line == ".l") {
+      std::lock_guard<std::mutex> lock(mutex_);
+      std::cout << " ---> Show latency\n" << std::endl;
+      requested_ = ANLRequest::show_latency;
+    }
+    else if (line == ".t") {
+      std::lock_guard<std::mutex> lock(mutex_);
+      set_module_timing(!module_timing());
+      std::cout << " ---> Module timing " << (module_timing() ? "on" : "off") << "\n" << std::endl;
+    }
     else {
       ;
     }
   }
 }
 
-ANLStatus process_one_event(long int i_event,
-                            const std::vector<BasicModule*>& modules,
-                            std::vector<LoopCounter>& counters,
-                            EvsManager& evs_manager)
+ANLStatus process_step(long int i_event, const ExecutionPlan::Step& step)
 {
-  evs_manager.reset_all_flags();
-  ANLStatus status = AS_OK;
+  BasicModule* mod = step.module;
+  if (mod->is_gated()) {
+    step.counter->count_up_by_gate();
+    return AS_OK;
+  }
 
-  for (BasicModule* mod: modules) {
-    mod->set_loop_index(i_event);
+  step.counter->count_up_by_entry();
+
+  ANLStatus status = AS_OK;
+  try {
+    const bool timing = ModuleTiming::is_enabled();
+    const bool traced = Tracer::event_traced();
+    const bool counted = PerfCounters::is_enabled();
+    if (step.profile || timing || traced || counted) {
+      PerfCounters::Values c0, c1;
+      const bool counting = counted && PerfCounters::read(c0);
+      const ModuleTiming::Clock::time_point t0 = ModuleTiming::Clock::now();
+      status = mod->mod_analyze();
+      const ModuleTiming::Clock::time_point t1 = ModuleTiming::Clock::now();
+      if (counting && PerfCounters::read(c1)) { mod->perf_counters().add(c0, c1); }
+      if (step.profile) { step.profile->add(t1-t0, status); }
+      if (timing) { mod->timing().add(ModulePhase::analyze, t1-t0); }
+      if (traced) { Tracer::record("analyze", "module", mod, i_event, t0, t1); }
+    }
+    else {
+      status = mod->mod_analyze();
+    }
+  }
+  catch (boost::exception& ex) {
+    ex << ErrorInfoOnLoopIndex(i_event);
+    ex << ErrorInfoOnMethod( mod->module_name() + "::mod_analyze" );
+    ex << ErrorInfoOnModuleID( mod->module_id() );
+    ex << ErrorInfoOnModuleName( mod->module_name() );
+    ex << ErrorInfoOnChainID( mod->copy_id() );
+    throw;
   }
 
-  const std::size_t NumberOfModules = modules.size();
-  for (std::size_t i_module=0; i_module<NumberOfModules; i_module++) {
-    BasicModule* mod = modules[i_module];
+  step.counter->count_up_by_result(status);
+  return eliminate_normal_error_status(status);
+}
 
-    if (mod->is_on()) {
-      counters[i_module].count_up_by_entry();
+ANLStatus process_group(long int i_event, const ExecutionPlan::Group& group, ExecutionPlan& plan)
+{
+  const std::vector<ExecutionPlan::Step>& steps = plan.steps();
+  if (group.size() == 1) {
+    return process_step(i_event, steps[group.first]);
+  }
 
-      try {
-        status = mod->mod_analyze();
-      }
-      catch (boost::exception& ex) {
-        ex << ErrorInfoOnLoopIndex(i_event);
-        ex << ErrorInfoOnMethod( mod->module_name() + "::mod_analyze" );
-        ex << ErrorInfoOnModuleID( mod->module_id() );
-        ex << ErrorInfoOnModuleName( mod->module_name() );
-        ex << ErrorInfoOnChainID( mod->copy_id() );
-        throw;
+  std::vector<ANLStatus>& results = plan.group_results();
+  std::atomic<std::size_t> next(group.first);
+  const long int traced_event = Tracer::current_event();
+  plan.thread_pool()->run([&](int) {
+      Tracer::begin_event(traced_event);
+      for (std::size_t k=next++; k<group.last; k=next++) {
+        results[k] = process_step(i_event, steps[k]);
       }
+    });
+
+  for (std::size_t k=group.first; k<group.last; k++) {
+    const ANLStatus s = results[k];
+    if (s==AS_SKIP || s==AS_REDO || s==AS_QUIT || s==AS_QUIT_ALL) {
+      // the other modules of the group have processed the event already.
+      std::ostringstream message;
+      message << "mod_analyze() gives " << s << " to event " << i_event
+              << ", but a module processed concurrently must give AS_OK";
+      BOOST_THROW_EXCEPTION( ANLException(steps[k].module, message.str()) );
+    }
+  }
+  for (std::size_t k=group.first; k<group.last; k++) {
+    if (results[k] != AS_OK) {
+      return results[k];
+    }
+  }
+  return AS_OK;
+}
 
-      counters[i_module].count_up_by_result(status);
-      status = eliminate_normal_error_status(status);
+ANLStatus process_one_event(long int i_event,
+                            ExecutionPlan& plan,
+                            EvsManager& evs_manager,
+                            EventStore& event_store)
+{
+  Tracer::begin_event(i_event);
+  const bool traced = Tracer::event_traced();
+  const ModuleTiming::Clock::time_point t0 = traced ? ModuleTiming::Clock::now() : ModuleTiming::Clock::time_point();
+  plan.begin_event();
+  evs_manager.reset_all_flags();
+  event_store.reset_event();
+  ANLStatus status = AS_OK;
+
+  for (BasicModule* mod: plan.active_modules()) {
+    mod->set_loop_index(i_event);
+  }
 
+  if (plan.is_concurrent()) {
+    for (const ExecutionPlan::Group& group: plan.groups()) {
+      status = process_group(i_event, group, plan);
+      if (status != AS_OK) {
+        break;
+      }
+    }
+  }
+  else {
+    for (const ExecutionPlan::Step& step: plan.steps()) {
+      status = process_step(i_event, step);
       if (status != AS_OK) {
         break;
       }
     }
   }
 
-  count_evs(status, evs_manager);
+  plan.count_event(status);
+  count_evs(i_event, status, evs_manager);
+  if (traced) {
+    Tracer::record("event", "event", nullptr, i_event, t0, ModuleTiming::Clock::now());
+  }
   return status;
 }
 
 ANLStatus process_one_event(long int i_event,
-                            const std::vector<BasicModule*>& modules,
-                            std::vector<LoopCounter>& counters,
+                            ExecutionPlan& plan,
                             EvsManager& evs_manager,
-                            std::vector<std::unique_ptr<OrderKeeper>>& order_keepers)
+                            EventStore& event_store,
+                            long int i_order,
+                            std::atomic<long int>& quit_order)
 {
+  Tracer::begin_event(i_event);
+  const bool traced = Tracer::event_traced();
+  const ModuleTiming::Clock::time_point t0 = traced ? ModuleTiming::Clock::now() : ModuleTiming::Clock::time_point();
+  plan.begin_event();
   evs_manager.reset_all_flags();
+  event_store.reset_event();
   ANLStatus status = AS_OK;
 
-  for (BasicModule* mod: modules) {
+  for (BasicModule* mod: plan.active_modules()) {
     mod->set_loop_index(i_event);
   }
 
-  const std::size_t NumberOfModules = modules.size();
-  for (std::size_t i_module=0; i_module<NumberOfModules; i_module++) {
-    BasicModule* mod = modules[i_module];
-  
-    const KeeperBlock<OrderKeeper, long int> block(order_keepers[i_module].get(), i_event);
-
-    if (status == AS_OK && mod->is_on()) {
-      counters[i_module].count_up_by_entry();
+  // the keepers entered are held until the event is finished, so that an
+  // event redone by AS_REDO is retried in its turn and alone in the
+  // order-sensitive modules. The steps before num_entered have been entered.
+  const std::vector<ExecutionPlan::Step>& steps = plan.steps();
+  std::size_t num_entered = 0;
+  bool stopped = false;
+  auto enter_keeper = [&](const ExecutionPlan::Step& step) {
+    const ModuleTiming::Clock::time_point t_wait = traced ? ModuleTiming::Clock::now() : ModuleTiming::Clock::time_point();
+    step.keeper->wait(i_order);
+    if (traced) {
+      Tracer::record("keeper wait", "keeper", step.module, i_event, t_wait, ModuleTiming::Clock::now());
+    }
+  };
+  auto release_keepers = [&]() {
+    // every event passes the keepers, even after the chain has stopped.
+    for (std::size_t k=0; k<steps.size(); k++) {
+      if (steps[k].keeper) {
+        if (k >= num_entered) { enter_keeper(steps[k]); }
+        steps[k].keeper->send_done(i_order);
+      }
+    }
+  };
 
-      try {
-        status = mod->mod_analyze();
+  try {
+    while (true) {
+      for (std::size_t i_step=0; i_step<steps.size(); i_step++) {
+        const ExecutionPlan::Step& step = steps[i_step];
+        if (step.keeper && i_step >= num_entered) {
+          enter_keeper(step);
+          if (i_order > quit_order.load(std::memory_order_acquire)) {
+            // an earlier event has quit all the chains.
+            num_entered = i_step+1;
+            stopped = true;
+            status = AS_QUIT_ALL;
+            break;
+          }
+        }
+        if (i_step >= num_entered) { num_entered = i_step+1; }
+        if (step.active) {
+          status = process_step(i_event, step);
+          if (status != AS_OK) {
+            break;
+          }
+        }
       }
-      catch (ANLException& ex) {
-        ex << ErrorInfoOnLoopIndex(i_event);
-        ex << ErrorInfoOnMethod( mod->module_name() + "::mod_analyze" );
-        ex << ErrorInfoOnModuleID( mod->module_id() );
-        ex << ErrorInfoOnModuleName( mod->module_name() );
-        ex << ErrorInfoOnChainID( mod->copy_id() );
-        throw;
+      if (status == AS_QUIT_ALL && !stopped) {
+        // published before the keepers are released to the following events.
+        long int order = quit_order.load(std::memory_order_relaxed);
+        while (i_order < order
+               && !quit_order.compare_exchange_weak(order, i_order, std::memory_order_acq_rel)) {
+          ;
+        }
+      }
+      if (status != AS_REDO) {
+        break;
       }
 
-      counters[i_module].count_up_by_result(status);
-      status = eliminate_normal_error_status(status);
+      plan.begin_event();
+      evs_manager.reset_all_flags();
+      event_store.reset_event();
+      for (BasicModule* mod: plan.active_modules()) {
+        mod->set_loop_index(i_event);
+      }
+      status = AS_OK;
     }
   }
+  catch (...) {
+    // the other threads are not blocked by the keepers of this event.
+    release_keepers();
+    throw;
+  }
+  release_keepers();
 
-  count_evs(status, evs_manager);
+  if (!stopped) {
+    plan.count_event(status);
+    count_evs(i_event, status, evs_manager);
+  }
+  if (traced) {
+    Tracer::record("event", "event", nullptr, i_event, t0, ModuleTiming::Clock::now());
+  }
   return status;
 }
 
-void count_evs(ANLStatus status, EvsManager& evs_manager)
+long int process_event_batch(long int first_event, long int n,
+                             ExecutionPlan& plan,
+                             EvsManager& evs_manager,
+                             EventStore& event_store,
+                             ANLStatus& status)
+{
+  const std::vector<ExecutionPlan::Step>& steps = plan.steps();
+  const ExecutionPlan::Group segment = plan.batch_segment();
+  ExecutionPlan::BatchBuffer& buffer = plan.batch_buffer();
+  buffer.status.assign(n, AS_OK);
+  buffer.entered.resize(n);
+
+  // a batch is traced if its first event is sampled.
+  Tracer::begin_event(first_event);
+  const bool traced = Tracer::event_traced();
+
+  evs_manager.reset_all_flags();
+  event_store.reset_event();
+
+  auto set_loop_index = [&plan](long int i_event) {
+    for (BasicModule* mod: plan.active_modules()) {
+      mod->set_loop_index(i_event);
+    }
+  };
+
+  // the steps [first, last) for the k-th event alone.
+  auto process_steps = [&](long int k, std::size_t first, std::size_t last) {
+    const long int i_event = first_event+k;
+    set_loop_index(i_event);
+    ANLStatus s = AS_OK;
+    for (std::size_t i_step=first; i_step<last; i_step++) {
+      s = process_step(i_event, steps[i_step]);
+      if (s != AS_OK) {
+        break;
+      }
+    }
+    return s;
+  };
+
+  auto stops = [](ANLStatus s) {
+    return (s==AS_QUIT || s==AS_QUIT_ALL || is_critical_error(s));
+  };
+
+  // the events [0, cut) go on; the events [cut, consumed) are dropped, and
+  // the events after them are left to the following loop.
+  long int cut = n;
+  long int consumed = n;
+
+  if (segment.first > 0) {
+    for (long int k=0; k<n; k++) {
+      ANLStatus& s = buffer.status[k];
+      do {
+        s = process_steps(k, 0, segment.first);
+      } while (s == AS_REDO);
+      if (stops(s)) {
+        cut = consumed = k+1;
+        break;
+      }
+    }
+  }
+
+  set_loop_index(first_event);
+  for (std::size_t i_step=segment.first; i_step<segment.last; i_step++) {
+    BasicModule* mod = steps[i_step].module;
+    LoopCounter* counter = steps[i_step].counter;
+    char* entered = buffer.entered.data();
+
+    long int first_entered = -1;
+    long int num_entered = 0;
+    for (long int k=0; k<cut; k++) {
+      entered[k] = (buffer.status[k] == AS_OK);
+      if (entered[k]) {
+        num_entered++;
+        if (first_entered < 0) { first_entered = k; }
+      }
+    }
+    if (first_entered < 0) {
+      break;
+    }
+
+    ANLStatus batch_status = AS_OK;
+    try {
+      const bool timing = ModuleTiming::is_enabled();
+      const bool counted = PerfCounters::is_enabled();
+      if (timing || traced || counted) {
+        PerfCounters::Values c0, c1;
+        const bool counting = counted && PerfCounters::read(c0);
+        const ModuleTiming::Clock::time_point t0 = ModuleTiming::Clock::now();
+        batch_status = mod->mod_analyze_batch(first_event, first_event+cut,
+                                              ANLStatusSpan(buffer.status.data(), cut));
+        const ModuleTiming::Clock::time_point t1 = ModuleTiming::Clock::now();
+        if (counting && PerfCounters::read(c1)) { mod->perf_counters().add(c0, c1, num_entered); }
+        // counted as calls of mod_analyze() for the events entered.
+        if (timing) { mod->timing().add(ModulePhase::analyze, t1-t0, num_entered); }
+        if (traced) { Tracer::record("analyze_batch", "module", mod, first_event, t0, t1); }
+      }
+      else {
+        batch_status = mod->mod_analyze_batch(first_event, first_event+cut,
+                                              ANLStatusSpan(buffer.status.data(), cut));
+      }
+    }
+    catch (boost::exception& ex) {
+      ex << ErrorInfoOnLoopIndex(first_event);
+      ex << ErrorInfoOnMethod( mod->module_name() + "::mod_analyze_batch" );
+      ex << ErrorInfoOnModuleID( mod->module_id() );
+      ex << ErrorInfoOnModuleName( mod->module_name() );
+      ex << ErrorInfoOnChainID( mod->copy_id() );
+      throw;
+    }
+    if (batch_status != AS_OK) {
+      buffer.status[first_entered] = batch_status;
+    }
+
+    // the module stops at the first event that quits; the steps before it
+    // have processed the following events, which are not passed on.
+    const long int entered_cut = cut;
+    for (long int k=0; k<entered_cut; k++) {
+      if (entered[k]) {
+        counter->count_up_by_entry();
+        counter->count_up_by_result(buffer.status[k]);
+        buffer.status[k] = eliminate_normal_error_status(buffer.status[k]);
+        if (stops(buffer.status[k])) {
+          cut = k+1;
+          break;
+        }
+      }
+    }
+  }
+
+  // an event given AS_REDO in the segment is redone from the first step.
+  const std::size_t num_steps = steps.size();
+  for (long int k=0; k<cut; k++) {
+    ANLStatus& s = buffer.status[k];
+    if (s == AS_OK && segment.last < num_steps) {
+      s = process_steps(k, segment.last, num_steps);
+    }
+    while (s == AS_REDO) {
+      s = process_steps(k, 0, num_steps);
+    }
+    if (stops(s)) {
+      cut = k+1;
+      break;
+    }
+  }
+
+  // the flags are not kept per event, so they are not counted.
+  evs_manager.reset_all_flags();
+  evs_manager.count_unflagged(cut);
+
+  for (long int k=0; k<cut; k++) {
+    plan.count_event(buffer.status[k]);
+  }
+
+  status = buffer.status[cut-1];
+  return consumed;
+}
+
+void count_evs(long int i_event, ANLStatus status, EvsManager& evs_manager)
 {
   if (status == AS_OK) {
     evs_manager.count();
@@ -784,6 +1376,20 @@ void count_evs(ANLStatus status, EvsManager& evs_manager)
   else if (status == AS_QUIT_ALL) {
     evs_manager.count();
   }
+  else {
+    return;
+  }
+
+  if (evs_manager.is_recording()) {
+    evs_manager.record(i_event);
+  }
+}
+
+void compile_evs_gates(const std::vector<BasicModule*>& modules)
+{
+  for (BasicModule* mod: modules) {
+    mod->compile_evs_gate();
+  }
 }
 
 } /* namespace anlnext */
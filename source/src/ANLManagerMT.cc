@@ -21,27 +21,125 @@
 
 #include <boost/format.hpp>
 #include <functional>
-#include <thread>
+#include <algorithm>
+#include <limits>
 
 #include "BasicModule.hh"
 #include "EvsManager.hh"
+#include "EventStore.hh"
 #include "ModuleAccess.hh"
 #include "ANLException.hh"
 #include "ANLManager_impl.hh"
 #include "ClonedChainSet_impl.hh"
-#include "OrderKeeper.hh"
+#include "Sequencer.hh"
+#include "Tracer.hh"
 
 namespace anlnext
 {
 
+namespace
+{
+
+ANLStatus most_critical_status(const std::vector<ANLStatus>& status_vector)
+{
+  ANLStatus status = AS_OK;
+  for (ANLStatus s: status_vector) {
+    if (s == ANLStatus::critical_error_to_finalize) {
+      status = s;
+    }
+  }
+  for (ANLStatus s: status_vector) {
+    if (s == ANLStatus::critical_error_to_finalize_from_exception) {
+      status = s;
+    }
+  }
+  for (ANLStatus s: status_vector) {
+    if (s == ANLStatus::critical_error_to_terminate) {
+      status = s;
+    }
+  }
+  for (ANLStatus s: status_vector) {
+    if (s == ANLStatus::critical_error_to_terminate_from_exception) {
+      status = s;
+    }
+  }
+  return status;
+}
+
+/**
+ * the most critical error if any; otherwise the first status that is not OK.
+ */
+ANLStatus aggregate_status(const std::vector<ANLStatus>& status_vector)
+{
+  for (ANLStatus s: status_vector) {
+    if (is_critical_error(s)) {
+      return most_critical_status(status_vector);
+    }
+  }
+  for (ANLStatus s: status_vector) {
+    if (s != AS_OK) {
+      return s;
+    }
+  }
+  return AS_OK;
+}
+
+ANLStatus process_modules(long int i_event, ExecutionPlan& plan, EventStore& event_store)
+{
+  Tracer::begin_event(i_event);
+  const bool traced = Tracer::event_traced();
+  const ModuleTiming::Clock::time_point t0 = traced ? ModuleTiming::Clock::now() : ModuleTiming::Clock::time_point();
+  plan.begin_event();
+  ANLStatus status = AS_OK;
+
+  for (BasicModule* mod: plan.active_modules()) {
+    mod->set_loop_index(i_event);
+    mod->set_event_store(&event_store);
+  }
+
+  for (const ExecutionPlan::Step& step: plan.steps()) {
+    status = process_step(i_event, step);
+    if (status != AS_OK) {
+      break;
+    }
+  }
+
+  plan.count_event(status);
+  if (traced) {
+    Tracer::record("stage", "event", nullptr, i_event, t0, ModuleTiming::Clock::now());
+  }
+  return status;
+}
+
+std::chrono::steady_clock::rep snapshot_time_after(std::chrono::steady_clock::time_point t,
+                                                   double seconds)
+{
+  const std::chrono::steady_clock::time_point next
+    = t + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+  return next.time_since_epoch().count();
+}
+
+void print_stage(const std::string& name, const std::vector<BasicModule*>& modules)
+{
+  std::cout << "  " << name << ":";
+  for (const BasicModule* mod: modules) {
+    std::cout << " " << mod->module_id();
+  }
+  std::cout << "\n";
+}
+
+} /* anonymous namespace */
+
 ANLManagerMT::ANLManagerMT(int num_parallels)
-  : num_parallels_(num_parallels),
-    loop_index_(-1)
+  : num_parallels_(num_parallels)
 {
   set_print_parallel_modules();
 }
 
-ANLManagerMT::~ANLManagerMT() = default;
+ANLManagerMT::~ANLManagerMT()
+{
+  thread_pool_.stop();
+}
 
 BasicModule* ANLManagerMT::access_to_module(int chain_ID, const std::string& module_ID)
 {
@@ -60,28 +158,123 @@ BasicModule* ANLManagerMT::access_to_module(int chain_ID, const std::string& mod
 
 void ANLManagerMT::clone_modules(int chain_ID)
 {
-  ClonedChainSet chain(chain_ID, *evs_manager_);
-  for (BasicModule* mod: modules_) {
-    chain.push(mod->clone());
+  std::vector<std::unique_ptr<BasicModule>> clones;
+  for (std::size_t i=cloned_begin_; i<cloned_end_; i++) {
+    clones.push_back(modules_[i]->clone());
+  }
+  add_cloned_chain(chain_ID, std::move(clones));
+}
+
+void ANLManagerMT::clone_modules_in_parallel()
+{
+  // A module is cloned by one thread only, since cloning updates the master
+  // module; different modules are cloned concurrently only if they allow it.
+  const std::size_t num_modules = cloned_end_ - cloned_begin_;
+  std::vector<std::vector<std::unique_ptr<BasicModule>>> clones(num_modules);
+  std::vector<std::size_t> concurrent;
+  for (std::size_t j=0; j<num_modules; j++) {
+    BasicModule* mod = modules_[cloned_begin_+j];
+    if (mod->mod_clone_is_thread_safe()) {
+      concurrent.push_back(j);
+    }
+    else {
+      for (int i=1; i<num_parallels_; i++) {
+        clones[j].push_back(mod->clone());
+      }
+    }
+  }
+
+  if (!concurrent.empty()) {
+    start_thread_pool();
+    const std::size_t num_threads = thread_pool_.size();
+    thread_pool_.run([&](int i_thread){
+        for (std::size_t k=i_thread; k<concurrent.size(); k+=num_threads) {
+          const std::size_t j = concurrent[k];
+          for (int i=1; i<num_parallels_; i++) {
+            clones[j].push_back(modules_[cloned_begin_+j]->clone());
+          }
+        }
+      });
+  }
+
+  for (int i=1; i<num_parallels_; i++) {
+    std::vector<std::unique_ptr<BasicModule>> chain_modules;
+    for (std::size_t j=0; j<num_modules; j++) {
+      chain_modules.push_back(std::move(clones[j][i-1]));
+    }
+    add_cloned_chain(i, std::move(chain_modules));
+  }
+}
+
+void ANLManagerMT::add_cloned_chain(int chain_ID, std::vector<std::unique_ptr<BasicModule>>&& clones)
+{
+  ClonedChainSet chain(chain_ID, *evs_manager_, *event_store_);
+  for (std::unique_ptr<BasicModule>& mod: clones) {
+    chain.push(std::move(mod));
   }
   chain.setup_module_access();
+  for (std::size_t i=0; i<modules_.size(); i++) {
+    if (i < cloned_begin_ || cloned_end_ <= i) {
+      chain.share_module(modules_[i]);
+    }
+  }
   cloned_chains_.push_back(std::move(chain));
 }
 
 void ANLManagerMT::duplicate_chains()
 {
   order_keepers_.clear();
-  for (BasicModule* mod: modules_) {
-    if (mod->is_order_sensitive()) {
-      order_keepers_.emplace_back(new OrderKeeper);
+  cloned_begin_ = 0;
+  cloned_end_ = modules_.size();
+
+  if (execution_mode_ == ExecutionMode::pipeline) {
+    setup_pipeline();
+    std::cout << "\n"
+              << "<Pipeline setup>\n"
+              << "The chain has been divided into " << stages_.size() << " stages.\n";
+    for (std::size_t i=0; i<stages_.size(); i++) {
+      print_stage((boost::format("stage %d")%i).str(), stages_[i].modules);
     }
-    else {
-      order_keepers_.emplace_back(nullptr);
+    std::cout << std::endl;
+
+    automatic_switch_for_singletons();
+    return;
+  }
+
+  if (execution_mode_ == ExecutionMode::farm) {
+    setup_farm();
+    cloned_begin_ = stages_[1].first_module;
+    cloned_end_ = cloned_begin_ + stages_[1].modules.size();
+    std::cout << "\n"
+              << "<Farm setup>\n";
+    print_stage("head", stages_[0].modules);
+    print_stage((boost::format("body x %d")%num_parallels_).str(), stages_[1].modules);
+    print_stage("tail (ordered)", stages_[2].modules);
+    for (const BasicModule* mod: stages_[1].modules) {
+      if (mod->is_order_sensitive()) {
+        std::cout << "Warning: " << mod->module_id() << " is order sensitive, "
+                  << "but the event order is kept only in the head and the tail stages.\n";
+      }
+    }
+  }
+  else {
+    for (BasicModule* mod: modules_) {
+      if (mod->is_order_sensitive()) {
+        order_keepers_.emplace_back(new Sequencer);
+      }
+      else {
+        order_keepers_.emplace_back(nullptr);
+      }
     }
   }
 
-  for (int i=1; i<num_parallels_; i++) {
-    clone_modules(i);
+  if (parallel_routines_ && num_parallels_ > 2) {
+    clone_modules_in_parallel();
+  }
+  else {
+    for (int i=1; i<num_parallels_; i++) {
+      clone_modules(i);
+    }
   }
   std::cout << "\n"
             << "<Module chain duplication>\n"
@@ -89,9 +282,54 @@ void ANLManagerMT::duplicate_chains()
             << "Total: " << num_parallels_ << " chains.\n"
             << std::endl;
 
+  if (execution_mode_ == ExecutionMode::event_parallel) {
+    setup_snapshot();
+  }
+
   automatic_switch_for_singletons();
 }
 
+void ANLManagerMT::build_execution_plans()
+{
+  if (intra_event_threads() > 1) {
+    std::cout << "Warning: intra_event_threads is " << intra_event_threads()
+              << ", but ANLManagerMT processes the modules of an event one after another.\n";
+  }
+
+  const long int warmup = reordering_warmup();
+  ExecutionPlan* order_plan = nullptr;
+  if (execution_mode_ == ExecutionMode::event_parallel) {
+    execution_plan_.build(modules_, counters_.data(), &order_keepers_);
+    execution_plan_.set_reordering_warmup(warmup);
+    order_plan = &execution_plan_;
+  }
+  else {
+    for (PipelineStage& stage: stages_) {
+      stage.plan.build(stage.modules, counters_.data()+stage.first_module);
+      stage.plan.set_reordering_warmup(warmup);
+    }
+    if (execution_mode_ == ExecutionMode::farm) {
+      order_plan = &stages_[1].plan;
+    }
+  }
+
+  // all the chains take the filter order of the chain that finishes the
+  // warm-up first, so that the counters summed by module describe one order.
+  for (ClonedChainSet& chain: cloned_chains_) {
+    chain.build_execution_plan(&order_keepers_, warmup, order_plan);
+  }
+}
+
+void ANLManagerMT::stop_dependency_recording()
+{
+  ANLManager::stop_dependency_recording();
+  for (ClonedChainSet& chain: cloned_chains_) {
+    for (BasicModule* mod: chain.modules_reference()) {
+      mod->set_dependency_recording(false);
+    }
+  }
+}
+
 void ANLManagerMT::automatic_switch_for_singletons()
 {
   for (BasicModule* mod: modules_) {
@@ -119,6 +357,13 @@ void ANLManagerMT::print_parameters()
 
 void ANLManagerMT::print_results()
 {
+  if (analysis_running_) {
+    // the modules are being updated by the threads.
+    std::lock_guard<std::mutex> lock(snapshot_mutex_);
+    print_snapshot();
+    return;
+  }
+
   ANLManager::print_results();
 
   if (print_clone_parameters_) {
@@ -140,17 +385,123 @@ void ANLManagerMT::reset_counters()
   }
 }
 
+int ANLManagerMT::number_of_threads() const
+{
+  if (execution_mode_ == ExecutionMode::pipeline) {
+    return stages_.size();
+  }
+  else if (execution_mode_ == ExecutionMode::farm) {
+    return num_parallels_+2;
+  }
+  return num_parallels_;
+}
+
+int ANLManagerMT::thread_for_chain(int chain_ID) const
+{
+  if (execution_mode_ == ExecutionMode::farm) {
+    return chain_ID+1;
+  }
+  return chain_ID;
+}
+
+void ANLManagerMT::start_thread_pool()
+{
+  thread_pool_.start(number_of_threads());
+  if (affinity_.enabled() && !threads_bound_) {
+    bind_threads();
+  }
+}
+
+void ANLManagerMT::bind_threads()
+{
+  threads_bound_ = true;
+  affinity_.setup();
+  const int num_threads = thread_pool_.size();
+  std::vector<char> bound(num_threads, 0);
+  thread_pool_.run([&](int i_thread){
+      bound[i_thread] = affinity_.bind(i_thread);
+    });
+
+  std::cout << "\n"
+            << "<Thread affinity>\n";
+  for (int i=0; i<num_threads; i++) {
+    std::cout << "  thread " << i << " => CPU " << affinity_.cpu_for_thread(i);
+    if (!bound[i]) {
+      std::cout << " (failed to bind)";
+    }
+    std::cout << '\n';
+  }
+  std::cout << std::endl;
+}
+
+ANLStatus ANLManagerMT::run_on_thread(int i_thread, const std::function<ANLStatus()>& func)
+{
+  start_thread_pool();
+  ANLStatus status = AS_OK;
+  thread_pool_.run([&](int i){
+      if (i == i_thread) {
+        status = func();
+      }
+    });
+  return status;
+}
+
+ANLStatus ANLManagerMT::routine_master_chain(const std::function<ANLStatus()>& func)
+{
+  // in the pipeline mode, the master modules are shared by all the threads.
+  if (affinity_.enabled() && execution_mode_ != ExecutionMode::pipeline) {
+    return run_on_thread(thread_for_chain(0), func);
+  }
+  return func();
+}
+
+template <typename T>
+ANLStatus ANLManagerMT::routine_cloned_chains(T func, const std::string& func_id)
+{
+  const std::size_t num_chains = cloned_chains_.size();
+  std::vector<ANLStatus> status_vector(num_chains, AS_OK);
+  auto run_chain = [&](std::size_t i) {
+    ClonedChainSet& chain = cloned_chains_[i];
+    status_vector[i] = routine_modfn(func,
+                                     boost::str(boost::format("%s:%d")%func_id%chain.chain_id()),
+                                     chain.modules_reference());
+  };
+
+  if (parallel_routines_ && num_chains > 1) {
+    // each chain is processed by the thread that runs it in the analysis loop.
+    start_thread_pool();
+    thread_pool_.run([&](int i_thread){
+        for (std::size_t i=0; i<num_chains; i++) {
+          if (thread_for_chain(cloned_chains_[i].chain_id()) == i_thread) {
+            run_chain(i);
+          }
+        }
+      });
+  }
+  else if (affinity_.enabled()) {
+    // one chain at a time, but on the thread that runs it in the analysis loop.
+    for (std::size_t i=0; i<num_chains; i++) {
+      run_on_thread(thread_for_chain(cloned_chains_[i].chain_id()),
+                    [&](){ run_chain(i); return status_vector[i]; });
+      if (status_vector[i] != AS_OK) { break; }
+    }
+  }
+  else {
+    for (std::size_t i=0; i<num_chains; i++) {
+      run_chain(i);
+      if (status_vector[i] != AS_OK) { break; }
+    }
+  }
+
+  return aggregate_status(status_vector);
+}
+
 ANLStatus ANLManagerMT::routine_initialize()
 {
   ANLStatus status = AS_OK;
-  status = ANLManager::routine_initialize();
+  status = routine_master_chain([this](){ return ANLManager::routine_initialize(); });
   if (status == AS_OK) {
-    for (auto& chain: cloned_chains_) {
-      status = routine_modfn(&BasicModule::mod_initialize,
-                             boost::str(boost::format("initialize:%d")%chain.chain_id()),
-                             chain.modules_reference());
-      if (status != AS_OK) { break; }
-    }
+    status = routine_cloned_chains(&BasicModule::mod_initialize, "initialize");
   }
   return status;
 }
@@ -158,13 +509,13 @@ ANLStatus ANLManagerMT::routine_initialize()
 ANLStatus ANLManagerMT::routine_begin_run()
 {
   ANLStatus status = AS_OK;
-  status = ANLManager::routine_begin_run();
+  status = routine_master_chain([this](){ return ANLManager::routine_begin_run(); });
   if (status == AS_OK) {
-    for (auto& chain: cloned_chains_) {
-      status = routine_modfn(&BasicModule::mod_begin_run,
-                             boost::str(boost::format("begin_run:%d")%chain.chain_id()),
-                             chain.modules_reference());
-      if (status != AS_OK) { break; }
+    status = routine_cloned_chains(&BasicModule::mod_begin_run, "begin_run");
+  }
+  if (status == AS_OK) {
+    for (const ClonedChainSet& chain: cloned_chains_) {
+      compile_evs_gates(chain.modules_reference());
     }
   }
   return status;
@@ -173,14 +524,9 @@ ANLStatus ANLManagerMT::routine_begin_run()
 ANLStatus ANLManagerMT::routine_end_run()
 {
   ANLStatus status = AS_OK;
-  status = ANLManager::routine_end_run();
+  status = routine_master_chain([this](){ return ANLManager::routine_end_run(); });
   if (status == AS_OK) {
-    for (auto& chain: cloned_chains_) {
-      status = routine_modfn(&BasicModule::mod_end_run,
-                             boost::str(boost::format("end_run:%d")%chain.chain_id()),
-                             chain.modules_reference());
-      if (status != AS_OK) { break; }
-    }
+    status = routine_cloned_chains(&BasicModule::mod_end_run, "end_run");
   }
   return status;
 }
@@ -188,101 +534,112 @@ ANLStatus ANLManagerMT::routine_end_run()
 ANLStatus ANLManagerMT::routine_finalize()
 {
   ANLStatus status = AS_OK;
-  status = ANLManager::routine_finalize();
+  status = routine_master_chain([this](){ return ANLManager::routine_finalize(); });
   if (status == AS_OK) {
-    for (auto& chain: cloned_chains_) {
-      status = routine_modfn(&BasicModule::mod_finalize,
-                             boost::str(boost::format("finalize:%d")%chain.chain_id()),
-                             chain.modules_reference());
-      if (status != AS_OK) { break; }
-    }
+    status = routine_cloned_chains(&BasicModule::mod_finalize, "finalize");
   }
   return status;
 }
 
-long int ANLManagerMT::event_index_to_process()
+long int ANLManagerMT::event_index_to_process(int i_thread)
 {
-  std::lock_guard<std::mutex> lock(mutex_);
-
   const long int N = number_of_loops();
-  ++loop_index_;
-  if (loop_index_ >= N) {
+  if (requested_ == ANLRequest::quit) {
     return N;
   }
-  if (requested_ == ANLRequest::quit) {
+
+  long int index = N;
+  if (!dispatcher_.next(i_thread, index)) {
     return N;
   }
 
-  return loop_index_;
+  return index;
 }
 
-void ANLManagerMT::decrement_event_index()
+void ANLManagerMT::decrement_event_index(int i_thread)
 {
-  std::lock_guard<std::mutex> lock(mutex_);
-  --loop_index_;
+  dispatcher_.redo(i_thread);
 }
 
 ANLStatus ANLManagerMT::process_analysis()
 {
-  std::vector<std::future<ANLStatus>> status_future_vector;
-  std::vector<std::thread> analysis_threads(num_parallels_);
-  for (int i=0; i<num_parallels_; i++) {
-    std::promise<ANLStatus> status_promise;
-    status_future_vector.push_back(status_promise.get_future());
-    analysis_threads[i] = std::thread(std::bind(&ANLManagerMT::process_analysis_in_each_thread, this, i, std::placeholders::_1),
-                                      std::move(status_promise));
+  chain_loads_.clear();
+  if (execution_mode_ == ExecutionMode::pipeline) {
+    return process_analysis_pipeline();
+  }
+  else if (execution_mode_ == ExecutionMode::farm) {
+    return process_analysis_farm();
   }
 
-  for (int i=0; i<num_parallels_; i++) {
-    analysis_threads[i].join();
+  bool ordered = false;
+  for (auto& keeper: order_keepers_) {
+    if (keeper) {
+      keeper->reset();
+      ordered = true;
+    }
+  }
+  dispatcher_.reset(number_of_loops(), num_parallels_, ordered);
+  quit_order_.store(std::numeric_limits<long int>::max());
+  for (ClonedChainSet& chain: cloned_chains_) {
+    chain.get_evs().set_recording(evs_manager_->is_recording());
   }
 
-  std::vector<ANLStatus> status_vector(num_parallels_, AS_OK);
+  std::vector<std::promise<ANLStatus>> status_promise_vector(num_parallels_);
+  std::vector<std::future<ANLStatus>> status_future_vector;
   for (int i=0; i<num_parallels_; i++) {
-    status_vector[i] = status_future_vector[i].get();
+    status_future_vector.push_back(status_promise_vector[i].get_future());
   }
 
-  ANLStatus status = AS_OK;
-  for (ANLStatus s: status_vector) {
-    if (s == ANLStatus::critical_error_to_finalize) {
-      status = s;
-    }
-  }
-  for (ANLStatus s: status_vector) {
-    if (s == ANLStatus::critical_error_to_finalize_from_exception) {
-      status = s;
-    }
+  reset_snapshot();
+  analysis_running_ = true;
+  start_thread_pool();
+  chain_loads_.assign(num_parallels_, ChainLoad());
+  run_start_ = ModuleTiming::Clock::now();
+  try {
+    thread_pool_.run([&](int i){
+        process_analysis_in_each_thread(i, std::move(status_promise_vector[i]));
+      });
   }
-  for (ANLStatus s: status_vector) {
-    if (s == ANLStatus::critical_error_to_terminate) {
-      status = s;
-    }
+  catch (...) {
+    analysis_running_ = false;
+    throw;
   }
-  for (ANLStatus s: status_vector) {
-    if (s == ANLStatus::critical_error_to_terminate_from_exception) {
-      status = s;
-    }
+  analysis_running_ = false;
+
+  std::vector<ANLStatus> status_vector(num_parallels_, AS_OK);
+  for (int i=0; i<num_parallels_; i++) {
+    status_vector[i] = status_future_vector[i].get();
   }
 
-  return status;
+  return most_critical_status(status_vector);
 }
 
 void ANLManagerMT::process_analysis_in_each_thread(int i_thread, std::promise<ANLStatus> status_promise)
 {
+  ChainLoad& load = chain_loads_[i_thread];
+  load.start = ModuleTiming::Clock::now();
+  load.finish = load.start;
+  const std::chrono::nanoseconds keeper_wait0 = Sequencer::thread_wait_time();
   try {
     ANLStatus status = AS_OK;
     if (i_thread==0) {
-      status = process_analysis_impl(modules_, counters_, *evs_manager_);
+      status = process_analysis_impl(i_thread, modules_, counters_, *evs_manager_, *event_store_, execution_plan_);
     }
     else {
       using std::placeholders::_1;
       using std::placeholders::_2;
       using std::placeholders::_3;
-      status = cloned_chains_[i_thread-1].process(std::bind(&ANLManagerMT::process_analysis_impl, this, _1, _2, _3));
+      using std::placeholders::_4;
+      using std::placeholders::_5;
+      status = cloned_chains_[i_thread-1].process(std::bind(&ANLManagerMT::process_analysis_impl, this, i_thread, _1, _2, _3, _4, _5));
     }
+    load.finish = ModuleTiming::Clock::now();
+    load.keeper_wait = Sequencer::thread_wait_time()-keeper_wait0;
     status_promise.set_value(status);
   }
   catch (...) {
+    load.finish = ModuleTiming::Clock::now();
+    load.keeper_wait = Sequencer::thread_wait_time()-keeper_wait0;
     if (exception_propagation()) {
       requested_ = ANLRequest::quit;
       status_promise.set_exception(std::current_exception());
@@ -293,25 +650,65 @@ void ANLManagerMT::process_analysis_in_each_thread(int i_thread, std::promise<AN
   }
 }
 
-ANLStatus ANLManagerMT::process_analysis_impl(const std::vector<BasicModule*>& modules,
+ANLStatus ANLManagerMT::process_analysis_impl(int i_thread,
+                                              const std::vector<BasicModule*>& modules,
                                               std::vector<LoopCounter>& counters,
-                                              EvsManager& evs_manager)
+                                              EvsManager& evs_manager,
+                                              EventStore& event_store,
+                                              ExecutionPlan& plan)
 {
   ANLStatus status = AS_OK;
 
   const long int period_disp = display_period();
   const long int num_events = number_of_loops();
+  EventStatistics& statistics = (i_thread==0) ? event_statistics_ : cloned_chains_[i_thread-1].event_statistics();
+  ChainLoad& load = chain_loads_[i_thread];
 
   try {
     while (true) {
-      const long int i_event = event_index_to_process();
-      if (i_event == num_events) { break; }
+      const bool traced = Tracer::is_enabled();
+      const ModuleTiming::Clock::time_point t_dispatch = traced ? ModuleTiming::Clock::now() : ModuleTiming::Clock::time_point();
+      long int i_position = event_index_to_process(i_thread);
+      if (i_position == num_events) { break; }
+      long int i_event = event_index(i_position);
+      if (traced && Tracer::is_sampled(i_event)) {
+        Tracer::record("dispatch", "dispatch", nullptr, i_event, t_dispatch, ModuleTiming::Clock::now());
+      }
 
-      if (period_disp != 0 && i_event%period_disp == 0) {
+      if (period_disp != 0 && i_position%period_disp == 0) {
         print_event_index(i_event);
       }
 
-      status = process_one_event(i_event, modules, counters, evs_manager, order_keepers_);
+      const bool timing = ModuleTiming::is_enabled();
+      const ModuleTiming::Clock::time_point t0 = timing ? ModuleTiming::Clock::now() : ModuleTiming::Clock::time_point();
+      long int done = 1;
+
+      long int batch = batch_length(i_position, plan);
+      if (batch > 1) {
+        batch = 1 + dispatcher_.take_following(i_thread, batch-1);
+      }
+      if (batch > 1) {
+        done = process_event_batch(i_event, batch, plan, evs_manager, event_store, status);
+        dispatcher_.give_back(i_thread, batch-done);
+        for (long int k=1; k<done; k++) {
+          if (period_disp != 0 && (i_position+k)%period_disp == 0) {
+            print_event_index(event_index(i_position+k));
+          }
+        }
+        i_position += done-1;
+        i_event = event_index(i_position);
+      }
+      else {
+        status = process_one_event(i_event, plan, evs_manager, event_store, i_position, quit_order_);
+      }
+
+      if (status != AS_REDO) {
+        load.events += done;
+        if (timing) {
+          const ModuleTiming::Clock::time_point t1 = ModuleTiming::Clock::now();
+          statistics.record(t1-t0, done, t1-statistics_origin_);
+        }
+      }
 
       if (is_critical_error(status)) {
         requested_ = ANLRequest::quit;
@@ -334,20 +731,46 @@ ANLStatus ANLManagerMT::process_analysis_impl(const std::vector<BasicModule*>& m
           print_event_index(i_event);
           evs_manager_->print_summary();
         }
+        else if (requested_ == ANLRequest::show_results) {
+          print_event_index(i_event);
+          if (snapshot_enabled_) {
+            request_snapshot(i_position);
+          }
+          else {
+            std::cout << "No module supports snapshots of the results." << std::endl;
+          }
+        }
+        else if (requested_ == ANLRequest::show_latency) {
+          print_event_index(i_event);
+          print_latency();
+        }
         requested_ = ANLRequest::none;
       }
 
+      if (snapshot_enabled_) {
+        if (snapshot_is_due(i_position)) {
+          request_snapshot(i_position);
+        }
+        if (snapshot_contributed_[i_thread] < snapshot_requested_.load(std::memory_order_acquire)) {
+          contribute_to_snapshot(i_thread, modules, counters, false);
+        }
+      }
+
       if (status==ANLStatus::skip) {
         ;
       }
       else if (status==ANLStatus::redo) {
-        decrement_event_index();
+        decrement_event_index(i_thread);
       }
     }
 
     if (status == AS_QUIT_ALL) {
       requested_ = ANLRequest::quit;
     }
+
+    if (snapshot_enabled_) {
+      contribute_to_snapshot(i_thread, modules, counters, true);
+    }
   }
   catch (ANLException& ex) {
     if (const ANLException::Treatment* t = boost::get_error_info<ExceptionTreatment>(ex)) {
@@ -375,42 +798,876 @@ ANLStatus ANLManagerMT::process_analysis_impl(const std::vector<BasicModule*>& m
   return AS_OK;
 }
 
-ANLStatus ANLManagerMT::reduce_modules()
+void ANLManagerMT::setup_pipeline()
 {
-  ANLStatus status = AS_OK;
-  for (std::size_t i_module=0; i_module<modules_.size(); i_module++) {
-    BasicModule* mod = modules_[i_module];
-    std::list<BasicModule*> module_list;
-    for (const ClonedChainSet& chain: cloned_chains_) {
-      module_list.push_back(chain.modules_reference()[i_module]);
-    }
-    status = mod->mod_reduce(module_list);
-    if (status != AS_OK) {
-      break;
+  stages_.clear();
+  for (std::size_t i=0; i<modules_.size(); i++) {
+    if (stages_.empty() || modules_[i]->is_stage_head()) {
+      stages_.emplace_back();
+      stages_.back().first_module = i;
+      stages_.back().evs_manager.reset(new EvsManager);
     }
+    stages_.back().modules.push_back(modules_[i]);
+  }
+  if (stages_.empty()) {
+    stages_.emplace_back();
+    stages_.back().evs_manager.reset(new EvsManager);
   }
-  return status;
 }
 
-void ANLManagerMT::reduce_statistics()
+void ANLManagerMT::setup_farm()
 {
-  for (const ClonedChainSet& chain: cloned_chains_) {
-    for (std::size_t i=0; i<modules_.size(); i++) {
-      counters_[i] += chain.get_counter(i);
+  setup_pipeline();
+  const std::size_t num_marked_stages = stages_.size();
+  const std::size_t body_begin = (num_marked_stages>=2) ? stages_[1].first_module : 0;
+  const std::size_t body_end = (num_marked_stages>=3) ? stages_.back().first_module : modules_.size();
+  const std::size_t boundaries[4] = { 0, body_begin, body_end, modules_.size() };
+
+  stages_.clear();
+  for (int i=0; i<3; i++) {
+    stages_.emplace_back();
+    PipelineStage& stage = stages_.back();
+    stage.first_module = boundaries[i];
+    stage.modules.assign(modules_.begin()+boundaries[i], modules_.begin()+boundaries[i+1]);
+    stage.evs_manager.reset(new EvsManager);
+  }
+}
+
+void ANLManagerMT::prepare_pipeline_run(std::size_t queue_capacity)
+{
+  const std::size_t depth = std::max(pipeline_depth_, 1);
+  tokens_.clear();
+  tokens_.resize(depth);
+  free_tokens_.reset(new BoundedQueue<PipelineToken*>(depth));
+  for (PipelineToken& token: tokens_) {
+    // the event data travel with the token through the stages.
+    token.event_store.reset(new EventStore(event_store_->layout()));
+    free_tokens_->push(&token);
+  }
+
+  for (PipelineStage& stage: stages_) {
+    *stage.evs_manager = *evs_manager_;
+    stage.evs_manager->reset_all_flags();
+    stage.evs_manager->reset_all_counts();
+    for (BasicModule* mod: stage.modules) {
+      mod->set_evs_manager(stage.evs_manager.get());
     }
-    evs_manager_->merge(chain.get_evs());
+    stage.input.reset(new BoundedQueue<PipelineToken*>(queue_capacity));
+    stage.exception = nullptr;
   }
+  pipeline_stopped_ = false;
 }
 
-boost::property_tree::ptree ANLManagerMT::parameters_to_property_tree() const
+void ANLManagerMT::finish_pipeline_run()
 {
-  boost::property_tree::ptree pt = ANLManager::parameters_to_property_tree();
-  for (const ClonedChainSet& chain: cloned_chains_) {
-    boost::property_tree::ptree pt_modules;
-    for (const BasicModule* module: chain.modules_reference()) {
-      pt_modules.push_back(std::make_pair("", module->parameters_to_property_tree()));
+  for (PipelineStage& stage: stages_) {
+    for (BasicModule* mod: stage.modules) {
+      mod->set_evs_manager(evs_manager_.get());
+      mod->set_event_store(event_store_.get());
+    }
+  }
+  for (ClonedChainSet& chain: cloned_chains_) {
+    for (BasicModule* mod: chain.modules_reference()) {
+      mod->set_event_store(&chain.get_event_store());
+    }
+  }
+  evs_manager_->merge(*stages_.back().evs_manager);
+
+  for (PipelineStage& stage: stages_) {
+    if (stage.exception) {
+      std::rethrow_exception(stage.exception);
+    }
+  }
+}
+
+ANLStatus ANLManagerMT::process_analysis_pipeline()
+{
+  const std::size_t num_stages = stages_.size();
+  prepare_pipeline_run(std::max(pipeline_depth_, 1));
+
+  std::vector<ANLStatus> status_vector(num_stages, AS_OK);
+  start_thread_pool();
+  thread_pool_.run([&](int i){
+      status_vector[i] = process_pipeline_stage(i);
+    });
+
+  finish_pipeline_run();
+  return most_critical_status(status_vector);
+}
+
+ANLStatus ANLManagerMT::process_pipeline_stage(std::size_t i_stage)
+{
+  PipelineStage& stage = stages_[i_stage];
+  const bool first = (i_stage == 0);
+  const bool last = (i_stage+1 == stages_.size());
+
+  ANLStatus stage_status = AS_OK;
+  bool draining = false;
+  long int next_index = 0;
+
+  while (true) {
+    PipelineToken* token = nullptr;
+    if (first) {
+      token = generate_token(draining, next_index);
+    }
+    else {
+      stage.input->pop(token);
+    }
+
+    const bool end = token->end;
+    if (!end) {
+      if (draining) {
+        token->discarded = true;
+      }
+
+      process_token(token, stage.plan, *stage.evs_manager, first, stage.exception);
+      if (check_token_to_stop(token, stage_status)) {
+        draining = true;
+      }
+
+      if (first) {
+        handle_request(token->index);
+      }
+
+      if (last && !token->discarded) {
+        stage.evs_manager->load_flags(token->evs_flags);
+        count_evs(token->index, token->status, *stage.evs_manager);
+        record_token(token);
+      }
+    }
+
+    if (last) {
+      free_tokens_->push(token);
+    }
+    else {
+      stages_[i_stage+1].input->push(token);
+    }
+
+    if (end) { break; }
+  }
+
+  return stage_status;
+}
+
+ANLStatus ANLManagerMT::process_analysis_farm()
+{
+  const std::size_t window = std::max(pipeline_depth_, 1);
+  prepare_pipeline_run(window + num_parallels_);
+
+  reorder_buffer_.reset(new std::atomic<PipelineToken*>[window]);
+  for (std::size_t i=0; i<window; i++) {
+    reorder_buffer_[i].store(nullptr, std::memory_order_relaxed);
+  }
+  worker_exceptions_.assign(num_parallels_, nullptr);
+
+  // flags are carried in the key order, so every chain must have all the keys.
+  for (ClonedChainSet& chain: cloned_chains_) {
+    EvsManager& evs = chain.get_evs();
+    for (const auto& e: evs_manager_->data()) {
+      if (!evs.is_defined(e.first)) {
+        evs.define(e.first);
+      }
+    }
+  }
+
+  ANLStatus head_status = AS_OK;
+  ANLStatus tail_status = AS_OK;
+  start_thread_pool();
+  thread_pool_.run([&](int i){
+      if (i == 0) {
+        head_status = process_farm_head();
+      }
+      else if (i == num_parallels_+1) {
+        tail_status = process_farm_tail();
+      }
+      else {
+        process_farm_worker(i-1);
+      }
+    });
+
+  finish_pipeline_run();
+  for (std::exception_ptr& e: worker_exceptions_) {
+    if (e) {
+      std::rethrow_exception(e);
+    }
+  }
+
+  return most_critical_status({head_status, tail_status});
+}
+
+ANLStatus ANLManagerMT::process_farm_head()
+{
+  PipelineStage& stage = stages_[0];
+  BoundedQueue<PipelineToken*>& work_queue = *stages_[1].input;
+  const std::size_t window = tokens_.size();
+
+  ANLStatus stage_status = AS_OK;
+  bool draining = false;
+  long int next_index = 0;
+
+  while (true) {
+    PipelineToken* token = generate_token(draining, next_index);
+    if (token->end) {
+      reorder_buffer_[token->position%window].store(token, std::memory_order_release);
+      for (int i=0; i<num_parallels_; i++) {
+        work_queue.push(nullptr);
+      }
+      break;
+    }
+
+    process_token(token, stage.plan, *stage.evs_manager, true, stage.exception);
+    if (check_token_to_stop(token, stage_status)) {
+      draining = true;
+    }
+    handle_request(token->index);
+
+    if (token->status == AS_OK) {
+      work_queue.push(token);
+    }
+    else {
+      reorder_buffer_[token->position%window].store(token, std::memory_order_release);
+    }
+  }
+
+  return stage_status;
+}
+
+void ANLManagerMT::process_farm_worker(int i_worker)
+{
+  PipelineStage& body = stages_[1];
+  BoundedQueue<PipelineToken*>& work_queue = *body.input;
+  const std::size_t window = tokens_.size();
+
+  while (true) {
+    PipelineToken* token = nullptr;
+    work_queue.pop(token);
+    if (token == nullptr) { break; }
+
+    if (i_worker == 0) {
+      process_token(token, body.plan, *body.evs_manager, false, worker_exceptions_[i_worker]);
+    }
+    else {
+      cloned_chains_[i_worker-1].process(
+        [&](const std::vector<BasicModule*>&,
+            std::vector<LoopCounter>&,
+            EvsManager& evs_manager,
+            EventStore&,
+            ExecutionPlan& plan) {
+          process_token(token, plan, evs_manager, false, worker_exceptions_[i_worker]);
+          return AS_OK;
+        });
+    }
+
+    reorder_buffer_[token->position%window].store(token, std::memory_order_release);
+  }
+}
+
+ANLStatus ANLManagerMT::process_farm_tail()
+{
+  PipelineStage& stage = stages_[2];
+  const std::size_t window = tokens_.size();
+
+  ANLStatus stage_status = AS_OK;
+  bool draining = false;
+  long int next_index = 0;
+
+  while (true) {
+    std::atomic<PipelineToken*>& slot = reorder_buffer_[next_index%window];
+    PipelineToken* token = slot.load(std::memory_order_acquire);
+    for (int n=0; token==nullptr; n++) {
+      BoundedQueue<PipelineToken*>::back_off(n);
+      token = slot.load(std::memory_order_acquire);
+    }
+    slot.store(nullptr, std::memory_order_relaxed);
+    next_index++;
+
+    const bool end = token->end;
+    if (!end) {
+      if (draining) {
+        token->discarded = true;
+      }
+
+      process_token(token, stage.plan, *stage.evs_manager, false, stage.exception);
+      if (check_token_to_stop(token, stage_status)) {
+        draining = true;
+      }
+
+      if (!token->discarded) {
+        stage.evs_manager->load_flags(token->evs_flags);
+        count_evs(token->index, token->status, *stage.evs_manager);
+        record_token(token);
+      }
+    }
+
+    free_tokens_->push(token);
+    if (end) { break; }
+  }
+
+  return stage_status;
+}
+
+ANLManagerMT::PipelineToken* ANLManagerMT::generate_token(bool stop, long int& next_index)
+{
+  PipelineToken* token = nullptr;
+  free_tokens_->pop(token);
+  token->status = AS_OK;
+  token->discarded = false;
+  token->position = next_index;
+  token->end = (stop || pipeline_stopped_ || next_index == number_of_loops());
+  if (!token->end) {
+    token->start = ModuleTiming::is_enabled() ? ModuleTiming::Clock::now() : ModuleTiming::Clock::time_point();
+    token->index = event_index(next_index);
+    token->event_store->reset_event();
+    next_index++;
+    const long int period_disp = display_period();
+    if (period_disp != 0 && token->position%period_disp == 0) {
+      print_event_index(token->index);
+    }
+  }
+  return token;
+}
+
+void ANLManagerMT::record_token(const PipelineToken* token)
+{
+  // a token generated before the timing was switched on has no start time.
+  if (ModuleTiming::is_enabled() && token->start != ModuleTiming::Clock::time_point()) {
+    const ModuleTiming::Clock::time_point t = ModuleTiming::Clock::now();
+    event_statistics_.record(t-token->start, 1, t-statistics_origin_);
+  }
+}
+
+void ANLManagerMT::handle_request(long int i_event)
+{
+  if (requested_ != ANLRequest::none) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (requested_ == ANLRequest::quit) {
+      pipeline_stopped_ = true;
+      return;
+    }
+    else if (requested_ == ANLRequest::show_event_index) {
+      print_event_index(i_event);
+    }
+    else if (requested_ == ANLRequest::show_evs_summary) {
+      print_event_index(i_event);
+      evs_manager_->print_summary();
+    }
+    else if (requested_ == ANLRequest::show_results) {
+      print_event_index(i_event);
+      std::cout << "Snapshots of the results are available only in the event-parallel mode." << std::endl;
+    }
+    else if (requested_ == ANLRequest::show_latency) {
+      print_event_index(i_event);
+      print_latency();
+    }
+    requested_ = ANLRequest::none;
+  }
+}
+
+void ANLManagerMT::process_token(PipelineToken* token,
+                                 ExecutionPlan& plan,
+                                 EvsManager& evs_manager,
+                                 bool reset_evs,
+                                 std::exception_ptr& exception)
+{
+  if (token->discarded || token->status != AS_OK) {
+    return;
+  }
+
+  // a redo re-runs this stage only; the earlier stages have passed the event on.
+  ANLStatus status = AS_OK;
+  try {
+    do {
+      if (reset_evs) {
+        evs_manager.reset_all_flags();
+      }
+      else {
+        evs_manager.load_flags(token->evs_flags);
+      }
+      status = process_modules(token->index, plan, *token->event_store);
+    } while (status == AS_REDO && requested_ != ANLRequest::quit);
+  }
+  catch (ANLException& ex) {
+    status = ANLStatus::critical_error_to_terminate_from_exception;
+    const ANLException::Treatment* t = boost::get_error_info<ExceptionTreatment>(ex);
+    if (t && *t == ANLException::Treatment::finalize) {
+      print_exception(ex);
+      status = ANLStatus::critical_error_to_finalize_from_exception;
+    }
+    else if (t && *t == ANLException::Treatment::terminate) {
+      print_exception(ex);
+    }
+    else if (t && *t == ANLException::Treatment::hard_terminate) {
+      print_exception(ex);
+      std::terminate();
+    }
+    else {
+      exception = std::current_exception();
+    }
+  }
+  catch (...) {
+    status = ANLStatus::critical_error_to_terminate_from_exception;
+    exception = std::current_exception();
+  }
+
+  evs_manager.save_flags(token->evs_flags);
+  token->status = status;
+}
+
+bool ANLManagerMT::check_token_to_stop(const PipelineToken* token, ANLStatus& stage_status)
+{
+  if (token->discarded) {
+    return false;
+  }
+
+  if (is_critical_error(token->status)) {
+    stage_status = token->status;
+    pipeline_stopped_ = true;
+    return true;
+  }
+  else if (token->status == AS_QUIT || token->status == AS_QUIT_ALL) {
+    pipeline_stopped_ = true;
+    return true;
+  }
+  return false;
+}
+
+ANLStatus ANLManagerMT::reduce_modules()
+{
+  const bool traced = Tracer::is_enabled();
+  ANLStatus status = AS_OK;
+  for (std::size_t i_module=0; i_module<modules_.size(); i_module++) {
+    BasicModule* mod = modules_[i_module];
+    const ModuleTiming::Clock::time_point t0 = traced ? ModuleTiming::Clock::now() : ModuleTiming::Clock::time_point();
+    std::list<BasicModule*> module_list;
+    if (cloned_begin_ <= i_module && i_module < cloned_end_) {
+      for (const ClonedChainSet& chain: cloned_chains_) {
+        module_list.push_back(chain.modules_reference()[i_module-cloned_begin_]);
+      }
+    }
+
+    if (mod->mod_merge_is_associative() && module_list.size() >= 2) {
+      std::vector<BasicModule*> modules(1, mod);
+      modules.insert(modules.end(), module_list.begin(), module_list.end());
+      status = merge_in_tree(modules);
+    }
+    else {
+      status = mod->mod_reduce(module_list);
+    }
+
+    if (traced) {
+      Tracer::record("reduce", "reduce", mod, -1, t0, ModuleTiming::Clock::now());
+    }
+
+    if (status != AS_OK) {
+      break;
+    }
+  }
+  return status;
+}
+
+ANLStatus ANLManagerMT::merge_in_tree(const std::vector<BasicModule*>& modules)
+{
+  const std::size_t num_modules = modules.size();
+  start_thread_pool();
+  const std::size_t num_threads = thread_pool_.size();
+  const bool traced = Tracer::is_enabled();
+
+  for (std::size_t stride=1; stride<num_modules; stride*=2) {
+    std::vector<ANLStatus> status_vector(num_threads, AS_OK);
+    thread_pool_.run([&](int i_thread){
+        std::size_t i_pair = 0;
+        for (std::size_t i=0; i+stride<num_modules; i+=2*stride, i_pair++) {
+          if (i_pair%num_threads != static_cast<std::size_t>(i_thread)) { continue; }
+          const ModuleTiming::Clock::time_point t0 = traced ? ModuleTiming::Clock::now() : ModuleTiming::Clock::time_point();
+          const ANLStatus s = modules[i]->mod_merge(modules[i+stride]);
+          if (traced) {
+            Tracer::record("merge", "reduce", modules[i], -1, t0, ModuleTiming::Clock::now());
+          }
+          if (status_vector[i_thread] == AS_OK) {
+            status_vector[i_thread] = s;
+          }
+        }
+      });
+
+    const ANLStatus status = aggregate_status(status_vector);
+    if (status != AS_OK) {
+      return status;
+    }
+  }
+  return AS_OK;
+}
+
+void ANLManagerMT::reduce_statistics()
+{
+  for (ClonedChainSet& chain: cloned_chains_) {
+    for (std::size_t i=cloned_begin_; i<cloned_end_; i++) {
+      counters_[i] += chain.get_counter(i-cloned_begin_);
+    }
+    event_statistics_ += chain.event_statistics();
+    evs_manager_->merge(chain.get_evs());
+    chain.reset_counters();
+  }
+}
+
+void ANLManagerMT::print_load_balance()
+{
+  if (chain_loads_.size() < 2) { return; }
+
+  using seconds = std::chrono::duration<double>;
+  ModuleTiming::Clock::time_point run_end = run_start_;
+  for (const ChainLoad& load: chain_loads_) {
+    run_end = std::max(run_end, load.finish);
+  }
+  const double wall = seconds(run_end-run_start_).count();
+  if (wall <= 0.0) { return; }
+  const int num_threads = chain_loads_.size();
+  const double thread_time = wall*num_threads;
+
+  std::cout << '\n'
+            << "        **************************************\n"
+            << "        ****  Load balance and contention ****\n"
+            << "        **************************************\n"
+            << '\n';
+  std::cout << boost::format("    wall time: %12.6f s on %d threads\n") % wall % num_threads;
+
+  std::cout << "    Chains:\n";
+  int most_idle_chain = 0;
+  double most_idle = 0.0;
+  for (int i=0; i<num_threads; i++) {
+    const ChainLoad& load = chain_loads_[i];
+    // the waits at the keepers and for the dispatcher locks are not work.
+    const double wait = (seconds(load.keeper_wait).count()
+                         + seconds(dispatcher_.lock_wait_time(i)).count());
+    const double busy = std::max(0.0, seconds(load.finish-load.start).count() - wait);
+    const double idle = seconds(run_end-load.finish).count();
+    std::cout << boost::format("      [%4d]  events: %10d | busy: %12.6f s | idle at end: %12.6f s (%6.2f %%)\n")
+      % i % load.events % busy % idle % (100.0*idle/wall);
+    if (idle > most_idle) {
+      most_idle = idle;
+      most_idle_chain = i;
+    }
+  }
+  if (most_idle/wall > 0.1) {
+    std::cout << boost::format("      ---> imbalanced: chain %d idled %.0f%% of the wall time at the end of the run;"
+                               " a smaller chunk size or the work-stealing schedule would keep it busy\n")
+      % most_idle_chain % (100.0*most_idle/wall);
+  }
+  else {
+    std::cout << boost::format("      ---> balanced: no chain idled more than %.1f%% of the wall time at the end of the run\n")
+      % (100.0*most_idle/wall);
+  }
+
+  bool keeper_header = false;
+  for (std::size_t i=0; i<order_keepers_.size(); i++) {
+    const Sequencer* keeper = order_keepers_[i].get();
+    if (keeper == nullptr) { continue; }
+    if (!keeper_header) {
+      std::cout << "    Order keepers:\n";
+      keeper_header = true;
+    }
+
+    std::string module_ID = modules_[i]->module_name();
+    if (modules_[i]->module_id() != modules_[i]->module_name()) {
+      module_ID += "/" + modules_[i]->module_id();
+    }
+    const double wait = seconds(keeper->wait_time()).count();
+    const double wait_fraction = wait/thread_time;
+    std::cout << boost::format("      [%4d]  %-40s  wait: %12.6f s (%6.2f %% of thread time) | waits: %10d\n")
+      % i % module_ID % wait % (100.0*wait_fraction) % keeper->num_waits();
+
+    // while a chain runs the module, the others cannot pass its keeper.
+    const ModuleTiming timing = total_module_timing(i);
+    if (timing.calls(ModulePhase::analyze) > 0) {
+      const double serial_fraction = timing.seconds(ModulePhase::analyze)/wall;
+      if (serial_fraction >= 0.5) {
+        std::cout << boost::format("      ---> order-sensitive module %s serializes %.0f%% of wall time;"
+                                   " more threads will not help until it is made order-insensitive\n")
+          % module_ID % (100.0*serial_fraction);
+      }
+      else {
+        std::cout << boost::format("      ---> order-sensitive module %s serializes %.0f%% of wall time;"
+                                   " the threads waited for it %.0f%% of their time\n")
+          % module_ID % (100.0*serial_fraction) % (100.0*wait_fraction);
+      }
+    }
+    else if (wait_fraction >= 0.1) {
+      std::cout << boost::format("      ---> the threads waited for order-sensitive module %s %.0f%% of their time;"
+                                 " make it order-insensitive or use fewer threads\n")
+        % module_ID % (100.0*wait_fraction);
+    }
+    else {
+      std::cout << boost::format("      ---> order-sensitive module %s costs little waiting\n") % module_ID;
+    }
+  }
+
+  std::cout << "    Dispatcher:\n";
+  if (dispatcher_.uses_locks()) {
+    double lock_wait = 0.0;
+    for (int i=0; i<num_threads; i++) {
+      lock_wait += seconds(dispatcher_.lock_wait_time(i)).count();
+    }
+    std::cout << boost::format("      lock wait: %12.6f s (%6.2f %% of thread time)\n")
+      % lock_wait % (100.0*lock_wait/thread_time);
+    if (lock_wait/thread_time > 0.01) {
+      std::cout << "      ---> contended: the threads wait for each other's event ranges; a larger chunk size would reduce it\n";
+    }
+    else {
+      std::cout << "      ---> uncontended\n";
+    }
+  }
+  else {
+    std::cout << boost::format("      ---> lock-free: the threads take chunks of %d event(s) from an atomic counter\n")
+      % dispatcher_.effective_chunk_size();
+  }
+  std::cout << std::endl;
+}
+
+void ANLManagerMT::count_put_and_get(long int& put, long int& get) const
+{
+  if (execution_mode_ == ExecutionMode::event_parallel) {
+    ANLManager::count_put_and_get(put, get);
+    for (const ClonedChainSet& chain: cloned_chains_) {
+      put += chain.execution_plan().number_of_events();
+      get += chain.execution_plan().number_of_completed_events();
+    }
+    return;
+  }
+
+  // an event goes to the next stage only if it is not rejected.
+  put = stages_.front().plan.number_of_events();
+  get = stages_.back().plan.number_of_completed_events();
+}
+
+void ANLManagerMT::setup_snapshot()
+{
+  snapshot_enabled_ = false;
+  snapshot_building_.clear();
+  snapshot_published_.clear();
+  // the snapshots are bare clones; see BasicModule::mod_snapshot().
+  for (BasicModule* mod: modules_) {
+    if (mod->mod_snapshot_is_supported()) {
+      snapshot_building_.push_back(mod->clone());
+      snapshot_published_.push_back(mod->clone());
+      snapshot_enabled_ = true;
+    }
+    else {
+      snapshot_building_.push_back(nullptr);
+      snapshot_published_.push_back(nullptr);
+    }
+  }
+}
+
+void ANLManagerMT::reset_snapshot()
+{
+  std::lock_guard<std::mutex> lock(snapshot_mutex_);
+  snapshot_requested_ = 0;
+  snapshot_completed_ = 0;
+  snapshot_contributed_.assign(num_parallels_, 0);
+  snapshot_contributors_ = 0;
+  snapshot_building_ok_ = true;
+  snapshot_finished_chains_.clear();
+  snapshot_published_events_ = -1;
+
+  next_snapshot_event_ = snapshot_period_events_;
+  next_snapshot_time_ = snapshot_time_after(std::chrono::steady_clock::now(), snapshot_period_seconds_);
+}
+
+bool ANLManagerMT::snapshot_is_due(long int i_event) const
+{
+  if (snapshot_requested_.load(std::memory_order_relaxed) != snapshot_completed_.load(std::memory_order_relaxed)) {
+    return false;
+  }
+
+  if (snapshot_period_events_ > 0 && i_event >= next_snapshot_event_.load(std::memory_order_relaxed)) {
+    return true;
+  }
+
+  if (snapshot_period_seconds_ > 0.0) {
+    const std::chrono::steady_clock::rep now = std::chrono::steady_clock::now().time_since_epoch().count();
+    if (now >= next_snapshot_time_.load(std::memory_order_relaxed)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void ANLManagerMT::request_snapshot(long int i_event)
+{
+  std::lock_guard<std::mutex> lock(snapshot_mutex_);
+  // a new round starts only after the previous one has been completed.
+  long int completed = snapshot_completed_.load();
+  if (snapshot_requested_.compare_exchange_strong(completed, completed+1)) {
+    next_snapshot_event_ = i_event + snapshot_period_events_;
+    next_snapshot_time_ = snapshot_time_after(std::chrono::steady_clock::now(), snapshot_period_seconds_);
+  }
+}
+
+void ANLManagerMT::contribute_to_snapshot(int i_thread,
+                                          const std::vector<BasicModule*>& modules,
+                                          const std::vector<LoopCounter>& counters,
+                                          bool finished)
+{
+  std::lock_guard<std::mutex> lock(snapshot_mutex_);
+  const long int round = snapshot_requested_.load();
+  if (snapshot_contributed_[i_thread] < round) {
+    snapshot_contributed_[i_thread] = round;
+    add_to_snapshot(modules, counters);
+  }
+
+  if (finished) {
+    // the chain is no longer updated; it is added to the later rounds by
+    // the thread that starts each round.
+    snapshot_finished_chains_.emplace_back(&modules, &counters);
+  }
+}
+
+void ANLManagerMT::add_to_snapshot(const std::vector<BasicModule*>& modules,
+                                   const std::vector<LoopCounter>& counters)
+{
+  auto number_of_events = [](const std::vector<LoopCounter>& counters) {
+    long int n = 0;
+    for (const LoopCounter& c: counters) {
+      n = std::max(n, c.entry()+c.gated());
+    }
+    return n;
+  };
+
+  auto merge_chain = [&](const std::vector<BasicModule*>& chain_modules,
+                         const std::vector<LoopCounter>& chain_counters) {
+    for (std::size_t i=0; i<snapshot_building_.size(); i++) {
+      if (snapshot_building_[i]) {
+        if (snapshot_building_[i]->mod_merge(chain_modules[i]) != AS_OK) {
+          snapshot_building_ok_ = false;
+        }
+      }
+    }
+    snapshot_building_events_ += number_of_events(chain_counters);
+    snapshot_contributors_++;
+  };
+
+  if (snapshot_contributors_ == 0) {
+    for (std::size_t i=0; i<snapshot_building_.size(); i++) {
+      if (snapshot_building_[i]) {
+        if (modules[i]->mod_snapshot(snapshot_building_[i].get()) != AS_OK) {
+          snapshot_building_ok_ = false;
+        }
+      }
+    }
+    snapshot_building_events_ = number_of_events(counters);
+    snapshot_contributors_ = 1;
+
+    for (const auto& chain: snapshot_finished_chains_) {
+      merge_chain(*chain.first, *chain.second);
+    }
+  }
+  else {
+    merge_chain(modules, counters);
+  }
+
+  if (snapshot_contributors_ == num_parallels_) {
+    if (snapshot_building_ok_) {
+      snapshot_building_.swap(snapshot_published_);
+      snapshot_published_events_ = snapshot_building_events_;
+      print_snapshot();
+    }
+    else {
+      std::cout << "ANLManagerMT: a snapshot of the results has failed." << std::endl;
+    }
+    snapshot_contributors_ = 0;
+    snapshot_building_ok_ = true;
+    snapshot_completed_ = snapshot_requested_.load();
+  }
+}
+
+void ANLManagerMT::print_snapshot() const
+{
+  std::cout << '\n'
+            << "        **************************************\n"
+            << "        ****   Module results (snapshot)  ****\n"
+            << "        **************************************\n"
+            << std::endl;
+
+  if (snapshot_published_events_ < 0) {
+    std::cout << "No snapshot of the results is available yet.\n" << std::endl;
+    return;
+  }
+
+  std::cout << "Number of events: " << snapshot_published_events_ << '\n'
+            << std::endl;
+  for (const auto& mod: snapshot_published_) {
+    if (mod) {
+      std::cout << "--- " << mod->module_id() << " ---"<< std::endl;
+      mod->print_results();
+      std::cout << std::endl;
+    }
+  }
+}
+
+ModuleTiming ANLManagerMT::total_module_timing(std::size_t i) const
+{
+  ModuleTiming timing = ANLManager::total_module_timing(i);
+  if (cloned_begin_ <= i && i < cloned_end_) {
+    for (const ClonedChainSet& chain: cloned_chains_) {
+      timing += chain.modules_reference()[i-cloned_begin_]->timing();
+    }
+  }
+  return timing;
+}
+
+ModuleCounters ANLManagerMT::total_perf_counters(std::size_t i) const
+{
+  ModuleCounters counters = ANLManager::total_perf_counters(i);
+  if (cloned_begin_ <= i && i < cloned_end_) {
+    for (const ClonedChainSet& chain: cloned_chains_) {
+      counters += chain.modules_reference()[i-cloned_begin_]->perf_counters();
+    }
+  }
+  return counters;
+}
+
+EventStatistics ANLManagerMT::total_event_statistics() const
+{
+  EventStatistics statistics = ANLManager::total_event_statistics();
+  for (const ClonedChainSet& chain: cloned_chains_) {
+    statistics += chain.event_statistics();
+  }
+  return statistics;
+}
+
+boost::property_tree::ptree ANLManagerMT::parameters_to_property_tree() const
+{
+  boost::property_tree::ptree pt = ANLManager::parameters_to_property_tree();
+  for (const ClonedChainSet& chain: cloned_chains_) {
+    boost::property_tree::ptree pt_modules;
+    boost::property_tree::ptree pt_timing;
+    bool measured = false;
+    for (const BasicModule* module: chain.modules_reference()) {
+      pt_modules.push_back(std::make_pair("", module->parameters_to_property_tree()));
+
+      measured = measured || !module->timing().empty();
+      boost::property_tree::ptree pt_module;
+      pt_module.put("module_id", module->module_id());
+      pt_module.put("total_seconds", module->timing().total_seconds());
+      pt_module.add_child("phases", module->timing().to_property_tree());
+      pt_timing.push_back(std::make_pair("", std::move(pt_module)));
     }
     pt.add_child(boost::str(boost::format("application.chain%d")%chain.chain_id()), std::move(pt_modules));
+    if (measured) {
+      pt.add_child(boost::str(boost::format("application.module_timing_chain%d")%chain.chain_id()),
+                   std::move(pt_timing));
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(snapshot_mutex_);
+  if (snapshot_published_events_ >= 0) {
+    boost::property_tree::ptree pt_modules;
+    for (const auto& mod: snapshot_published_) {
+      if (mod) {
+        pt_modules.push_back(std::make_pair("", mod->parameters_to_property_tree()));
+      }
+    }
+    pt.put("application.snapshot.number_of_events", snapshot_published_events_);
+    pt.add_child("application.snapshot.module_list", std::move(pt_modules));
   }
   return pt;
 }
@@ -28,13 +28,17 @@
 namespace anlnext
 {
 
+std::atomic<unsigned long> BasicModule::switch_generation_{0};
+
 BasicModule::BasicModule()
   : order_sensitive_(false),
+    stage_head_(false),
     module_ID_(""),
     access_permission_(ModuleAccess::Permission::full_access),
     module_description_(""),
     module_on_(true),
     evs_manager_(nullptr),
+    event_store_(nullptr),
     module_access_(nullptr),
     current_parameter_(nullptr),
     current_value_element_(nullptr),
@@ -52,12 +56,15 @@ BasicModule::~BasicModule() = default;
 
 BasicModule::BasicModule(const BasicModule& r)
   : order_sensitive_(r.order_sensitive_),
+    stage_head_(r.stage_head_),
     module_ID_(r.module_ID_),
     aliases_(r.aliases_),
     access_permission_(r.access_permission_),
     module_description_(r.module_description_),
     module_on_(r.module_on_),
+    evs_gate_(r.evs_gate_),
     evs_manager_(nullptr),
+    event_store_(nullptr),
     module_access_(nullptr),
     current_parameter_(nullptr),
     current_value_element_(nullptr),
@@ -94,7 +101,7 @@ void BasicModule::copy_parameters(const BasicModule& r)
   module_parameters_.clear();
   for (ModuleParam_sptr p: r.module_parameters_) {
     ModuleParam_sptr new_param = p->clone();
-    p->set_module_pointer(this);
+    new_param->set_module_pointer(this);
     module_parameters_.push_back(new_param);
   }
 }
@@ -105,6 +112,22 @@ void BasicModule::set_module_id(const std::string& module_id)
   module_ID_method_ = &BasicModule::get_module_id;
 }
 
+ANLStatus BasicModule::mod_analyze_batch(long int begin, long int end, ANLStatusSpan status)
+{
+  for (long int i_event=begin; i_event<end; i_event++) {
+    ANLStatus& s = status[i_event-begin];
+    if (s == AS_OK) {
+      set_loop_index(i_event);
+      s = mod_analyze();
+      const ANLStatus t = eliminate_normal_error_status(s);
+      if (t==AS_QUIT || t==AS_QUIT_ALL || is_critical_error(t)) {
+        break;
+      }
+    }
+  }
+  return AS_OK;
+}
+
 ANLStatus BasicModule::mod_reduce(const std::list<BasicModule*>& parallel_modules)
 {
   ANLStatus status = AS_OK;
@@ -176,6 +199,43 @@ void BasicModule::ask_parameter(const std::string& name,
   (*it)->ask();
 }
 
+void BasicModule::compile_evs_gate()
+{
+  if (evs_gate_.empty()) {
+    evs_predicate_ = EvsPredicate();
+    return;
+  }
+
+  try {
+    evs_predicate_ = evs_manager_->compile(evs_gate_);
+  }
+  catch (ANLException& ex) {
+    ex.set_module_info(this);
+    ex << ErrorInfoOnMethod("compile_evs_gate");
+    throw;
+  }
+}
+
+void BasicModule::add_module_dependency(const BasicModule* mod,
+                                        const std::string& name,
+                                        bool writable)
+{
+  for (ModuleDependency& d: module_dependencies_) {
+    if (d.module == mod) {
+      d.writable = d.writable || writable;
+      return;
+    }
+  }
+  module_dependencies_.push_back(ModuleDependency{mod, name, writable});
+}
+
+void BasicModule::add_unique(std::vector<std::string>& list, const std::string& name)
+{
+  if (std::find(list.begin(), list.end(), name) == list.end()) {
+    list.push_back(name);
+  }
+}
+
 void BasicModule::define_evs(const std::string& key)
 {
   evs_manager_->define(key);
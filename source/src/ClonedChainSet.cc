@@ -22,14 +22,16 @@
 
 #include "BasicModule.hh"
 #include "EvsManager.hh"
+#include "EventStore.hh"
 #include "ModuleAccess.hh"
 
 namespace anlnext
 {
 
-ClonedChainSet::ClonedChainSet(int chain_id, const EvsManager& evs)
+ClonedChainSet::ClonedChainSet(int chain_id, const EvsManager& evs, const EventStore& store)
   : id_(chain_id),
     evs_manager_(new EvsManager(evs)),
+    event_store_(new EventStore(store.layout())),
     module_access_(new ModuleAccess)
 {
 }
@@ -40,6 +42,7 @@ void ClonedChainSet::push(std::unique_ptr<BasicModule>&& cloned_module)
 {
   std::unique_ptr<BasicModule> m = std::move(cloned_module);
   m->set_evs_manager(evs_manager_.get());
+  m->set_event_store(event_store_.get());
   m->set_module_access(module_access_.get());
   modules_ref_.push_back(m.get());
   modules_.push_back(std::move(m));
@@ -49,18 +52,28 @@ void ClonedChainSet::push(std::unique_ptr<BasicModule>&& cloned_module)
 void ClonedChainSet::setup_module_access()
 {
   for (BasicModule* mod: modules_ref_) {
-    if (mod->access_permission() != ModuleAccess::Permission::privacy) {
-      const std::string module_ID = mod->module_id();
-      module_access_->register_module(module_ID,
-                                      mod,
-                                      ModuleAccess::ConflictOption::error);
+    register_module(mod);
+  }
+}
+
+void ClonedChainSet::share_module(BasicModule* mod)
+{
+  register_module(mod);
+}
+
+void ClonedChainSet::register_module(BasicModule* mod)
+{
+  if (mod->access_permission() != ModuleAccess::Permission::privacy) {
+    const std::string module_ID = mod->module_id();
+    module_access_->register_module(module_ID,
+                                    mod,
+                                    ModuleAccess::ConflictOption::error);
     
-      for (const std::pair<std::string, ModuleAccess::ConflictOption>& alias: mod->get_aliases()) {
-        if (alias.first != module_ID) {
-          module_access_->register_module(alias.first,
-                                          mod,
-                                          alias.second);
-        }
+    for (const std::pair<std::string, ModuleAccess::ConflictOption>& alias: mod->get_aliases()) {
+      if (alias.first != module_ID) {
+        module_access_->register_module(alias.first,
+                                        mod,
+                                        alias.second);
       }
     }
   }
@@ -71,6 +84,19 @@ void ClonedChainSet::reset_counters()
   for (LoopCounter& c: counters_) {
     c.reset();
   }
+  evs_manager_->reset_all_counts();
+  event_statistics_.reset();
+}
+
+void ClonedChainSet::build_execution_plan(const std::vector<std::unique_ptr<Sequencer>>* keepers,
+                                          long int reordering_warmup,
+                                          ExecutionPlan* order_plan)
+{
+  plan_.build(modules_ref_, counters_.data(), keepers);
+  plan_.set_reordering_warmup(reordering_warmup);
+  if (order_plan) {
+    plan_.share_order(*order_plan);
+  }
 }
 
 BasicModule* ClonedChainSet::access_to_module(const std::string& module_ID)
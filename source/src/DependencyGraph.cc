@@ -0,0 +1,126 @@
+/*************************************************************************
+ *                                                                       *
+ * Copyright (c) 2011 Hirokazu Odaka                                     *
+ *                                                                       *
+ * This program is free software: you can redistribute it and/or modify  *
+ * it under the terms of the GNU General Public License as published by  *
+ * the Free Software Foundation, either version 3 of the License, or     *
+ * (at your option) any later version.                                   *
+ *                                                                       *
+ * This program is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ * GNU General Public License for more details.                          *
+ *                                                                       *
+ * You should have received a copy of the GNU General Public License     *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                       *
+ *************************************************************************/
+
+#include "DependencyGraph.hh"
+
+#include <algorithm>
+#include <map>
+#include <boost/format.hpp>
+
+#include "BasicModule.hh"
+
+namespace anlnext
+{
+
+void DependencyGraph::build(const std::vector<BasicModule*>& modules)
+{
+  clear();
+
+  std::map<const BasicModule*, std::size_t> index;
+  std::multimap<std::string, std::size_t> producers;
+  for (std::size_t i=0; i<modules.size(); i++) {
+    const BasicModule* mod = modules[i];
+    index[mod] = i;
+    for (const std::string& name: mod->defined_event_data()) {
+      producers.emplace(name, i);
+    }
+
+    std::string module_name = mod->module_name();
+    if (mod->module_id() != mod->module_name()) {
+      module_name += "/" + mod->module_id();
+    }
+    module_names_.push_back(module_name);
+  }
+
+  for (std::size_t i=0; i<modules.size(); i++) {
+    for (const ModuleDependency& d: modules[i]->module_dependencies()) {
+      const auto it = index.find(d.module);
+      if (it != index.end() && it->second != i) {
+        add_edge(i, it->second, (d.writable ? Kind::write : Kind::read), d.name);
+      }
+    }
+
+    for (const std::string& name: modules[i]->bound_event_data()) {
+      const auto range = producers.equal_range(name);
+      for (auto it=range.first; it!=range.second; ++it) {
+        if (it->second != i) {
+          add_edge(i, it->second, Kind::event_data, name);
+        }
+      }
+    }
+  }
+}
+
+void DependencyGraph::add_edge(std::size_t from, std::size_t to, Kind kind, const std::string& label)
+{
+  edges_.push_back(Edge{from, to, kind, label});
+}
+
+std::vector<std::size_t> DependencyGraph::dependencies(std::size_t i) const
+{
+  std::vector<std::size_t> v;
+  for (const Edge& e: edges_) {
+    if (e.from == i && std::find(v.begin(), v.end(), e.to) == v.end()) {
+      v.push_back(e.to);
+    }
+  }
+  std::sort(v.begin(), v.end());
+  return v;
+}
+
+bool DependencyGraph::are_dependent(std::size_t i, std::size_t j) const
+{
+  for (const Edge& e: edges_) {
+    if ((e.from == i && e.to == j) || (e.from == j && e.to == i)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void DependencyGraph::print(std::ostream& os) const
+{
+  os << '\n'
+     << "        **************************************\n"
+     << "        ****     Module dependencies      ****\n"
+     << "        **************************************\n"
+     << '\n';
+
+  for (std::size_t i=0; i<module_names_.size(); i++) {
+    bool header = false;
+    for (const Edge& e: edges_) {
+      if (e.from != i) { continue; }
+      if (!header) {
+        os << boost::format("    [%4d]  %s\n") % i % module_names_[i];
+        header = true;
+      }
+      const char* kind = (e.kind == Kind::read) ? "read"
+        : (e.kind == Kind::write) ? "write"
+        : "event data";
+      os << boost::format("              <- [%4d]  %-40s (%s: %s)\n")
+        % e.to % module_names_[e.to] % kind % e.label;
+      if (e.kind == Kind::event_data && e.to > i) {
+        os << "                 warning: defined by a later module; the value is left from the previous event\n";
+      }
+    }
+  }
+  os << std::endl;
+}
+
+} /* namespace anlnext */
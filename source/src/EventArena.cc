@@ -0,0 +1,53 @@
+/*************************************************************************
+ *                                                                       *
+ * Copyright (c) 2011 Hirokazu Odaka                                     *
+ *                                                                       *
+ * This program is free software: you can redistribute it and/or modify  *
+ * it under the terms of the GNU General Public License as published by  *
+ * the Free Software Foundation, either version 3 of the License, or     *
+ * (at your option) any later version.                                   *
+ *                                                                       *
+ * This program is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ * GNU General Public License for more details.                          *
+ *                                                                       *
+ * You should have received a copy of the GNU General Public License     *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                       *
+ *************************************************************************/
+
+#include "EventArena.hh"
+#include <algorithm>
+#include <numeric>
+
+namespace anlnext
+{
+
+void* EventArena::allocate_in_new_block(std::size_t size)
+{
+  // a block starts at an address aligned for any fundamental type.
+  if (!blocks_.empty()) {
+    for (std::size_t i=i_block_+1; i<blocks_.size(); i++) {
+      if (size <= block_sizes_[i]) {
+        i_block_ = i;
+        offset_ = size;
+        return blocks_[i].get();
+      }
+    }
+  }
+
+  const std::size_t new_size = std::max(block_size_, size);
+  blocks_.emplace_back(new char[new_size]);
+  block_sizes_.push_back(new_size);
+  i_block_ = blocks_.size()-1;
+  offset_ = size;
+  return blocks_.back().get();
+}
+
+std::size_t EventArena::capacity() const
+{
+  return std::accumulate(block_sizes_.begin(), block_sizes_.end(), std::size_t(0));
+}
+
+} /* namespace anlnext */
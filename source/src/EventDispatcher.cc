@@ -0,0 +1,174 @@
+/*************************************************************************
+ *                                                                       *
+ * Copyright (c) 2011 Hirokazu Odaka                                     *
+ *                                                                       *
+ * This program is free software: you can redistribute it and/or modify  *
+ * it under the terms of the GNU General Public License as published by  *
+ * the Free Software Foundation, either version 3 of the License, or     *
+ * (at your option) any later version.                                   *
+ *                                                                       *
+ * This program is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ * GNU General Public License for more details.                          *
+ *                                                                       *
+ * You should have received a copy of the GNU General Public License     *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                       *
+ *************************************************************************/
+
+#include "EventDispatcher.hh"
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <new>
+
+namespace anlnext
+{
+
+void* EventDispatcher::Slot::operator new[](std::size_t size)
+{
+  // the address of the allocated block is kept just before the aligned one.
+  char* raw = static_cast<char*>(::operator new(size + CacheLineSize + sizeof(void*)));
+  const std::uintptr_t address = reinterpret_cast<std::uintptr_t>(raw + sizeof(void*));
+  char* aligned = raw + sizeof(void*) + ((CacheLineSize - address%CacheLineSize) % CacheLineSize);
+  reinterpret_cast<void**>(aligned)[-1] = raw;
+  return aligned;
+}
+
+void EventDispatcher::Slot::operator delete[](void* p)
+{
+  if (p) {
+    ::operator delete(static_cast<void**>(p)[-1]);
+  }
+}
+
+void EventDispatcher::reset(long int num_events, int num_threads, bool ordered)
+{
+  num_events_ = (num_events < 0) ? std::numeric_limits<long int>::max() : num_events;
+  num_threads_ = std::max(num_threads, 1);
+  slots_.reset(new Slot[num_threads_]);
+  counter_.store(0);
+
+  if (ordered) {
+    // Every index taken must pass the order keepers: the rest of a larger
+    // chunk of a thread that quits or fails would never pass them and would
+    // block the other threads. Large chunks would also serialize the keepers.
+    chunk_ = 1;
+  }
+  else if (chunk_size_ > 0) {
+    chunk_ = chunk_size_;
+  }
+  else if (num_events < 0) {
+    // the length of an infinite run is unknown.
+    chunk_ = 64;
+  }
+  else {
+    chunk_ = std::min(std::max(num_events/(num_threads_*64l), 1l), 1024l);
+  }
+
+  guided_ = (schedule_ == EventSchedule::guided && !ordered);
+  stealing_ = (schedule_ == EventSchedule::work_stealing && !ordered && num_events >= 0);
+  if (stealing_) {
+    for (int i=0; i<num_threads_; i++) {
+      const long int begin = num_events * i / num_threads_;
+      const long int end = num_events * (i+1) / num_threads_;
+      if (begin < end) {
+        slots_[i].ranges.emplace_back(begin, end);
+      }
+    }
+  }
+}
+
+std::unique_lock<std::mutex> EventDispatcher::lock_slot(Slot& slot, Slot& owner)
+{
+  std::unique_lock<std::mutex> lock(slot.mutex, std::try_to_lock);
+  if (!lock.owns_lock()) {
+    const std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    lock.lock();
+    owner.lock_wait += std::chrono::steady_clock::now()-t0;
+  }
+  return lock;
+}
+
+bool EventDispatcher::take_chunk(int i_thread)
+{
+  Slot& slot = slots_[i_thread];
+  if (stealing_) {
+    while (!take_own_range(slot)) {
+      if (!steal_range(i_thread)) { return false; }
+    }
+    return true;
+  }
+
+  long int begin = 0;
+  long int size = chunk_;
+  if (guided_) {
+    begin = counter_.load(std::memory_order_relaxed);
+    do {
+      if (begin >= num_events_) { return false; }
+      size = std::max((num_events_-begin)/(2l*num_threads_), chunk_);
+    } while (!counter_.compare_exchange_weak(begin, begin+size, std::memory_order_relaxed));
+  }
+  else {
+    if (counter_.load(std::memory_order_relaxed) >= num_events_) { return false; }
+    begin = counter_.fetch_add(size, std::memory_order_relaxed);
+    if (begin >= num_events_) { return false; }
+  }
+
+  slot.next = begin;
+  slot.end = (size < num_events_-begin) ? begin+size : num_events_;
+  return true;
+}
+
+bool EventDispatcher::take_own_range(Slot& slot)
+{
+  const std::unique_lock<std::mutex> lock = lock_slot(slot, slot);
+  if (slot.ranges.empty()) {
+    return false;
+  }
+
+  EventRange& range = slot.ranges.front();
+  slot.next = range.first;
+  if (range.second - range.first > chunk_) {
+    slot.end = range.first + chunk_;
+    range.first = slot.end;
+  }
+  else {
+    slot.end = range.second;
+    slot.ranges.pop_front();
+  }
+  return true;
+}
+
+bool EventDispatcher::steal_range(int i_thread)
+{
+  for (int k=1; k<num_threads_; k++) {
+    Slot& victim = slots_[(i_thread+k)%num_threads_];
+    Slot& slot = slots_[i_thread];
+    EventRange stolen(0, 0);
+    {
+      const std::unique_lock<std::mutex> lock = lock_slot(victim, slot);
+      if (victim.ranges.empty()) { continue; }
+
+      EventRange& range = victim.ranges.back();
+      if (victim.ranges.size() == 1 && range.second - range.first > chunk_) {
+        const long int middle = range.first + (range.second - range.first)/2;
+        stolen = EventRange(middle, range.second);
+        range.second = middle;
+      }
+      else {
+        stolen = range;
+        victim.ranges.pop_back();
+      }
+    }
+
+    const std::unique_lock<std::mutex> lock = lock_slot(slot, slot);
+    slot.ranges.push_back(stolen);
+    return true;
+  }
+
+  return false;
+}
+
+} /* namespace anlnext */
@@ -0,0 +1,97 @@
+/*************************************************************************
+ *                                                                       *
+ * Copyright (c) 2011 Hirokazu Odaka                                     *
+ *                                                                       *
+ * This program is free software: you can redistribute it and/or modify  *
+ * it under the terms of the GNU General Public License as published by  *
+ * the Free Software Foundation, either version 3 of the License, or     *
+ * (at your option) any later version.                                   *
+ *                                                                       *
+ * This program is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ * GNU General Public License for more details.                          *
+ *                                                                       *
+ * You should have received a copy of the GNU General Public License     *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                       *
+ *************************************************************************/
+
+#include "EventStatistics.hh"
+#include <algorithm>
+#include <boost/format.hpp>
+
+namespace anlnext
+{
+
+std::uint64_t ThroughputSeries::events(std::int64_t second) const
+{
+  if (second < 0) { return 0; }
+  const Slot& slot = slots_[static_cast<std::size_t>(second) % NumSlots];
+  return (slot.second.get() == second) ? slot.events.get() : 0;
+}
+
+void ThroughputSeries::reset()
+{
+  for (Slot& slot: slots_) {
+    slot.second.set(-1);
+    slot.events.set(0);
+  }
+  last_second_.set(-1);
+}
+
+ThroughputSeries& ThroughputSeries::operator+=(const ThroughputSeries& r)
+{
+  for (std::size_t i=0; i<NumSlots; i++) {
+    const std::int64_t second = r.slots_[i].second.get();
+    if (second < 0) { continue; }
+    Slot& slot = slots_[i];
+    if (slot.second.get() == second) {
+      slot.events.add(r.slots_[i].events.get());
+    }
+    else if (slot.second.get() < second) {
+      slot.second.set(second);
+      slot.events.set(r.slots_[i].events.get());
+    }
+  }
+  if (r.last_second() > last_second()) {
+    last_second_.set(r.last_second());
+  }
+  return *this;
+}
+
+void ThroughputSeries::print(std::ostream& os, std::size_t num_seconds) const
+{
+  const std::int64_t last = last_second();
+  if (last < 0) { return; }
+
+  num_seconds = std::min(num_seconds, NumSlots);
+  const std::int64_t first = std::max<std::int64_t>(0, last+1-static_cast<std::int64_t>(num_seconds));
+  os << "    Throughput (events/s) from " << first << " s to " << last << " s:\n";
+  int column = 0;
+  for (std::int64_t s=first; s<=last; s++) {
+    if (column == 0) { os << "     "; }
+    os << boost::format(" %9d") % events(s);
+    if (++column == 10) {
+      os << '\n';
+      column = 0;
+    }
+  }
+  if (column != 0) { os << '\n'; }
+}
+
+boost::property_tree::ptree ThroughputSeries::to_property_tree() const
+{
+  boost::property_tree::ptree pt;
+  const std::int64_t last = last_second();
+  const std::int64_t first = std::max<std::int64_t>(0, last+1-static_cast<std::int64_t>(NumSlots));
+  for (std::int64_t s=first; s>=0 && s<=last; s++) {
+    boost::property_tree::ptree pt_second;
+    pt_second.put("second", s);
+    pt_second.put("events", events(s));
+    pt.push_back(std::make_pair("", std::move(pt_second)));
+  }
+  return pt;
+}
+
+} /* namespace anlnext */
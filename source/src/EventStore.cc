@@ -0,0 +1,90 @@
+/*************************************************************************
+ *                                                                       *
+ * Copyright (c) 2011 Hirokazu Odaka                                     *
+ *                                                                       *
+ * This program is free software: you can redistribute it and/or modify  *
+ * it under the terms of the GNU General Public License as published by  *
+ * the Free Software Foundation, either version 3 of the License, or     *
+ * (at your option) any later version.                                   *
+ *                                                                       *
+ * This program is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ * GNU General Public License for more details.                          *
+ *                                                                       *
+ * You should have received a copy of the GNU General Public License     *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                       *
+ *************************************************************************/
+
+#include "EventStore.hh"
+#include "ANLException.hh"
+
+namespace anlnext
+{
+
+std::size_t EventStoreLayout::define(const std::string& name, std::type_index type, Factory make)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto it = index_.find(name);
+  if (it != index_.end()) {
+    if (slots_[it->second].type != type) {
+      BOOST_THROW_EXCEPTION( ANLException("EventStore: slot "+name+" is already defined with another type") );
+    }
+    return it->second;
+  }
+
+  const std::size_t index = slots_.size();
+  slots_.push_back(Slot{name, type, make});
+  index_[name] = index;
+  return index;
+}
+
+std::size_t EventStoreLayout::find(const std::string& name, std::type_index type) const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto it = index_.find(name);
+  if (it == index_.end()) {
+    BOOST_THROW_EXCEPTION( ANLException("EventStore: slot "+name+" is not defined") );
+  }
+  if (slots_[it->second].type != type) {
+    BOOST_THROW_EXCEPTION( ANLException("EventStore: slot "+name+" has another type") );
+  }
+  return it->second;
+}
+
+std::size_t EventStoreLayout::size() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return slots_.size();
+}
+
+EventStoreLayout::Factory EventStoreLayout::factory(std::size_t index) const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return slots_[index].make;
+}
+
+EventStore::EventStore()
+  : layout_(new EventStoreLayout)
+{
+}
+
+EventStore::EventStore(std::shared_ptr<EventStoreLayout> layout)
+  : layout_(std::move(layout))
+{
+  sync();
+}
+
+EventStore::~EventStore() = default;
+
+void EventStore::sync()
+{
+  const std::size_t n = layout_->size();
+  for (std::size_t i=values_.size(); i<n; i++) {
+    values_.push_back(layout_->factory(i)());
+    pointers_.push_back(values_.back().get());
+  }
+}
+
+} /* namespace anlnext */
@@ -0,0 +1,362 @@
+/*************************************************************************
+ *                                                                       *
+ * Copyright (c) 2011 Hirokazu Odaka                                     *
+ *                                                                       *
+ * This program is free software: you can redistribute it and/or modify  *
+ * it under the terms of the GNU General Public License as published by  *
+ * the Free Software Foundation, either version 3 of the License, or     *
+ * (at your option) any later version.                                   *
+ *                                                                       *
+ * This program is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ * GNU General Public License for more details.                          *
+ *                                                                       *
+ * You should have received a copy of the GNU General Public License     *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                       *
+ *************************************************************************/
+
+#include "EvsIndex.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+#include "ANLException.hh"
+#include "EvsExpression.hh"
+
+namespace anlnext
+{
+
+namespace
+{
+
+const char MagicWord[8] = {'A', 'N', 'L', 'E', 'V', 'S', 'I', '1'};
+
+void write_varint(std::ostream& os, uint64_t v)
+{
+  while (v >= 0x80) {
+    os.put(static_cast<char>((v & 0x7f) | 0x80));
+    v >>= 7;
+  }
+  os.put(static_cast<char>(v));
+}
+
+uint64_t read_varint(std::istream& is)
+{
+  uint64_t v = 0;
+  for (int shift=0; shift<64; shift+=7) {
+    const int c = is.get();
+    if (c == std::char_traits<char>::eof()) {
+      BOOST_THROW_EXCEPTION( ANLException("EvsIndex: unexpected end of file") );
+    }
+    v |= static_cast<uint64_t>(c & 0x7f) << shift;
+    if ((c & 0x80) == 0) {
+      return v;
+    }
+  }
+  BOOST_THROW_EXCEPTION( ANLException("EvsIndex: broken integer in file") );
+}
+
+enum class SetEncoding { runs=0, bitmap=1 };
+
+void write_runs(std::ostream& os, const EventSet& s)
+{
+  write_varint(os, s.runs().size());
+  long int last = 0;
+  for (const EventSet::Run& run: s.runs()) {
+    write_varint(os, run.first - last);
+    write_varint(os, run.second - run.first);
+    last = run.second;
+  }
+}
+
+void write_bitmap(std::ostream& os, const EventSet& s)
+{
+  const long int begin = s.runs().front().first;
+  const long int end = s.runs().back().second;
+  std::string bytes((end-begin+7)/8, '\0');
+  for (const EventSet::Run& run: s.runs()) {
+    for (long int i=run.first; i<run.second; i++) {
+      bytes[(i-begin)/8] |= static_cast<char>(1 << ((i-begin)%8));
+    }
+  }
+  write_varint(os, begin);
+  write_varint(os, end-begin);
+  os.write(bytes.data(), bytes.size());
+}
+
+/**
+ * write a set as runs or as a bitmap, whichever is smaller.
+ */
+void write_set(std::ostream& os, const EventSet& s)
+{
+  std::ostringstream runs;
+  write_runs(runs, s);
+  const std::string encoded_runs = runs.str();
+  const long int span = s.empty() ? 0 : (s.runs().back().second - s.runs().front().first);
+  if (!s.empty() && (span+7)/8 + 20 < static_cast<long int>(encoded_runs.size())) {
+    os.put(static_cast<char>(SetEncoding::bitmap));
+    write_bitmap(os, s);
+  }
+  else {
+    os.put(static_cast<char>(SetEncoding::runs));
+    os.write(encoded_runs.data(), encoded_runs.size());
+  }
+}
+
+void read_set(std::istream& is, EventSet& s)
+{
+  s.clear();
+  const int encoding = is.get();
+  if (encoding == static_cast<int>(SetEncoding::runs)) {
+    const uint64_t num_runs = read_varint(is);
+    long int last = 0;
+    for (uint64_t i=0; i<num_runs; i++) {
+      const long int begin = last + static_cast<long int>(read_varint(is));
+      const long int end = begin + static_cast<long int>(read_varint(is));
+      s.add_run(begin, end);
+      last = end;
+    }
+  }
+  else if (encoding == static_cast<int>(SetEncoding::bitmap)) {
+    const long int begin = read_varint(is);
+    const long int span = read_varint(is);
+    std::string bytes((span+7)/8, '\0');
+    is.read(&bytes[0], bytes.size());
+    if (!is) {
+      BOOST_THROW_EXCEPTION( ANLException("EvsIndex: unexpected end of file") );
+    }
+    for (long int i=0; i<span; i++) {
+      if (bytes[i/8] & (1 << (i%8))) {
+        s.add(begin+i);
+      }
+    }
+  }
+  else {
+    BOOST_THROW_EXCEPTION( ANLException("EvsIndex: unknown encoding in file") );
+  }
+  s.normalize();
+}
+
+/**
+ * builder of the event set selected by an expression.
+ */
+class SelectionBuilder
+{
+public:
+  using value_type = EventSet;
+
+  explicit SelectionBuilder(const EvsIndex& index) : index_(index) {}
+
+  bool has_key(const std::string& key) const
+  { return index_.flags().count(key) > 0; }
+  EventSet key(const std::string& key) const
+  { return index_.flags().at(key); }
+  EventSet logical_and(const EventSet& a, const EventSet& b) const
+  { return a & b; }
+  EventSet logical_or(const EventSet& a, const EventSet& b) const
+  { return a | b; }
+  EventSet logical_not(const EventSet& a) const
+  { return index_.processed() - a; }
+
+private:
+  const EvsIndex& index_;
+};
+
+} /* anonymous namespace */
+
+void EventSet::clear()
+{
+  runs_.clear();
+  offsets_.clear();
+  normalized_ = true;
+}
+
+void EventSet::add(long int index)
+{
+  if (!runs_.empty()) {
+    Run& last = runs_.back();
+    if (index == last.second) {
+      last.second++;
+      return;
+    }
+    if (last.first <= index && index < last.second) {
+      return;
+    }
+    if (index < last.first) {
+      normalized_ = false;
+    }
+  }
+  runs_.emplace_back(index, index+1);
+}
+
+void EventSet::add_run(long int begin, long int end)
+{
+  if (begin >= end) { return; }
+  if (!runs_.empty() && begin < runs_.back().second) {
+    normalized_ = false;
+  }
+  runs_.emplace_back(begin, end);
+}
+
+void EventSet::merge(const EventSet& r)
+{
+  if (r.runs_.empty()) { return; }
+  runs_.insert(runs_.end(), r.runs_.begin(), r.runs_.end());
+  normalized_ = false;
+}
+
+void EventSet::normalize()
+{
+  if (!normalized_) {
+    std::sort(runs_.begin(), runs_.end());
+    std::vector<Run> merged;
+    for (const Run& run: runs_) {
+      if (!merged.empty() && run.first <= merged.back().second) {
+        merged.back().second = std::max(merged.back().second, run.second);
+      }
+      else {
+        merged.push_back(run);
+      }
+    }
+    runs_.swap(merged);
+    normalized_ = true;
+  }
+
+  offsets_.resize(runs_.size());
+  long int n = 0;
+  for (std::size_t i=0; i<runs_.size(); i++) {
+    offsets_[i] = n;
+    n += runs_[i].second - runs_[i].first;
+  }
+}
+
+long int EventSet::size() const
+{
+  long int n = 0;
+  for (const Run& run: runs_) {
+    n += run.second - run.first;
+  }
+  return n;
+}
+
+long int EventSet::at(long int i) const
+{
+  const auto it = std::upper_bound(offsets_.begin(), offsets_.end(), i);
+  const std::size_t k = std::distance(offsets_.begin(), it) - 1;
+  return runs_[k].first + (i - offsets_[k]);
+}
+
+EventSet EventSet::operator&(const EventSet& r) const
+{
+  EventSet s;
+  auto a = runs_.begin();
+  auto b = r.runs_.begin();
+  while (a!=runs_.end() && b!=r.runs_.end()) {
+    const long int begin = std::max(a->first, b->first);
+    const long int end = std::min(a->second, b->second);
+    if (begin < end) {
+      s.runs_.emplace_back(begin, end);
+    }
+    if (a->second < b->second) { ++a; } else { ++b; }
+  }
+  s.normalize();
+  return s;
+}
+
+EventSet EventSet::operator|(const EventSet& r) const
+{
+  EventSet s(*this);
+  s.merge(r);
+  s.normalize();
+  return s;
+}
+
+EventSet EventSet::operator-(const EventSet& r) const
+{
+  EventSet s;
+  auto b = r.runs_.begin();
+  for (const Run& run: runs_) {
+    long int begin = run.first;
+    while (b!=r.runs_.end() && b->second <= begin) { ++b; }
+    for (auto c=b; c!=r.runs_.end() && c->first < run.second; ++c) {
+      if (begin < c->first) {
+        s.runs_.emplace_back(begin, c->first);
+      }
+      begin = std::max(begin, c->second);
+    }
+    if (begin < run.second) {
+      s.runs_.emplace_back(begin, run.second);
+    }
+  }
+  s.normalize();
+  return s;
+}
+
+void EvsIndex::clear()
+{
+  processed_.clear();
+  flags_.clear();
+}
+
+void EvsIndex::write(const std::string& filename)
+{
+  std::ofstream fout(filename, std::ios::binary);
+  if (!fout) {
+    BOOST_THROW_EXCEPTION( ANLException("EvsIndex: cannot open file "+filename) );
+  }
+
+  fout.write(MagicWord, sizeof(MagicWord));
+  processed_.normalize();
+  write_set(fout, processed_);
+  write_varint(fout, flags_.size());
+  for (auto& flag: flags_) {
+    write_varint(fout, flag.first.size());
+    fout.write(flag.first.data(), flag.first.size());
+    flag.second.normalize();
+    write_set(fout, flag.second);
+  }
+
+  if (!fout) {
+    BOOST_THROW_EXCEPTION( ANLException("EvsIndex: failed to write file "+filename) );
+  }
+}
+
+void EvsIndex::read(const std::string& filename)
+{
+  std::ifstream fin(filename, std::ios::binary);
+  if (!fin) {
+    BOOST_THROW_EXCEPTION( ANLException("EvsIndex: cannot open file "+filename) );
+  }
+
+  char magic[sizeof(MagicWord)];
+  fin.read(magic, sizeof(magic));
+  if (!fin || !std::equal(magic, magic+sizeof(magic), MagicWord)) {
+    BOOST_THROW_EXCEPTION( ANLException("EvsIndex: not an EVS index file "+filename) );
+  }
+
+  clear();
+  read_set(fin, processed_);
+  const uint64_t num_keys = read_varint(fin);
+  for (uint64_t i=0; i<num_keys; i++) {
+    std::string key(read_varint(fin), '\0');
+    fin.read(&key[0], key.size());
+    if (!fin) {
+      BOOST_THROW_EXCEPTION( ANLException("EvsIndex: unexpected end of file "+filename) );
+    }
+    read_set(fin, flags_[key]);
+  }
+}
+
+EventSet EvsIndex::select(const std::string& expression) const
+{
+  SelectionBuilder builder(*this);
+  EvsExpressionParser<SelectionBuilder> parser(expression, builder);
+  return parser.parse();
+}
+
+} /* namespace anlnext */
@@ -19,49 +19,336 @@
 
 #include "EvsManager.hh"
 #include <iomanip>
+#include <algorithm>
+#include <set>
+#include "ANLException.hh"
+#include "EvsExpression.hh"
 
 namespace anlnext
 {
 
+namespace
+{
+
+inline int lowest_bit(uint64_t bits)
+{
+#if defined(__GNUC__)
+  return __builtin_ctzll(bits);
+#else
+  int n = 0;
+  while ((bits & 1u) == 0) {
+    bits >>= 1;
+    n++;
+  }
+  return n;
+#endif
+}
+
+/**
+ * add one to the counters of the bits set in the flags.
+ */
+void count_flags(const std::vector<uint64_t>& flags, std::vector<uint64_t>& counts)
+{
+  const std::size_t num_words = flags.size();
+  for (std::size_t w=0; w<num_words; w++) {
+    uint64_t bits = flags[w];
+    while (bits) {
+      ++counts[w*64+lowest_bit(bits)];
+      bits &= bits-1;
+    }
+  }
+}
+
+/**
+ * builder of an Evs expression in disjunctive normal form, in which each
+ * clause is a conjunction of slots required to be set and reset.
+ */
+class PredicateBuilder
+{
+public:
+  struct Clause
+  {
+    std::set<std::size_t> set;
+    std::set<std::size_t> reset;
+  };
+  using value_type = std::vector<Clause>;
+
+  explicit PredicateBuilder(const std::map<std::string, std::size_t>& index,
+                            const std::vector<char>& defined)
+    : index_(index), defined_(defined)
+  {}
+
+  bool has_key(const std::string& key) const
+  {
+    const auto it = index_.find(key);
+    return (it != index_.end() && defined_[it->second]);
+  }
+
+  value_type key(const std::string& key) const
+  {
+    Clause c;
+    c.set.insert(index_.at(key));
+    return value_type{c};
+  }
+
+  value_type logical_and(const value_type& a, const value_type& b) const
+  {
+    value_type r;
+    for (const Clause& ca: a) {
+      for (const Clause& cb: b) {
+        Clause c(ca);
+        c.set.insert(cb.set.begin(), cb.set.end());
+        c.reset.insert(cb.reset.begin(), cb.reset.end());
+        if (!is_contradiction(c)) {
+          r.push_back(std::move(c));
+        }
+      }
+    }
+    if (r.size() > MaxClauses) {
+      BOOST_THROW_EXCEPTION( ANLException("Evs expression: too many clauses after expansion") );
+    }
+    return r;
+  }
+
+  value_type logical_or(const value_type& a, const value_type& b) const
+  {
+    value_type r(a);
+    r.insert(r.end(), b.begin(), b.end());
+    return r;
+  }
+
+  value_type logical_not(const value_type& a) const
+  {
+    value_type r{Clause()};
+    for (const Clause& c: a) {
+      value_type negation;
+      for (const std::size_t slot: c.set) {
+        Clause n;
+        n.reset.insert(slot);
+        negation.push_back(std::move(n));
+      }
+      for (const std::size_t slot: c.reset) {
+        Clause n;
+        n.set.insert(slot);
+        negation.push_back(std::move(n));
+      }
+      r = logical_and(r, negation);
+    }
+    return r;
+  }
+
+private:
+  static bool is_contradiction(const Clause& c)
+  {
+    for (const std::size_t slot: c.set) {
+      if (c.reset.count(slot)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static constexpr std::size_t MaxClauses = 4096;
+
+  const std::map<std::string, std::size_t>& index_;
+  const std::vector<char>& defined_;
+};
+
+} /* anonymous namespace */
+
 EvsManager::~EvsManager() = default;
 
 void EvsManager::initialize()
 {
-  data_.clear();
+  index_.clear();
+  defined_.clear();
+  flags_.clear();
+  counts_.clear();
+  counts_ok_.clear();
+  unflagged_ = 0;
+  recorded_events_.clear();
+  recorded_flags_.clear();
 }
 
-void EvsManager::reset_all_flags()
+std::size_t EvsManager::make_slot(const std::string& key)
+{
+  const auto it = index_.find(key);
+  if (it != index_.end()) {
+    defined_[it->second] = 1;
+    return it->second;
+  }
+
+  const std::size_t i = defined_.size();
+  index_[key] = i;
+  defined_.push_back(1);
+  counts_.push_back(0);
+  counts_ok_.push_back(0);
+  recorded_flags_.emplace_back();
+  flags_.resize((i+64)/64, 0);
+  return i;
+}
+
+void EvsManager::define(const std::string& key)
+{
+  const std::size_t i = make_slot(key);
+  reset(EvsHandle(i));
+  counts_[i] = 0;
+  counts_ok_[i] = 0;
+}
+
+void EvsManager::undefine(const std::string& key)
+{
+  // the slot is kept so that the other handles remain valid.
+  const auto it = index_.find(key);
+  if (it != index_.end()) {
+    const std::size_t i = it->second;
+    defined_[i] = 0;
+    reset(EvsHandle(i));
+    counts_[i] = 0;
+    counts_ok_[i] = 0;
+  }
+}
+
+EvsHandle EvsManager::handle(const std::string& key) const
+{
+  const auto it = index_.find(key);
+  if (it==index_.end() || !defined_[it->second]) {
+    return EvsHandle();
+  }
+  return EvsHandle(it->second);
+}
+
+EvsPredicate EvsManager::compile(const std::string& expression) const
 {
-  for (auto& e: data_) {
-    e.second.flag = false;
+  PredicateBuilder builder(index_, defined_);
+  EvsExpressionParser<PredicateBuilder> parser(expression, builder);
+  const PredicateBuilder::value_type clauses = parser.parse();
+
+  EvsPredicate predicate;
+  predicate.expression_ = expression;
+  for (const PredicateBuilder::Clause& c: clauses) {
+    std::map<std::size_t, EvsPredicate::Word> words;
+    for (const std::size_t slot: c.set) {
+      EvsPredicate::Word& w = words[slot/64];
+      w.index = slot/64;
+      w.set |= (uint64_t(1) << (slot%64));
+    }
+    for (const std::size_t slot: c.reset) {
+      EvsPredicate::Word& w = words[slot/64];
+      w.index = slot/64;
+      w.reset |= (uint64_t(1) << (slot%64));
+    }
+    for (const auto& w: words) {
+      predicate.words_.push_back(w.second);
+    }
+    predicate.clause_ends_.push_back(predicate.words_.size());
   }
+  return predicate;
+}
+
+void EvsManager::reset_all_flags()
+{
+  std::fill(flags_.begin(), flags_.end(), 0);
 }
 
 void EvsManager::reset_all_counts()
 {
-  for (auto& e: data_) {
-    e.second.counts = 0;
+  std::fill(counts_.begin(), counts_.end(), 0);
+  std::fill(counts_ok_.begin(), counts_ok_.end(), 0);
+  unflagged_ = 0;
+  recorded_events_.clear();
+  for (EventSet& s: recorded_flags_) {
+    s.clear();
   }
 }
 
-void EvsManager::count()
+void EvsManager::save_flags(std::vector<char>& flags) const
 {
-  for (auto& e: data_) {
-    if (e.second.flag) {
-      ++(e.second.counts);
+  flags.clear();
+  for (const auto& e: index_) {
+    if (defined_[e.second]) {
+      flags.push_back(get(EvsHandle(e.second)));
     }
   }
 }
 
+void EvsManager::load_flags(const std::vector<char>& flags)
+{
+  const std::size_t n = flags.size();
+  std::size_t i = 0;
+  for (const auto& e: index_) {
+    if (defined_[e.second]) {
+      const EvsHandle h(e.second);
+      if (i<n && flags[i]) {
+        set(h);
+      }
+      else {
+        reset(h);
+      }
+      i++;
+    }
+  }
+}
+
+void EvsManager::count()
+{
+  count_flags(flags_, counts_);
+}
+
 void EvsManager::count_completed()
 {
-  for (auto& e: data_) {
-    if (e.second.flag) {
-      ++(e.second.counts_ok);
+  count_flags(flags_, counts_ok_);
+}
+
+void EvsManager::set_recording(bool v)
+{
+  recording_ = v;
+  if (recording_) {
+    recorded_events_.clear();
+    for (EventSet& s: recorded_flags_) {
+      s.clear();
+    }
+  }
+}
+
+void EvsManager::record(long int i_event)
+{
+  recorded_events_.add(i_event);
+  const std::size_t num_words = flags_.size();
+  for (std::size_t w=0; w<num_words; w++) {
+    uint64_t bits = flags_[w];
+    while (bits) {
+      recorded_flags_[w*64+lowest_bit(bits)].add(i_event);
+      bits &= bits-1;
+    }
+  }
+}
+
+void EvsManager::fill_index(EvsIndex& index) const
+{
+  index.processed().merge(recorded_events_);
+  for (const auto& e: index_) {
+    if (defined_[e.second]) {
+      index.flag(e.first).merge(recorded_flags_[e.second]);
     }
   }
 }
 
+EvsMap EvsManager::data() const
+{
+  EvsMap m;
+  for (const auto& e: index_) {
+    const std::size_t i = e.second;
+    if (defined_[i]) {
+      EvsData& d = m[e.first];
+      d.flag = get(EvsHandle(i));
+      d.counts = counts_[i];
+      d.counts_ok = counts_ok_[i];
+    }
+  }
+  return m;
+}
+
 void EvsManager::print_summary() const
 {
   std::cout << '\n'
@@ -70,29 +357,39 @@ void EvsManager::print_summary() const
             << "        **************************************\n"
             << std::endl;
 
-  std::cout << "  Number of EVS : " << data_.size() << '\n'
+  const std::size_t num_defined = std::count(defined_.begin(), defined_.end(), 1);
+  std::cout << "  Number of EVS : " << num_defined << '\n'
             << "------------------------------------------------------------------------------\n"
             << "                 key                        |     counts     |   completed    \n"
             << "------------------------------------------------------------------------------\n";
-  for (auto& e: data_) {
+  for (const auto& e: index_) {
+    const std::size_t i = e.second;
+    if (!defined_[i]) { continue; }
     std::cout << std::setw(44) << std::left << e.first << ' '
-              << std::setw(16) << std::right << e.second.counts << ' '
-              << std::setw(16) << std::right << e.second.counts_ok
+              << std::setw(16) << std::right << counts_[i] << ' '
+              << std::setw(16) << std::right << counts_ok_[i]
               << std::setw(0) << '\n';
   }
-  std::cout << "------------------------------------------------------------------------------\n"
-            << std::endl;
+  std::cout << "------------------------------------------------------------------------------\n";
+  if (unflagged_ > 0) {
+    std::cout << "  " << unflagged_ << " events processed in batches are not counted.\n";
+  }
+  std::cout << std::endl;
 }
 
 void EvsManager::merge(const EvsManager& r)
 {
-  for (const auto& evs: r.data()) {
-    const std::string& key = evs.first;
-    if (is_defined(key)) {
-      data_[key] += evs.second;
-    }
-    else {
-      data_[key] = evs.second;
+  recorded_events_.merge(r.recorded_events_);
+  unflagged_ += r.unflagged_;
+
+  // by key, since the slots of the same key may differ between the managers.
+  for (const auto& e: r.index_) {
+    const std::size_t j = e.second;
+    if (r.defined_[j]) {
+      const std::size_t i = make_slot(e.first);
+      counts_[i] += r.counts_[j];
+      counts_ok_[i] += r.counts_ok_[j];
+      recorded_flags_[i].merge(r.recorded_flags_[j]);
     }
   }
 }
@@ -0,0 +1,281 @@
+/*************************************************************************
+ *                                                                       *
+ * Copyright (c) 2011 Hirokazu Odaka                                     *
+ *                                                                       *
+ * This program is free software: you can redistribute it and/or modify  *
+ * it under the terms of the GNU General Public License as published by  *
+ * the Free Software Foundation, either version 3 of the License, or     *
+ * (at your option) any later version.                                   *
+ *                                                                       *
+ * This program is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ * GNU General Public License for more details.                          *
+ *                                                                       *
+ * You should have received a copy of the GNU General Public License     *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                       *
+ *************************************************************************/
+
+#include "ExecutionPlan.hh"
+#include <algorithm>
+#include <limits>
+#include "Sequencer.hh"
+#include "DependencyGraph.hh"
+
+namespace anlnext
+{
+
+void ExecutionPlan::build(const std::vector<BasicModule*>& modules,
+                          LoopCounter* counters,
+                          const std::vector<std::unique_ptr<Sequencer>>* keepers)
+{
+  modules_ = modules;
+  counters_ = counters;
+  keepers_.assign(modules.size(), nullptr);
+  if (keepers) {
+    for (std::size_t i=0; i<modules.size() && i<keepers->size(); i++) {
+      keepers_[i] = (*keepers)[i].get();
+    }
+  }
+
+  order_.resize(modules.size());
+  for (std::size_t i=0; i<modules.size(); i++) {
+    order_[i] = i;
+  }
+  profiles_.assign(modules.size(), FilterProfile());
+  filter_runs_.clear();
+  warmup_left_ = 0;
+  reordered_ = false;
+  shared_order_.reset();
+  num_events_ = 0;
+  num_completed_events_ = 0;
+  rebuild();
+}
+
+void ExecutionPlan::set_reordering_warmup(long int warmup)
+{
+  find_filter_runs();
+  // begin_event() is called at the beginning of every event; the filters
+  // are reordered at the beginning of the event after the window.
+  warmup_left_ = (warmup > 0 && !filter_runs_.empty() && !is_batchable()) ? warmup+1 : 0;
+  rebuild();
+}
+
+void ExecutionPlan::share_order(ExecutionPlan& other)
+{
+  if (!other.shared_order_) {
+    other.shared_order_ = std::make_shared<SharedOrder>();
+  }
+  shared_order_ = other.shared_order_;
+}
+
+void ExecutionPlan::set_concurrency(const DependencyGraph* graph, WorkerThreadPool* pool)
+{
+  graph_ = graph;
+  pool_ = (graph != nullptr) ? pool : nullptr;
+  rebuild();
+}
+
+void ExecutionPlan::find_filter_runs()
+{
+  filter_runs_.clear();
+  auto movable = [this](std::size_t i) {
+    const BasicModule* mod = modules_[i];
+    return (mod->mod_is_commutable_filter()
+            && keepers_[i] == nullptr
+            && mod->evs_gate().empty()
+            && mod->defined_event_data().empty());
+  };
+
+  const std::size_t n = modules_.size();
+  std::size_t first = 0;
+  while (first < n) {
+    if (!movable(first)) {
+      first++;
+      continue;
+    }
+    std::size_t last = first+1;
+    while (last < n && movable(last)) {
+      last++;
+    }
+    if (last-first >= 2) {
+      filter_runs_.emplace_back(first, last);
+    }
+    first = last;
+  }
+}
+
+void ExecutionPlan::reorder_filters()
+{
+  if (shared_order_) {
+    std::lock_guard<std::mutex> lock(shared_order_->mutex);
+    if (shared_order_->published) {
+      // another plan has finished its warm-up first.
+      return;
+    }
+  }
+
+  // a filter that rejects nothing is put at the end of its run.
+  auto rank = [this](std::size_t i) {
+    const FilterProfile& p = profiles_[i];
+    if (p.rejections == 0) {
+      return std::numeric_limits<double>::infinity();
+    }
+    return p.cost()/p.rejection_rate();
+  };
+
+  for (const auto& run: filter_runs_) {
+    std::stable_sort(order_.begin()+run.first, order_.begin()+run.second,
+                     [&rank](std::size_t a, std::size_t b) { return rank(a) < rank(b); });
+  }
+  reordered_ = true;
+
+  if (shared_order_) {
+    std::lock_guard<std::mutex> lock(shared_order_->mutex);
+    if (shared_order_->published) {
+      order_ = shared_order_->order;
+      profiles_ = shared_order_->profiles;
+    }
+    else {
+      shared_order_->order = order_;
+      shared_order_->profiles = profiles_;
+      shared_order_->published.store(true, std::memory_order_release);
+    }
+  }
+  rebuild();
+}
+
+void ExecutionPlan::adopt_shared_order()
+{
+  {
+    std::lock_guard<std::mutex> lock(shared_order_->mutex);
+    order_ = shared_order_->order;
+    profiles_ = shared_order_->profiles;
+  }
+  warmup_left_ = 0;
+  reordered_ = true;
+  rebuild();
+}
+
+void ExecutionPlan::rebuild()
+{
+  generation_ = BasicModule::switch_generation();
+  steps_.clear();
+  active_modules_.clear();
+  bool batchable = true;
+
+  std::vector<char> profiled(modules_.size(), 0);
+  if (warmup_left_ > 0) {
+    for (const auto& run: filter_runs_) {
+      std::fill(profiled.begin()+run.first, profiled.begin()+run.second, 1);
+    }
+  }
+
+  for (const std::size_t i: order_) {
+    BasicModule* mod = modules_[i];
+    const bool active = mod->is_on();
+    if (active || keepers_[i] != nullptr) {
+      Step step;
+      step.module = mod;
+      step.counter = counters_+i;
+      step.keeper = keepers_[i];
+      step.active = active;
+      step.profile = profiled[i] ? &profiles_[i] : nullptr;
+      step.index = i;
+      steps_.push_back(step);
+    }
+    if (active) {
+      active_modules_.push_back(mod);
+    }
+
+    if (keepers_[i] != nullptr) {
+      batchable = false;
+    }
+    if (active && !mod->evs_gate().empty()) {
+      batchable = false;
+    }
+  }
+
+  build_groups();
+  find_batch_segment(batchable);
+}
+
+void ExecutionPlan::find_batch_segment(bool batchable)
+{
+  batch_segment_ = Group{0, 0};
+  if (!batchable) { return; }
+
+  const std::size_t n = steps_.size();
+  std::size_t first = 0;
+  while (first < n) {
+    if (!steps_[first].module->mod_analyze_batch_is_supported()) {
+      first++;
+      continue;
+    }
+    std::size_t last = first+1;
+    while (last < n && steps_[last].module->mod_analyze_batch_is_supported()) {
+      last++;
+    }
+    if (last-first > batch_segment_.size()) {
+      batch_segment_ = Group{first, last};
+    }
+    first = last;
+  }
+}
+
+void ExecutionPlan::build_groups()
+{
+  groups_.clear();
+  if (pool_ == nullptr) { return; }
+
+  auto concurrent = [this](const Step& step) {
+    return (step.active
+            && step.keeper == nullptr
+            && step.module->mod_analyze_is_concurrent()
+            && step.module->evs_gate().empty());
+  };
+
+  const std::size_t n = steps_.size();
+  std::vector<std::size_t> levels;
+  std::size_t first = 0;
+  while (first < n) {
+    if (!concurrent(steps_[first])) {
+      groups_.push_back(Group{first, first+1});
+      first++;
+      continue;
+    }
+    std::size_t last = first+1;
+    while (last < n && concurrent(steps_[last])) {
+      last++;
+    }
+
+    levels.assign(last-first, 0);
+    for (std::size_t k=first; k<last; k++) {
+      for (std::size_t m=first; m<k; m++) {
+        if (levels[m-first] >= levels[k-first]
+            && graph_->are_dependent(steps_[k].index, steps_[m].index)) {
+          levels[k-first] = levels[m-first]+1;
+        }
+      }
+    }
+
+    // the chain order is kept within each level.
+    std::vector<Step> run(steps_.begin()+first, steps_.begin()+last);
+    const std::size_t num_levels = *std::max_element(levels.begin(), levels.end()) + 1;
+    std::size_t position = first;
+    for (std::size_t level=0; level<num_levels; level++) {
+      const std::size_t group_first = position;
+      for (std::size_t k=0; k<run.size(); k++) {
+        if (levels[k] == level) {
+          steps_[position++] = run[k];
+        }
+      }
+      groups_.push_back(Group{group_first, position});
+    }
+    first = last;
+  }
+  group_results_.assign(n, AS_OK);
+}
+
+} /* namespace anlnext */
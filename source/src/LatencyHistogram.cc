@@ -0,0 +1,143 @@
+/*************************************************************************
+ *                                                                       *
+ * Copyright (c) 2011 Hirokazu Odaka                                     *
+ *                                                                       *
+ * This program is free software: you can redistribute it and/or modify  *
+ * it under the terms of the GNU General Public License as published by  *
+ * the Free Software Foundation, either version 3 of the License, or     *
+ * (at your option) any later version.                                   *
+ *                                                                       *
+ * This program is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ * GNU General Public License for more details.                          *
+ *                                                                       *
+ * You should have received a copy of the GNU General Public License     *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                       *
+ *************************************************************************/
+
+#include "LatencyHistogram.hh"
+#include <algorithm>
+#include <boost/format.hpp>
+
+namespace anlnext
+{
+
+std::size_t LatencyHistogram::bin_of(std::int64_t ns)
+{
+  if (ns < static_cast<std::int64_t>(NumSubBuckets)) {
+    return ns > 0 ? static_cast<std::size_t>(ns) : 0;
+  }
+
+  const std::uint64_t v = static_cast<std::uint64_t>(ns);
+  int magnitude = 0;
+  for (int step=32; step>0; step/=2) {
+    if (v >> (magnitude+step)) {
+      magnitude += step;
+    }
+  }
+  if (magnitude > MaxMagnitude) {
+    return NumBins-1;
+  }
+
+  const int shift = magnitude - SubBucketBits;
+  const std::size_t sub = static_cast<std::size_t>(v >> shift) - NumSubBuckets;
+  return NumSubBuckets * static_cast<std::size_t>(shift+1) + sub;
+}
+
+std::int64_t LatencyHistogram::lower_edge(std::size_t bin)
+{
+  if (bin < NumSubBuckets) {
+    return static_cast<std::int64_t>(bin);
+  }
+  const int shift = static_cast<int>(bin/NumSubBuckets) - 1;
+  const std::size_t sub = bin % NumSubBuckets;
+  return static_cast<std::int64_t>(NumSubBuckets+sub) << shift;
+}
+
+std::int64_t LatencyHistogram::upper_edge(std::size_t bin)
+{
+  if (bin < NumSubBuckets) {
+    return static_cast<std::int64_t>(bin)+1;
+  }
+  const int shift = static_cast<int>(bin/NumSubBuckets) - 1;
+  return lower_edge(bin) + (std::int64_t(1) << shift);
+}
+
+void LatencyHistogram::record(std::int64_t ns, std::uint64_t n)
+{
+  bins_[bin_of(ns)].add(n);
+  count_.add(n);
+  sum_.add(ns*static_cast<std::int64_t>(n));
+  if (ns < min_.get()) { min_.set(ns); }
+  if (ns > max_.get()) { max_.set(ns); }
+}
+
+std::int64_t LatencyHistogram::percentile(double q) const
+{
+  const std::uint64_t n = count();
+  if (n == 0) { return 0; }
+
+  const double rank = q * n;
+  std::uint64_t cumulative = 0;
+  for (std::size_t i=0; i<NumBins; i++) {
+    cumulative += bins_[i].get();
+    if (cumulative > 0 && cumulative >= rank) {
+      const std::int64_t middle = (lower_edge(i)+upper_edge(i))/2;
+      return std::min(std::max(middle, min()), max());
+    }
+  }
+  return max();
+}
+
+void LatencyHistogram::reset()
+{
+  for (auto& b: bins_) {
+    b.set(0);
+  }
+  count_.set(0);
+  sum_.set(0);
+  min_.set(std::numeric_limits<std::int64_t>::max());
+  max_.set(0);
+}
+
+LatencyHistogram& LatencyHistogram::operator+=(const LatencyHistogram& r)
+{
+  for (std::size_t i=0; i<NumBins; i++) {
+    bins_[i].add(r.bins_[i].get());
+  }
+  count_.add(r.count_.get());
+  sum_.add(r.sum_.get());
+  if (r.min_.get() < min_.get()) { min_.set(r.min_.get()); }
+  if (r.max_.get() > max_.get()) { max_.set(r.max_.get()); }
+  return *this;
+}
+
+boost::property_tree::ptree LatencyHistogram::to_property_tree() const
+{
+  boost::property_tree::ptree pt;
+  pt.put("count", count());
+  pt.put("mean", 1.0e-9*mean());
+  pt.put("min", 1.0e-9*min());
+  pt.put("p50", 1.0e-9*percentile(0.5));
+  pt.put("p90", 1.0e-9*percentile(0.9));
+  pt.put("p99", 1.0e-9*percentile(0.99));
+  pt.put("p999", 1.0e-9*percentile(0.999));
+  pt.put("max", 1.0e-9*max());
+  return pt;
+}
+
+void LatencyHistogram::print_line(std::ostream& os) const
+{
+  os << boost::format("%10d | mean: %10.3f | p50: %10.3f | p90: %10.3f | p99: %10.3f | p99.9: %10.3f | max: %10.3f us\n")
+    % count()
+    % (1.0e-3*mean())
+    % (1.0e-3*percentile(0.5))
+    % (1.0e-3*percentile(0.9))
+    % (1.0e-3*percentile(0.99))
+    % (1.0e-3*percentile(0.999))
+    % (1.0e-3*max());
+}
+
+} /* namespace anlnext */
@@ -0,0 +1,102 @@
+/*************************************************************************
+ *                                                                       *
+ * Copyright (c) 2011 Hirokazu Odaka                                     *
+ *                                                                       *
+ * This program is free software: you can redistribute it and/or modify  *
+ * it under the terms of the GNU General Public License as published by  *
+ * the Free Software Foundation, either version 3 of the License, or     *
+ * (at your option) any later version.                                   *
+ *                                                                       *
+ * This program is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ * GNU General Public License for more details.                          *
+ *                                                                       *
+ * You should have received a copy of the GNU General Public License     *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                       *
+ *************************************************************************/
+
+#include "ModuleTiming.hh"
+
+namespace anlnext
+{
+
+std::atomic<bool> ModuleTiming::enabled_{false};
+
+const char* module_phase_name(ModulePhase phase)
+{
+  switch (phase) {
+  case ModulePhase::define:         return "define";
+  case ModulePhase::pre_initialize: return "pre_initialize";
+  case ModulePhase::initialize:     return "initialize";
+  case ModulePhase::begin_run:      return "begin_run";
+  case ModulePhase::analyze:        return "analyze";
+  case ModulePhase::end_run:        return "end_run";
+  case ModulePhase::finalize:       return "finalize";
+  }
+  return "";
+}
+
+double ModuleTiming::total_seconds() const
+{
+  std::int64_t t = 0;
+  for (const auto& v: nanoseconds_) {
+    t += v.get();
+  }
+  return 1.0e-9 * t;
+}
+
+double ModuleTiming::startup_seconds() const
+{
+  return (seconds(ModulePhase::define)
+          + seconds(ModulePhase::pre_initialize)
+          + seconds(ModulePhase::initialize)
+          + seconds(ModulePhase::begin_run));
+}
+
+bool ModuleTiming::empty() const
+{
+  for (const auto& n: calls_) {
+    if (n.get() > 0) { return false; }
+  }
+  return true;
+}
+
+void ModuleTiming::reset()
+{
+  for (std::size_t i=0; i<NumModulePhases; i++) {
+    nanoseconds_[i].set(0);
+    calls_[i].set(0);
+  }
+  analyze_latency_.reset();
+}
+
+ModuleTiming& ModuleTiming::operator+=(const ModuleTiming& r)
+{
+  for (std::size_t i=0; i<NumModulePhases; i++) {
+    nanoseconds_[i].add(r.nanoseconds_[i].get());
+    calls_[i].add(r.calls_[i].get());
+  }
+  analyze_latency_ += r.analyze_latency_;
+  return *this;
+}
+
+boost::property_tree::ptree ModuleTiming::to_property_tree() const
+{
+  boost::property_tree::ptree pt;
+  for (std::size_t i=0; i<NumModulePhases; i++) {
+    if (calls_[i].get() == 0) { continue; }
+    const ModulePhase phase = static_cast<ModulePhase>(i);
+    boost::property_tree::ptree pt_phase;
+    pt_phase.put("seconds", seconds(phase));
+    pt_phase.put("calls", calls_[i].get());
+    if (phase == ModulePhase::analyze) {
+      pt_phase.add_child("latency", analyze_latency_.to_property_tree());
+    }
+    pt.add_child(module_phase_name(phase), std::move(pt_phase));
+  }
+  return pt;
+}
+
+} /* namespace anlnext */
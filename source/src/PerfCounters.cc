@@ -0,0 +1,269 @@
+/*************************************************************************
+ *                                                                       *
+ * Copyright (c) 2011 Hirokazu Odaka                                     *
+ *                                                                       *
+ * This program is free software: you can redistribute it and/or modify  *
+ * it under the terms of the GNU General Public License as published by  *
+ * the Free Software Foundation, either version 3 of the License, or     *
+ * (at your option) any later version.                                   *
+ *                                                                       *
+ * This program is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ * GNU General Public License for more details.                          *
+ *                                                                       *
+ * You should have received a copy of the GNU General Public License     *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                       *
+ *************************************************************************/
+
+#include "PerfCounters.hh"
+
+#include <iostream>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#define ANLNEXT_PERF_COUNTERS_USE_PERF_EVENT 1
+#endif
+
+namespace anlnext
+{
+
+std::atomic<bool> PerfCounters::enabled_{false};
+std::atomic<unsigned int> PerfCounters::counted_events_{0};
+
+const char* perf_event_name(PerfEvent event)
+{
+  switch (event) {
+  case PerfEvent::cycles:        return "cycles";
+  case PerfEvent::instructions:  return "instructions";
+  case PerfEvent::cache_misses:  return "cache_misses";
+  case PerfEvent::branch_misses: return "branch_misses";
+  }
+  return "";
+}
+
+double ModuleCounters::ipc() const
+{
+  const std::uint64_t cycles = count(PerfEvent::cycles);
+  return cycles > 0 ? static_cast<double>(count(PerfEvent::instructions))/cycles : 0.0;
+}
+
+double ModuleCounters::misses_per_kilo_instructions(PerfEvent event) const
+{
+  const std::uint64_t instructions = count(PerfEvent::instructions);
+  return instructions > 0 ? 1000.0*count(event)/instructions : 0.0;
+}
+
+void ModuleCounters::reset()
+{
+  for (auto& v: counts_) {
+    v.set(0);
+  }
+  calls_.set(0);
+}
+
+ModuleCounters& ModuleCounters::operator+=(const ModuleCounters& r)
+{
+  for (std::size_t i=0; i<NumPerfEvents; i++) {
+    counts_[i].add(r.counts_[i].get());
+  }
+  calls_.add(r.calls_.get());
+  return *this;
+}
+
+boost::property_tree::ptree ModuleCounters::to_property_tree() const
+{
+  boost::property_tree::ptree pt;
+  pt.put("calls", calls());
+  for (std::size_t i=0; i<NumPerfEvents; i++) {
+    pt.put(perf_event_name(static_cast<PerfEvent>(i)), counts_[i].get());
+  }
+  pt.put("ipc", ipc());
+  return pt;
+}
+
+#if ANLNEXT_PERF_COUNTERS_USE_PERF_EVENT
+
+namespace
+{
+
+/**
+ * a group of the counters of the calling thread.
+ */
+class ThreadCounters
+{
+public:
+  ThreadCounters()
+  {
+    fds_.fill(-1);
+    positions_.fill(-1);
+    open();
+  }
+
+  ~ThreadCounters()
+  {
+    for (int fd: fds_) {
+      if (fd >= 0) { ::close(fd); }
+    }
+  }
+
+  ThreadCounters(const ThreadCounters&) = delete;
+  ThreadCounters& operator=(const ThreadCounters&) = delete;
+
+  bool is_open() const { return leader_ >= 0; }
+  int error() const { return error_; }
+
+  unsigned int events() const
+  {
+    unsigned int mask = 0;
+    for (std::size_t i=0; i<NumPerfEvents; i++) {
+      if (positions_[i] >= 0) { mask |= (1u << i); }
+    }
+    return mask;
+  }
+
+  bool read(PerfCounters::Values& values) const
+  {
+    // nr, time_enabled, time_running, and the values in the order of the group.
+    std::uint64_t buffer[3+NumPerfEvents];
+    const ssize_t size = ::read(leader_, buffer, sizeof(buffer));
+    if (size < static_cast<ssize_t>((3+num_members_)*sizeof(std::uint64_t))) {
+      return false;
+    }
+
+    const std::uint64_t enabled = buffer[1];
+    const std::uint64_t running = buffer[2];
+    const bool multiplexed = (running > 0 && running < enabled);
+    for (std::size_t i=0; i<NumPerfEvents; i++) {
+      const int k = positions_[i];
+      if (k < 0) {
+        values[i] = 0;
+      }
+      else if (multiplexed) {
+        values[i] = static_cast<std::uint64_t>(static_cast<double>(buffer[3+k])*enabled/running);
+      }
+      else {
+        values[i] = buffer[3+k];
+      }
+    }
+    return true;
+  }
+
+private:
+  void open()
+  {
+    const std::uint64_t configs[NumPerfEvents] = {
+      PERF_COUNT_HW_CPU_CYCLES,
+      PERF_COUNT_HW_INSTRUCTIONS,
+      PERF_COUNT_HW_CACHE_MISSES,
+      PERF_COUNT_HW_BRANCH_MISSES,
+    };
+
+    for (std::size_t i=0; i<NumPerfEvents; i++) {
+      perf_event_attr attr;
+      std::memset(&attr, 0, sizeof(attr));
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.size = sizeof(attr);
+      attr.config = configs[i];
+      attr.disabled = (leader_ < 0) ? 1 : 0;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+      const int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, leader_, 0));
+      if (fd < 0) {
+        if (error_ == 0) { error_ = errno; }
+        continue;
+      }
+      fds_[i] = fd;
+      positions_[i] = num_members_++;
+      if (leader_ < 0) { leader_ = fd; }
+    }
+
+    if (leader_ >= 0) {
+      ioctl(leader_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+      ioctl(leader_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+  }
+
+private:
+  int leader_ = -1;
+  int num_members_ = 0;
+  int error_ = 0;
+  std::array<int, NumPerfEvents> fds_;
+  std::array<int, NumPerfEvents> positions_;
+};
+
+ThreadCounters& thread_counters()
+{
+  thread_local ThreadCounters counters;
+  return counters;
+}
+
+} /* anonymous namespace */
+
+bool PerfCounters::set_enabled(bool v)
+{
+  if (!v) {
+    enabled_.store(false, std::memory_order_relaxed);
+    return true;
+  }
+
+  const ThreadCounters& counters = thread_counters();
+  if (!counters.is_open()) {
+    const int e = counters.error();
+    std::cout << "PerfCounters: the hardware counters are not available (perf_event_open: "
+              << std::strerror(e) << ").\n";
+    if (e == EACCES || e == EPERM) {
+      std::cout << "  Counting needs /proc/sys/kernel/perf_event_paranoid <= 2 or CAP_PERFMON;\n"
+                << "  a container may also block perf_event_open by its seccomp profile.\n";
+    }
+    else if (e == ENOSYS) {
+      std::cout << "  The kernel does not support perf events.\n";
+    }
+    else {
+      std::cout << "  The CPU or the virtual machine does not expose hardware counters.\n";
+    }
+    std::cout << "  The module counters are disabled." << std::endl;
+    enabled_.store(false, std::memory_order_relaxed);
+    return false;
+  }
+
+  counted_events_.store(counters.events(), std::memory_order_relaxed);
+  enabled_.store(true, std::memory_order_relaxed);
+  return true;
+}
+
+bool PerfCounters::read(Values& values)
+{
+  const ThreadCounters& counters = thread_counters();
+  return counters.is_open() && counters.read(values);
+}
+
+#else /* ANLNEXT_PERF_COUNTERS_USE_PERF_EVENT */
+
+bool PerfCounters::set_enabled(bool v)
+{
+  if (v) {
+    std::cout << "PerfCounters: the hardware counters are supported only on Linux.\n"
+              << "  The module counters are disabled." << std::endl;
+    return false;
+  }
+  enabled_.store(false, std::memory_order_relaxed);
+  return true;
+}
+
+bool PerfCounters::read(Values&)
+{
+  return false;
+}
+
+#endif /* ANLNEXT_PERF_COUNTERS_USE_PERF_EVENT */
+
+} /* namespace anlnext */
@@ -0,0 +1,135 @@
+/*************************************************************************
+ *                                                                       *
+ * Copyright (c) 2011 Hirokazu Odaka                                     *
+ *                                                                       *
+ * This program is free software: you can redistribute it and/or modify  *
+ * it under the terms of the GNU General Public License as published by  *
+ * the Free Software Foundation, either version 3 of the License, or     *
+ * (at your option) any later version.                                   *
+ *                                                                       *
+ * This program is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ * GNU General Public License for more details.                          *
+ *                                                                       *
+ * You should have received a copy of the GNU General Public License     *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                       *
+ *************************************************************************/
+
+#include "Sequencer.hh"
+
+#include <climits>
+#include <thread>
+
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#define ANLNEXT_SEQUENCER_USE_FUTEX 1
+#else
+#include <mutex>
+#include <condition_variable>
+#endif
+
+namespace anlnext
+{
+
+#if ANLNEXT_SEQUENCER_USE_FUTEX
+
+struct Sequencer::Slot
+{
+  std::atomic<int> word{0};
+  std::atomic<int> num_waiters{0};
+  char padding[56];
+
+  void sleep(int expected)
+  {
+    syscall(SYS_futex, reinterpret_cast<int*>(&word), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+  }
+
+  void wake_all()
+  {
+    syscall(SYS_futex, reinterpret_cast<int*>(&word), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+  }
+};
+
+#else
+
+struct Sequencer::Slot
+{
+  std::atomic<int> word{0};
+  std::atomic<int> num_waiters{0};
+  std::mutex mutex;
+  std::condition_variable cv;
+
+  void sleep(int expected)
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&](){ return word.load() != expected; });
+  }
+
+  void wake_all()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    cv.notify_all();
+  }
+};
+
+#endif
+
+Sequencer::Sequencer()
+  : slots_(new Slot[NumSlots])
+{
+}
+
+thread_local std::int64_t Sequencer::thread_wait_nanoseconds_ = 0;
+
+Sequencer::~Sequencer() = default;
+
+void Sequencer::wait_slow(long int index)
+{
+  const std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  auto account = [&]() {
+    const std::chrono::steady_clock::duration t = std::chrono::steady_clock::now()-t0;
+    const std::int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t).count();
+    wait_nanoseconds_.fetch_add(ns, std::memory_order_relaxed);
+    thread_wait_nanoseconds_ += ns;
+    num_waits_.fetch_add(1, std::memory_order_relaxed);
+  };
+
+  for (int i=0; i<spin_count_; i++) {
+    if (last_done_index_.load(std::memory_order_acquire) == index-1) {
+      account();
+      return;
+    }
+    if (i%64 == 63) {
+      std::this_thread::yield();
+    }
+  }
+
+  // The waiter is counted before the last check so that send_done() never
+  // misses it; a change of the slot word makes sleep() return at once.
+  Slot& slot = slots_[index%NumSlots];
+  slot.num_waiters.fetch_add(1, std::memory_order_seq_cst);
+  while (true) {
+    const int word = slot.word.load(std::memory_order_seq_cst);
+    if (last_done_index_.load(std::memory_order_seq_cst) == index-1) {
+      break;
+    }
+    slot.sleep(word);
+  }
+  slot.num_waiters.fetch_sub(1, std::memory_order_relaxed);
+  account();
+}
+
+void Sequencer::wake(long int index)
+{
+  Slot& slot = slots_[index%NumSlots];
+  slot.word.fetch_add(1, std::memory_order_seq_cst);
+  if (slot.num_waiters.load(std::memory_order_seq_cst) > 0) {
+    slot.wake_all();
+  }
+}
+
+} /* namespace anlnext */
@@ -0,0 +1,136 @@
+/*************************************************************************
+ *                                                                       *
+ * Copyright (c) 2011 Hirokazu Odaka                                     *
+ *                                                                       *
+ * This program is free software: you can redistribute it and/or modify  *
+ * it under the terms of the GNU General Public License as published by  *
+ * the Free Software Foundation, either version 3 of the License, or     *
+ * (at your option) any later version.                                   *
+ *                                                                       *
+ * This program is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ * GNU General Public License for more details.                          *
+ *                                                                       *
+ * You should have received a copy of the GNU General Public License     *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                       *
+ *************************************************************************/
+
+#include "ThreadAffinity.hh"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <string>
+#include <tuple>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace anlnext
+{
+
+namespace
+{
+
+int read_topology(int cpu, const std::string& name)
+{
+  std::ifstream fin("/sys/devices/system/cpu/cpu"+std::to_string(cpu)+"/topology/"+name);
+  int value = 0;
+  if (!(fin >> value)) {
+    return 0;
+  }
+  return value;
+}
+
+std::vector<int> allowed_cpus()
+{
+  std::vector<int> cpus;
+#if defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (int cpu=0; cpu<CPU_SETSIZE; cpu++) {
+      if (CPU_ISSET(cpu, &set)) {
+        cpus.push_back(cpu);
+      }
+    }
+  }
+#endif
+  return cpus;
+}
+
+} /* anonymous namespace */
+
+void ThreadAffinity::setup()
+{
+  cpus_.clear();
+  if (policy_ == AffinityPolicy::none) {
+    return;
+  }
+  if (policy_ == AffinityPolicy::cpu_list) {
+    cpus_ = cpu_list_;
+    return;
+  }
+
+  // (socket, core, cpu)
+  std::vector<std::tuple<int, int, int>> topology;
+  for (int cpu: allowed_cpus()) {
+    topology.emplace_back(read_topology(cpu, "physical_package_id"),
+                          read_topology(cpu, "core_id"),
+                          cpu);
+  }
+  std::sort(topology.begin(), topology.end());
+
+  if (policy_ == AffinityPolicy::compact) {
+    for (const auto& t: topology) {
+      cpus_.push_back(std::get<2>(t));
+    }
+  }
+  else if (policy_ == AffinityPolicy::scatter) {
+    std::map<int, std::vector<int>> sockets;
+    for (const auto& t: topology) {
+      sockets[std::get<0>(t)].push_back(std::get<2>(t));
+    }
+    for (std::size_t i=0; cpus_.size()<topology.size(); i++) {
+      for (const auto& socket: sockets) {
+        if (i < socket.second.size()) {
+          cpus_.push_back(socket.second[i]);
+        }
+      }
+    }
+  }
+}
+
+int ThreadAffinity::cpu_for_thread(int i_thread) const
+{
+  if (cpus_.empty()) {
+    return -1;
+  }
+  return cpus_[i_thread % cpus_.size()];
+}
+
+bool ThreadAffinity::bind(int i_thread) const
+{
+  const int cpu = cpu_for_thread(i_thread);
+  if (cpu < 0) {
+    return false;
+  }
+
+#if defined(__linux__)
+  if (cpu >= CPU_SETSIZE) {
+    return false;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0);
+#else
+  return false;
+#endif
+}
+
+} /* namespace anlnext */
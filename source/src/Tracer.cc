@@ -0,0 +1,158 @@
+/*************************************************************************
+ *                                                                       *
+ * Copyright (c) 2011 Hirokazu Odaka                                     *
+ *                                                                       *
+ * This program is free software: you can redistribute it and/or modify  *
+ * it under the terms of the GNU General Public License as published by  *
+ * the Free Software Foundation, either version 3 of the License, or     *
+ * (at your option) any later version.                                   *
+ *                                                                       *
+ * This program is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ * GNU General Public License for more details.                          *
+ *                                                                       *
+ * You should have received a copy of the GNU General Public License     *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                       *
+ *************************************************************************/
+
+#include "Tracer.hh"
+
+#include <algorithm>
+#include <fstream>
+#include <boost/format.hpp>
+
+#include "ANLException.hh"
+#include "BasicModule.hh"
+
+namespace anlnext
+{
+
+std::atomic<bool> Tracer::enabled_{false};
+long int Tracer::first_event_ = 0;
+long int Tracer::last_event_ = -1;
+long int Tracer::period_ = 1;
+std::size_t Tracer::capacity_ = 65536;
+Tracer::Clock::time_point Tracer::origin_;
+std::mutex Tracer::mutex_;
+std::vector<std::unique_ptr<Tracer::Buffer>> Tracer::buffers_;
+
+thread_local Tracer::Buffer* Tracer::buffer_ = nullptr;
+thread_local long int Tracer::current_event_ = -1;
+thread_local bool Tracer::event_traced_ = false;
+
+namespace
+{
+
+std::string json_escape(const std::string& s)
+{
+  std::string r;
+  for (const char c: s) {
+    if (c == '"' || c == '\\') {
+      r += '\\';
+      r += c;
+    }
+    else if (static_cast<unsigned char>(c) < 0x20) {
+      r += boost::str(boost::format("\\u%04x") % static_cast<int>(c));
+    }
+    else {
+      r += c;
+    }
+  }
+  return r;
+}
+
+} /* anonymous namespace */
+
+void Tracer::start(long int first_event, long int last_event, long int period,
+                   std::size_t capacity)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  first_event_ = first_event;
+  last_event_ = last_event;
+  period_ = (period > 0) ? period : 1;
+  capacity_ = (capacity > 0) ? capacity : 1;
+  origin_ = Clock::now();
+  for (auto& buffer: buffers_) {
+    buffer->spans.assign(capacity_, Span());
+    buffer->next = 0;
+  }
+  enabled_.store(true, std::memory_order_relaxed);
+}
+
+Tracer::Buffer* Tracer::thread_buffer()
+{
+  if (buffer_ == nullptr) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    buffers_.emplace_back(new Buffer);
+    buffer_ = buffers_.back().get();
+    buffer_->thread_id = static_cast<int>(buffers_.size());
+    buffer_->spans.assign(capacity_, Span());
+  }
+  return buffer_;
+}
+
+void Tracer::record(const char* name, const char* category, const BasicModule* module,
+                    long int event, Clock::time_point begin, Clock::time_point end)
+{
+  Buffer* buffer = thread_buffer();
+  if (buffer->spans.empty()) { return; }
+
+  Span& span = buffer->spans[buffer->next % buffer->spans.size()];
+  span.name = name;
+  span.category = category;
+  if (module) {
+    span.module_id = module->module_id();
+  }
+  else {
+    span.module_id.clear();
+  }
+  span.event = event;
+  span.begin = std::chrono::duration_cast<std::chrono::nanoseconds>(begin-origin_).count();
+  span.end = std::chrono::duration_cast<std::chrono::nanoseconds>(end-origin_).count();
+  buffer->next++;
+}
+
+void Tracer::clear()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto& buffer: buffers_) {
+    buffer->next = 0;
+  }
+}
+
+std::size_t Tracer::write(const std::string& filename)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::ofstream fout(filename);
+  if (!fout) {
+    BOOST_THROW_EXCEPTION( ANLException("Tracer: cannot open " + filename) );
+  }
+
+  std::size_t num_spans = 0;
+  fout << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+  bool first = true;
+  for (const auto& buffer: buffers_) {
+    if (!first) { fout << ",\n"; }
+    first = false;
+    fout << boost::format("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"thread %d\"}}")
+      % buffer->thread_id % buffer->thread_id;
+
+    const std::size_t capacity = buffer->spans.size();
+    const std::size_t n = std::min(buffer->next, capacity);
+    for (std::size_t k=buffer->next-n; k<buffer->next; k++) {
+      const Span& span = buffer->spans[k % capacity];
+      const std::string name = span.module_id.empty() ? span.name : span.module_id;
+      fout << boost::format(",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"call\":\"%s\",\"event\":%d}}")
+        % json_escape(name) % span.category % buffer->thread_id
+        % (1.0e-3*span.begin) % (1.0e-3*(span.end-span.begin))
+        % span.name % span.event;
+      num_spans++;
+    }
+  }
+  fout << "\n]}\n";
+  return num_spans;
+}
+
+} /* namespace anlnext */
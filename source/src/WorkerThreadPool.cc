@@ -0,0 +1,101 @@
+/*************************************************************************
+ *                                                                       *
+ * Copyright (c) 2011 Hirokazu Odaka                                     *
+ *                                                                       *
+ * This program is free software: you can redistribute it and/or modify  *
+ * it under the terms of the GNU General Public License as published by  *
+ * the Free Software Foundation, either version 3 of the License, or     *
+ * (at your option) any later version.                                   *
+ *                                                                       *
+ * This program is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ * GNU General Public License for more details.                          *
+ *                                                                       *
+ * You should have received a copy of the GNU General Public License     *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                       *
+ *************************************************************************/
+
+#include "WorkerThreadPool.hh"
+
+namespace anlnext
+{
+
+WorkerThreadPool::~WorkerThreadPool()
+{
+  stop();
+}
+
+void WorkerThreadPool::start(int num_threads)
+{
+  if (!threads_.empty()) { return; }
+
+  stopping_ = false;
+  for (int i=0; i<num_threads; i++) {
+    threads_.emplace_back(&WorkerThreadPool::work, this, i, generation_);
+  }
+}
+
+void WorkerThreadPool::stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  start_cv_.notify_all();
+
+  for (std::thread& t: threads_) {
+    t.join();
+  }
+  threads_.clear();
+}
+
+void WorkerThreadPool::run(const std::function<void(int)>& task)
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  task_ = &task;
+  exception_ = nullptr;
+  num_running_ = size();
+  ++generation_;
+  start_cv_.notify_all();
+  done_cv_.wait(lock, [this](){ return num_running_ == 0; });
+  task_ = nullptr;
+
+  if (exception_) {
+    std::rethrow_exception(exception_);
+  }
+}
+
+void WorkerThreadPool::work(int i_thread, unsigned long int done_generation)
+{
+  while (true) {
+    const std::function<void(int)>* task = nullptr;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      start_cv_.wait(lock, [&](){ return stopping_ || generation_ != done_generation; });
+      if (stopping_) { return; }
+      done_generation = generation_;
+      task = task_;
+    }
+
+    std::exception_ptr exception;
+    try {
+      (*task)(i_thread);
+    }
+    catch (...) {
+      exception = std::current_exception();
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (exception && !exception_) {
+        exception_ = exception;
+      }
+      --num_running_;
+    }
+    done_cv_.notify_one();
+  }
+}
+
+} /* namespace anlnext */